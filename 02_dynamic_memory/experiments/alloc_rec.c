@@ -0,0 +1,320 @@
+/*
+ * alloc_rec.c — LD_PRELOAD recorder: logs every malloc/calloc/realloc/free
+ * of an unmodified program into a binary trace (alloc_trace.h).
+ *
+ *   gcc -O2 -shared -fPIC alloc_rec.c -o alloc_rec.so -pthread
+ *   ALLOC_TRACE=sort.atr LD_PRELOAD=./alloc_rec.so sort big.txt > /dev/null
+ *   ./alloc_replay run sort.atr
+ *
+ * "%p" in ALLOC_TRACE becomes the pid, so every process of a pipeline or
+ * a forking server writes its own trace: a forked child reopens the file
+ * under its own pid and starts an empty trace (blocks it inherits count as
+ * older blocks, like those from before the constructor). Without it one
+ * process owns the
+ * file (its pid goes into ALLOC_TRACE_PID): programs it starts don't touch
+ * it, but an exec() in the same process — a wrapper script ending in
+ * `exec prog` — takes it over.
+ *
+ * The wrappers call glibc's own entry points (__libc_malloc ...), so there
+ * is no dlsym() bootstrap problem. One mutex is held around the real call
+ * *and* the log write: otherwise thread A's free(p) could be logged after
+ * thread B's malloc returned the same p, and the pointer -> id map would
+ * break. The program's allocator is serialized while recording; that is
+ * the price of an exact order.
+ *
+ * Nothing here calls malloc: the pointer -> id table and the write buffer
+ * come from mmap, output goes through write(2).
+ */
+#define _GNU_SOURCE
+#include "alloc_trace.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *p, size_t size);
+extern void  __libc_free(void *p);
+
+#define REC_BUF   4096u                  /* records per write(2) */
+#define TOMB      ((uintptr_t)1)
+
+typedef struct {
+    uintptr_t p;                         /* 0 empty, TOMB deleted */
+    uint32_t  id;
+} slot;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static int      recording;
+static int      fd = -1;
+static uint64_t t0, count, unknown_frees;
+static uint32_t next_id = 1, next_tid;
+static at_rec  *buf;
+static size_t   nbuf;
+static slot    *table;
+static size_t   cap, used, live;         /* used counts tombstones too */
+static char     tmpl[4096];              /* ALLOC_TRACE, if it has "%p" */
+
+static __thread uint32_t tid_plus1;
+static __thread int      inside;         /* our own code called malloc */
+
+static uint64_t mono_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static void *map(size_t len) {
+    void *p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return p == MAP_FAILED ? NULL : p;
+}
+
+static void write_all(const void *p, size_t len) {
+    const char *c = p;
+    while (len > 0) {
+        ssize_t w = write(fd, c, len);
+        if (w <= 0) {
+            recording = 0;               /* disk full etc.: stop, don't crash */
+            return;
+        }
+        c += w;
+        len -= (size_t)w;
+    }
+}
+
+static void flush(void) {
+    write_all(buf, nbuf * sizeof *buf);
+    nbuf = 0;
+}
+
+/* ---------- pointer -> id (open addressing, linear probing) ---------- */
+
+static size_t hash(uintptr_t p) {
+    return (size_t)((p >> 4) * 0x9E3779B97F4A7C15ULL >> 20) & (cap - 1);
+}
+
+static int rehash(size_t ncap) {
+    slot *old = table, *nt = map(ncap * sizeof *nt);
+    size_t ocap = cap;
+    if (nt == NULL)
+        return -1;
+    table = nt;
+    cap = ncap;
+    used = live;
+    for (size_t i = 0; i < ocap; i++) {
+        if (old[i].p <= TOMB)
+            continue;
+        size_t j = hash(old[i].p);
+        while (table[j].p)
+            j = (j + 1) & (cap - 1);
+        table[j] = old[i];
+    }
+    munmap(old, ocap * sizeof *old);
+    return 0;
+}
+
+static void put(void *p, uint32_t id) {
+    if ((used + 1) * 2 > cap
+        && rehash(live * 4 > cap ? cap * 2 : cap) != 0) {
+        recording = 0;
+        return;
+    }
+    size_t j = hash((uintptr_t)p);
+    while (table[j].p > TOMB)
+        j = (j + 1) & (cap - 1);
+    if (table[j].p == 0)
+        used++;
+    table[j] = (slot){ (uintptr_t)p, id };
+    live++;
+}
+
+static uint32_t take(void *p) {          /* 0 if p was never recorded */
+    for (size_t j = hash((uintptr_t)p); table[j].p; j = (j + 1) & (cap - 1))
+        if (table[j].p == (uintptr_t)p) {
+            table[j].p = TOMB;
+            live--;
+            return table[j].id;
+        }
+    return 0;
+}
+
+/* ---------- log (caller holds the lock) ---------- */
+
+static void log_op(unsigned op, uint32_t id, uint64_t size) {
+    if (tid_plus1 == 0)
+        tid_plus1 = ++next_tid;
+    buf[nbuf++] = (at_rec){ (mono_ns() - t0) << 2 | op, size, id, tid_plus1 - 1 };
+    count++;
+    if (nbuf == REC_BUF)
+        flush();
+}
+
+/* ---------- the interposed API ---------- */
+
+void *malloc(size_t size) {
+    if (!recording || inside)
+        return __libc_malloc(size);
+    inside = 1;
+    pthread_mutex_lock(&lock);
+    void *p = __libc_malloc(size);
+    if (p != NULL && recording) {
+        put(p, next_id);
+        log_op(AT_MALLOC, next_id++, size);
+    }
+    pthread_mutex_unlock(&lock);
+    inside = 0;
+    return p;
+}
+
+void *calloc(size_t n, size_t size) {
+    if (!recording || inside)
+        return __libc_calloc(n, size);
+    inside = 1;
+    pthread_mutex_lock(&lock);
+    void *p = __libc_calloc(n, size);
+    if (p != NULL && recording) {
+        put(p, next_id);
+        log_op(AT_CALLOC, next_id++, (uint64_t)n * size);
+    }
+    pthread_mutex_unlock(&lock);
+    inside = 0;
+    return p;
+}
+
+void free(void *p) {
+    if (!recording || inside || p == NULL) {
+        __libc_free(p);
+        return;
+    }
+    inside = 1;
+    pthread_mutex_lock(&lock);
+    uint32_t id = recording ? take(p) : 0;
+    if (id != 0)
+        log_op(AT_FREE, id, 0);
+    else
+        unknown_frees++;                 /* allocated before recording began */
+    __libc_free(p);
+    pthread_mutex_unlock(&lock);
+    inside = 0;
+}
+
+void *realloc(void *p, size_t size) {
+    if (!recording || inside)
+        return __libc_realloc(p, size);
+    if (p == NULL)
+        return malloc(size);
+    if (size == 0) {                     /* glibc: frees, returns NULL */
+        free(p);
+        return NULL;
+    }
+    inside = 1;
+    pthread_mutex_lock(&lock);
+    void *q = __libc_realloc(p, size);
+    if (q != NULL && recording) {
+        uint32_t id = take(p);
+        if (id != 0) {
+            put(q, id);
+            log_op(AT_REALLOC, id, size);
+        } else {                         /* unknown block: a fresh object */
+            put(q, next_id);
+            log_op(AT_MALLOC, next_id++, size);
+        }
+    }
+    pthread_mutex_unlock(&lock);
+    inside = 0;
+    return q;
+}
+
+/* ---------- start / stop ---------- */
+
+/* "%p" -> the pid; caller checked that tmpl has one */
+static void trace_path(char *path, size_t len) {
+    const char *pp = strstr(tmpl, "%p");
+    snprintf(path, len, "%.*s%d%s", (int)(pp - tmpl), tmpl, (int)getpid(), pp + 2);
+}
+
+/* an empty trace, after the header, starting now */
+static void trace_begin(void) {
+    at_header h = { .magic = AT_MAGIC };
+    write_all(&h, sizeof h);
+    t0 = mono_ns();
+}
+
+static void fork_prepare(void) { pthread_mutex_lock(&lock); }
+static void fork_parent(void)  { pthread_mutex_unlock(&lock); }
+static void fork_child(void) {
+    if (fd >= 0)
+        close(fd);                       /* the file belongs to the parent */
+    fd = -1;
+    if (recording && tmpl[0] != '\0') {
+        char path[4096];
+        trace_path(path, sizeof path);
+        fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        memset(table, 0, cap * sizeof *table);
+        used = live = nbuf = 0;
+        count = unknown_frees = 0;
+        next_id = 1;
+        next_tid = 0;
+        tid_plus1 = 0;                   /* the only thread left */
+        if (fd >= 0)
+            trace_begin();
+    }
+    recording = fd >= 0;
+    pthread_mutex_unlock(&lock);
+}
+
+__attribute__((constructor)) static void rec_start(void) {
+    const char *env = getenv("ALLOC_TRACE");
+    char path[4096];
+    if (env == NULL)
+        return;
+    const char *pp = strstr(env, "%p");
+    if (pp != NULL) {
+        snprintf(tmpl, sizeof tmpl, "%s", env);
+        trace_path(path, sizeof path);
+    } else {
+        snprintf(path, sizeof path, "%s", env);
+        const char *owner = getenv("ALLOC_TRACE_PID");
+        char me[24];
+        snprintf(me, sizeof me, "%d", (int)getpid());
+        if (owner != NULL && strcmp(owner, me) != 0)
+            return;                      /* started by the owner: not ours */
+        setenv("ALLOC_TRACE_PID", me, 1);
+    }
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    cap = 1u << 16;
+    buf = map(REC_BUF * sizeof *buf);
+    table = map(cap * sizeof *table);
+    if (fd < 0 || buf == NULL || table == NULL) {
+        perror(path);
+        return;
+    }
+    trace_begin();
+    pthread_atfork(fork_prepare, fork_parent, fork_child);
+    recording = 1;
+}
+
+__attribute__((destructor)) static void rec_stop(void) {
+    pthread_mutex_lock(&lock);
+    if (fd >= 0 && recording) {
+        recording = 0;
+        flush();
+        at_header h = { AT_MAGIC, count, next_id - 1, next_tid, 0 };
+        if (pwrite(fd, &h, sizeof h, 0) != (ssize_t)sizeof h)
+            perror("alloc_rec");
+        close(fd);
+        fd = -1;
+        fprintf(stderr, "alloc_rec: %llu events, %u threads, %zu still live, "
+                        "%llu frees of older blocks skipped\n",
+                (unsigned long long)count, next_tid, live,
+                (unsigned long long)unknown_frees);
+    }
+    pthread_mutex_unlock(&lock);
+}
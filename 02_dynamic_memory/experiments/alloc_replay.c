@@ -0,0 +1,461 @@
+/*
+ * alloc_replay.c — drive any lab_alloc.h allocator through a recorded
+ * allocation trace, op for op, and compare throughput, peak RSS and
+ * fragmentation.
+ *
+ *   gcc -O2 -pthread alloc_replay.c -o alloc_replay
+ *   ./alloc_replay                          self-test
+ *   ./alloc_replay gen  server.atr [reqs]   synthetic request/cache/burst trace
+ *   ./alloc_replay info server.atr
+ *   ./alloc_replay run  server.atr [glibc arena ...]   default: all of them
+ *
+ * Built with -DHDR_ENABLE, every call is also timed into an HDR histogram
+ * per op (03_functions/experiments/hdr.h) and run prints p50 / p99 / p99.9
+ * / max for each allocator under the table. The timing costs ~50 ns a call
+ * here, so ns/op is only comparable between builds of the same kind.
+ *
+ * Record a real program with alloc_rec.so (see alloc_rec.c).
+ *
+ * Each allocator replays in a fresh child process, so one allocator's
+ * heap cannot inflate the next one's RSS. The replay is single-threaded,
+ * in the recorded global order: deterministic, but it does not reproduce
+ * contention. Every block gets its id's low byte written at both ends (and
+ * one byte per page) — that makes the pages resident, as real use would,
+ * and lets the replay check that realloc kept the contents and that no
+ * block was overwritten before its free.
+ */
+#define _GNU_SOURCE
+#include "alloc_trace.h"
+#include "lab_alloc.h"
+#include "../../03_functions/experiments/hdr.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* VmRSS / VmHWM in KB, read without stdio so the heap is left alone */
+static size_t status_kb(const char *key) {
+    char text[4096];
+    int fd = open("/proc/self/status", O_RDONLY);
+    ssize_t n = fd < 0 ? -1 : read(fd, text, sizeof text - 1);
+    if (fd >= 0)
+        close(fd);
+    if (n <= 0)
+        return 0;
+    text[n] = '\0';
+    const char *p = strstr(text, key);
+    return p ? strtoul(p + strlen(key), NULL, 10) : 0;
+}
+
+static void *map_zero(size_t len) {
+    void *p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (p == MAP_FAILED) {
+        perror("mmap");
+        exit(1);
+    }
+    return p;
+}
+
+/* ---------- trace in memory ---------- */
+
+typedef struct {
+    at_rec  *rec;
+    size_t   n, cap;
+    uint32_t max_id, threads;
+} trace;
+
+static void push(trace *t, unsigned op, uint32_t id, uint64_t size, uint32_t tid) {
+    if (t->n == t->cap) {
+        t->cap = t->cap ? t->cap * 2 : 1 << 16;
+        t->rec = realloc(t->rec, t->cap * sizeof *t->rec);
+        if (t->rec == NULL) {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    t->rec[t->n] = (at_rec){ (uint64_t)t->n * 50 << 2 | op, size, id, tid };
+    t->n++;
+    if (id > t->max_id)
+        t->max_id = id;
+    if (tid + 1 > t->threads)
+        t->threads = tid + 1;
+}
+
+static int load(const char *path, trace *t) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        perror(path);
+        return -1;
+    }
+    at_header h;
+    if ((size_t)st.st_size < sizeof h || read(fd, &h, sizeof h) != sizeof h
+        || h.magic != AT_MAGIC) {
+        fprintf(stderr, "%s: not an allocation trace\n", path);
+        close(fd);
+        return -1;
+    }
+    size_t n = ((size_t)st.st_size - sizeof h) / sizeof(at_rec);
+    if (h.count != 0 && h.count < n)
+        n = h.count;                     /* count == 0: recorder never closed */
+    char *m = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (m == MAP_FAILED) {
+        perror("mmap");
+        return -1;
+    }
+    *t = (trace){ (at_rec *)(m + sizeof h), n, 0, 0, h.threads };
+    for (size_t i = 0; i < n; i++)       /* also faults the file in */
+        if (t->rec[i].id > t->max_id)
+            t->max_id = t->rec[i].id;
+    return 0;
+}
+
+/* ---------- synthetic trace: requests, a cache, and bursts ---------- */
+
+static uint64_t rng = 0x9E3779B97F4A7C15ULL;
+static uint32_t rnd(uint32_t n) {
+    rng ^= rng << 13, rng ^= rng >> 7, rng ^= rng << 17;
+    return (uint32_t)(rng % n);
+}
+
+/*
+ * Each request allocates 3-8 short strings and one buffer that grows by
+ * realloc doubling to 256 B .. 32 KB; 1 in 64 also takes a 128 KB - 2 MB
+ * block. At the end one string in 8 moves into a 20000-entry cache (random
+ * eviction), the rest is freed. Every 20000 requests a burst of 5000 keeps
+ * its strings until the burst ends — the live set spikes, then collapses.
+ */
+static void generate(trace *t, uint32_t requests) {
+    enum { CACHE = 20000, BURST_EVERY = 20000, BURST_LEN = 5000 };
+    static uint32_t cache[CACHE];
+    uint32_t *held = NULL;
+    size_t nheld = 0, capheld = 0;
+    uint32_t id = 0;
+
+    for (uint32_t r = 0; r < requests; r++) {
+        uint32_t tid = r % 4;
+        int burst = r % BURST_EVERY >= BURST_EVERY - BURST_LEN;
+        uint32_t str[8], ns = 3 + rnd(6);
+
+        for (uint32_t i = 0; i < ns; i++) {
+            str[i] = ++id;
+            push(t, AT_MALLOC, id, 16 + rnd(rnd(4) ? 48 : 240), tid);
+        }
+        uint32_t buf = ++id;
+        uint64_t size = 64, target = 256u << rnd(8);
+        push(t, AT_CALLOC, buf, size, tid);
+        while (size < target)
+            push(t, AT_REALLOC, buf, size *= 2, tid);
+        if (rnd(64) == 0) {
+            push(t, AT_MALLOC, ++id, (128u << 10) + rnd(2u << 20), tid);
+            push(t, AT_FREE, id, 0, tid);
+        }
+        push(t, AT_FREE, buf, 0, tid);
+
+        for (uint32_t i = 0; i < ns; i++) {
+            if (i == 0 && rnd(8) == 0) {
+                uint32_t *slot = &cache[rnd(CACHE)];
+                if (*slot)
+                    push(t, AT_FREE, *slot, 0, tid);
+                *slot = str[i];
+            } else if (burst) {
+                if (nheld == capheld) {
+                    capheld = capheld ? capheld * 2 : 4096;
+                    held = realloc(held, capheld * sizeof *held);
+                    if (held == NULL) {
+                        perror("realloc");
+                        exit(1);
+                    }
+                }
+                held[nheld++] = str[i];
+            } else {
+                push(t, AT_FREE, str[i], 0, tid);
+            }
+        }
+        if (r % BURST_EVERY == BURST_EVERY - 1) {
+            for (size_t i = 0; i < nheld; i++)
+                push(t, AT_FREE, held[i], 0, tid);
+            nheld = 0;
+        }
+    }
+    free(held);
+}
+
+static int save(const char *path, const trace *t) {
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) {
+        perror(path);
+        return -1;
+    }
+    at_header h = { AT_MAGIC, t->n, t->max_id, t->threads, 0 };
+    fwrite(&h, sizeof h, 1, f);
+    fwrite(t->rec, sizeof *t->rec, t->n, f);
+    if (fclose(f) != 0) {
+        perror(path);
+        return -1;
+    }
+    return 0;
+}
+
+/* ---------- replay ---------- */
+
+typedef struct {
+    double   sec;
+    size_t   ops;
+    uint64_t peak_live, end_live;        /* requested bytes */
+    size_t   peak_rss;                   /* bytes above the pre-replay RSS */
+    int64_t  end_rss;                    /* same, < 0 if pages went back */
+    size_t   footprint;                  /* allocator's own count, at the end */
+} replay_result;
+
+static void mark(unsigned char *p, uint64_t from, uint64_t to, unsigned char tag) {
+    for (uint64_t o = from; o < to; o += 4096)
+        p[o] = tag;
+    if (to > 0)
+        p[to - 1] = tag;                 /* also after a shrinking realloc */
+}
+
+static void check(const unsigned char *p, uint64_t size, uint32_t id, const char *what) {
+    if (size && (p[0] != (unsigned char)id || p[size - 1] != (unsigned char)id)) {
+        fprintf(stderr, "replay: object %u (%llu bytes) corrupted at %s\n",
+                id, (unsigned long long)size, what);
+        abort();
+    }
+}
+
+static _Noreturn void oom(const lab_allocator *a, size_t i) {
+    fprintf(stderr, "%s: out of memory at record %zu\n", a->name, i);
+    exit(1);
+}
+
+static hdr_hist replay_lat[4] = { HDR_HIST("malloc"), HDR_HIST("calloc"),
+                                  HDR_HIST("realloc"), HDR_HIST("free") };   /* by AT_* */
+
+static replay_result replay(const lab_allocator *a, const trace *t) {
+    unsigned char **obj = map_zero(((size_t)t->max_id + 1) * sizeof *obj);
+    uint64_t *sz = map_zero(((size_t)t->max_id + 1) * sizeof *sz);
+    replay_result res = { .ops = t->n };
+    uint64_t live = 0, sum = 0;
+
+    /* a forked child maps the trace lazily: fault it in before the baseline */
+    for (size_t i = 0; i < t->n; i++)
+        sum += t->rec[i].size;
+    __asm__ volatile("" :: "r"(sum));
+    size_t base = status_kb("VmRSS:");
+
+    double t0 = now_sec();
+    for (size_t i = 0; i < t->n; i++) {
+        const at_rec *r = &t->rec[i];
+        uint32_t id = r->id;
+        unsigned char *p = obj[id];
+
+        switch (at_op(r)) {
+        case AT_MALLOC:
+        case AT_CALLOC:
+            if (p != NULL)               /* id reused: trace is corrupt */
+                continue;
+            if (at_op(r) == AT_MALLOC)
+                HDR_TIME(&replay_lat[AT_MALLOC], p = a->malloc(r->size));
+            else
+                HDR_TIME(&replay_lat[AT_CALLOC], p = a->calloc(1, r->size));
+            if (p == NULL && r->size)
+                oom(a, i);
+            mark(p, 0, r->size, (unsigned char)id);
+            obj[id] = p;
+            live += sz[id] = r->size;
+            break;
+        case AT_REALLOC:
+            if (p == NULL)
+                continue;
+            check(p, sz[id], id, "realloc");
+            HDR_TIME(&replay_lat[AT_REALLOC], p = a->realloc(p, r->size));
+            if (p == NULL)
+                oom(a, i);
+            check(p, 1, id, "realloc (contents not kept)");
+            mark(p, sz[id] < r->size ? sz[id] : r->size, r->size, (unsigned char)id);
+            obj[id] = p;
+            live += r->size - sz[id];
+            sz[id] = r->size;
+            break;
+        case AT_FREE:
+            if (p == NULL)
+                continue;
+            check(p, sz[id], id, "free");
+            HDR_TIME(&replay_lat[AT_FREE], a->free(p));
+            obj[id] = NULL;
+            live -= sz[id];
+            break;
+        }
+        if (live > res.peak_live)
+            res.peak_live = live;
+    }
+    res.sec = now_sec() - t0;
+    res.end_live = live;
+    res.peak_rss = (status_kb("VmHWM:") - base) * 1024;
+    res.end_rss = ((int64_t)status_kb("VmRSS:") - (int64_t)base) * 1024;
+    res.footprint = a->footprint();
+
+    for (uint32_t id = 0; id <= t->max_id; id++)
+        a->free(obj[id]);
+    return res;
+
+}
+
+static double mb(double bytes) { return bytes / (1 << 20); }
+
+static void print_row(const char *name, const replay_result *r) {
+    printf("%-8s %8.2f %7.1f %9.1f %9.1f %6.1f%% %9.1f %9.1f %9.1f\n",
+           name, (double)r->ops / r->sec * 1e-6, r->sec * 1e9 / (double)r->ops,
+           mb((double)r->peak_live), mb((double)r->peak_rss),
+           r->peak_rss ? 100.0 * (1.0 - (double)r->peak_live / (double)r->peak_rss) : 0.0,
+           mb((double)r->end_live), mb((double)r->end_rss), mb((double)r->footprint));
+}
+
+/* the child's latency table, kept in a shared page until the parent has
+ * printed every throughput row */
+static void print_latency(char *slot, size_t len, const char *name) {
+#ifdef HDR_ENABLE
+    FILE *f = fmemopen(slot, len, "w");
+    if (f == NULL)
+        return;
+    static hdr_counts c;
+    fprintf(f, "%s\n", name);
+    for (int op = AT_MALLOC; op <= AT_FREE; op++) {
+        hdr_merge(&replay_lat[op], &c);
+        if (c.n)
+            hdr_print(f, replay_lat[op].name, &c, hdr_ns_per_tick());
+    }
+    fclose(f);
+#else
+    (void)slot, (void)len, (void)name;
+#endif
+}
+
+static int run(const trace *t, const char *const *names, int nnames) {
+    printf("%zu ops, %u objects, %u threads (replayed on one)\n",
+           t->n, t->max_id, t->threads);
+    if (t->n == 0) {
+        puts("empty trace");
+        return 0;
+    }
+    printf("%-8s %8s %7s %9s %9s %7s %9s %9s %9s\n", "alloc", "Mops/s", "ns/op",
+           "peak live", "peak RSS", "frag", "end live", "end RSS", "footprnt");
+    enum { SLOT = 1024 };
+    char *text = mmap(NULL, (size_t)nnames * SLOT, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (text == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+    for (int i = 0; i < nnames; i++) {
+        const lab_allocator *a = lab_find(names[i]);
+        if (a == NULL) {
+            fprintf(stderr, "unknown allocator %s\n", names[i]);
+            return 1;
+        }
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid == 0) {
+            replay_result r = replay(a, t);
+            print_row(a->name, &r);
+            fflush(stdout);
+            print_latency(text + (size_t)i * SLOT, SLOT, a->name);
+            _exit(0);
+        }
+        int status;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            fprintf(stderr, "%s: replay failed\n", a->name);
+            return 1;
+        }
+    }
+#ifdef HDR_ENABLE
+    printf("\nlatency per call, every call timed\n");
+    hdr_print_header(stdout);
+    for (int i = 0; i < nnames; i++)
+        fputs(text + (size_t)i * SLOT, stdout);
+#endif
+    munmap(text, (size_t)nnames * SLOT);
+    return 0;
+}
+
+static void info(const trace *t) {
+    size_t ops[4] = { 0 };
+    uint64_t bytes = 0;
+    for (size_t i = 0; i < t->n; i++) {
+        ops[at_op(&t->rec[i])]++;
+        if (at_op(&t->rec[i]) != AT_FREE)
+            bytes += t->rec[i].size;
+    }
+    double span = t->n ? (double)at_ns(&t->rec[t->n - 1]) * 1e-9 : 0;
+    printf("%zu records over %.3f s, %u objects, %u threads\n",
+           t->n, span, t->max_id, t->threads);
+    printf("malloc %zu  calloc %zu  realloc %zu  free %zu  requested %.1f MB\n",
+           ops[AT_MALLOC], ops[AT_CALLOC], ops[AT_REALLOC], ops[AT_FREE], mb((double)bytes));
+}
+
+int main(int argc, char **argv) {
+    trace t = { 0 };
+
+    if (argc >= 3 && strcmp(argv[1], "gen") == 0) {
+        generate(&t, argc > 3 ? (uint32_t)atoi(argv[3]) : 200000);
+        if (save(argv[2], &t) != 0)
+            return 1;
+        info(&t);
+        return 0;
+    }
+    if (argc >= 3 && (strcmp(argv[1], "run") == 0 || strcmp(argv[1], "info") == 0)) {
+        if (load(argv[2], &t) != 0)
+            return 1;
+        if (argv[1][0] == 'i') {
+            info(&t);
+            return 0;
+        }
+        const char *all[8];
+        int n = 0;
+        while (lab_allocators[n] && n < 8) {
+            all[n] = lab_allocators[n]->name;
+            n++;
+        }
+        return argc > 3 ? run(&t, (const char *const *)argv + 3, argc - 3)
+                        : run(&t, all, n);
+    }
+    if (argc > 1) {
+        fprintf(stderr, "usage: %s [gen|info|run] trace.atr ...\n", argv[0]);
+        return 2;
+    }
+
+    /* self-test: a small synthetic trace through every allocator, with the
+     * content checks on; then the same trace through a file round trip */
+    generate(&t, 25000);
+    for (int i = 0; lab_allocators[i]; i++)
+        replay(lab_allocators[i], &t);
+    char path[] = "/tmp/alloc_replay_XXXXXX";
+    int fd = mkstemp(path);
+    trace back;
+    if (fd < 0 || save(path, &t) != 0 || load(path, &back) != 0
+        || back.n != t.n || back.max_id != t.max_id
+        || memcmp(back.rec, t.rec, t.n * sizeof *t.rec) != 0) {
+        fprintf(stderr, "self-test: trace file round trip failed\n");
+        return 1;
+    }
+    close(fd);
+    unlink(path);
+    free(t.rec);
+    puts("self-test: ok");
+    return 0;
+}
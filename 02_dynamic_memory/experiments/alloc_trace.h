@@ -0,0 +1,40 @@
+/*
+ * alloc_trace.h — binary allocation trace shared by alloc_rec.c (writer)
+ * and alloc_replay.c (reader).
+ *
+ *   file   = at_header, then at_rec[count]        little-endian, native
+ *   at_rec = 24 bytes { ns << 2 | op, size, id, tid }
+ *
+ * Objects are named by an id, not an address: the recorder gives every
+ * allocation the next id, realloc keeps it, free retires it. A replay
+ * therefore needs only an id -> pointer table, whatever addresses the
+ * allocator under test hands out.
+ */
+#ifndef ALLOC_TRACE_H
+#define ALLOC_TRACE_H
+
+#include <stdint.h>
+
+#define AT_MAGIC 0x3130454341525441ULL    /* "ATRACE01" */
+
+enum { AT_MALLOC, AT_CALLOC, AT_REALLOC, AT_FREE };
+
+typedef struct {
+    uint64_t magic;
+    uint64_t count;        /* records; 0 if the writer died before closing */
+    uint64_t max_id;
+    uint32_t threads;
+    uint32_t pad;
+} at_header;
+
+typedef struct {
+    uint64_t stamp;        /* ns since recording started << 2 | op */
+    uint64_t size;         /* requested bytes (calloc: n * size); 0 for free */
+    uint32_t id;
+    uint32_t tid;          /* 0, 1, 2 ... in order of each thread's first call */
+} at_rec;
+
+static inline unsigned at_op(const at_rec *r) { return (unsigned)(r->stamp & 3); }
+static inline uint64_t at_ns(const at_rec *r) { return r->stamp >> 2; }
+
+#endif /* ALLOC_TRACE_H */
@@ -0,0 +1,177 @@
+/*
+ * batch_bench.c — lab_malloc_batch / lab_free_batch against N single calls.
+ *
+ *   gcc -O2 -pthread batch_bench.c -o batch_bench
+ *   ./batch_bench [objects]            default 1M objects per cell
+ *
+ * Two patterns, each run for batch sizes 8 .. 4096:
+ *   rows   n rows of 32 bytes (a jagged array's rows, struct pointers)
+ *   names  n strings of 8..200 bytes, allocated one by one as they are
+ *          read; only the free is batched (every size class mixed)
+ * Cells are ns per object for one malloc + one free, best of 5.
+ */
+#define _GNU_SOURCE
+#include "lab_alloc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void fail(const char *a, const char *what) {
+    fprintf(stderr, "self-test: %s: %s\n", a, what);
+    exit(1);
+}
+
+static int by_addr(const void *x, const void *y) {
+    uintptr_t a = (uintptr_t)*(void *const *)x, b = (uintptr_t)*(void *const *)y;
+    return (a > b) - (a < b);
+}
+
+static size_t name_len(size_t i) {                 /* 8 .. 200, spread */
+    return 8 + (i * 2654435761u >> 7) % 193;
+}
+
+/* ---------- self-test ---------- */
+
+static void self_test(const lab_allocator *a) {
+    enum { N = 1000 };
+    static void *v[N], *w[N];
+
+    if (lab_malloc_batch(a, 40, N, v) != N)
+        fail(a->name, "malloc_batch came back short");
+    for (size_t i = 0; i < N; i++)
+        memcpy(v[i], &i, sizeof i);
+    for (size_t i = 0; i < N; i++)
+        if (memcmp(v[i], &i, sizeof i) != 0)
+            fail(a->name, "batch blocks overlap");
+    lab_free_batch(a, v, N);
+
+    /* the freed run is what the next batch of the same class gets */
+    if (strcmp(a->name, "glibc") != 0) {
+        lab_malloc_batch(a, 48, N, w);
+        qsort(v, N, sizeof *v, by_addr);
+        qsort(w, N, sizeof *w, by_addr);
+        if (memcmp(v, w, sizeof v) != 0)
+            fail(a->name, "free_batch lost blocks");
+        lab_free_batch(a, w, N);
+    }
+
+    /* every class, large blocks and NULL slots in one free_batch */
+    for (int round = 0; round < 2; round++) {
+        size_t before = a->footprint();
+        for (size_t i = 0; i < N; i++) {
+            size_t n = i % 97 == 0 ? 70000 + i : name_len(i) * (i % 7 + 1);
+            v[i] = i % 13 == 0 ? NULL : a->malloc(n);
+            if (v[i] != NULL)
+                memset(v[i], (int)i, n);
+        }
+        lab_free_batch(a, v, N);
+        if (round == 1 && strcmp(a->name, "glibc") != 0 && a->footprint() != before)
+            fail(a->name, "second round grew the heap");
+    }
+
+    /* SAFER_FREE for arrays: slots are NULL afterwards, a second pass is a no-op */
+    char *names[64];
+    for (size_t i = 0; i < 64; i++)
+        snprintf(names[i] = a->malloc(name_len(i)), name_len(i), "name %zu", i);
+    LAB_SAFER_FREE_BATCH(a, names, 64);
+    for (size_t i = 0; i < 64; i++)
+        if (names[i] != NULL)
+            fail(a->name, "safer batch left a slot set");
+    LAB_SAFER_FREE_BATCH(a, names, 64);
+}
+
+/* ---------- timing ---------- */
+
+typedef enum { SINGLE, BATCH } mode;
+
+/* ns per object: malloc + free of `batch` objects, repeated to `total` */
+static double rows(const lab_allocator *a, void **v, size_t batch, size_t total, mode m) {
+    double best = 1e9;
+    for (int r = 0; r < 5; r++) {
+        double t = now_sec();
+        for (size_t done = 0; done < total; done += batch) {
+            if (m == BATCH) {
+                if (lab_malloc_batch(a, 32, batch, v) != batch)
+                    abort();
+                lab_free_batch(a, v, batch);
+            } else {
+                for (size_t i = 0; i < batch; i++)
+                    if ((v[i] = a->malloc(32)) == NULL)
+                        abort();
+                for (size_t i = 0; i < batch; i++)
+                    a->free(v[i]);
+            }
+        }
+        t = (now_sec() - t) / (double)total * 1e9;
+        if (t < best)
+            best = t;
+    }
+    return best;
+}
+
+static double names(const lab_allocator *a, void **v, size_t batch, size_t total, mode m) {
+    double best = 1e9;
+    for (int r = 0; r < 5; r++) {
+        double t = now_sec();
+        for (size_t done = 0; done < total; done += batch) {
+            for (size_t i = 0; i < batch; i++)
+                if ((v[i] = a->malloc(name_len(done + i))) == NULL)
+                    abort();
+            if (m == BATCH) {
+                lab_free_batch(a, v, batch);
+            } else {
+                for (size_t i = 0; i < batch; i++)
+                    a->free(v[i]);
+            }
+        }
+        t = (now_sec() - t) / (double)total * 1e9;
+        if (t < best)
+            best = t;
+    }
+    return best;
+}
+
+int main(int argc, char **argv) {
+    size_t total = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+    static const size_t batches[] = { 8, 64, 512, 4096 };
+    enum { NB = sizeof batches / sizeof batches[0] };
+    static void *v[4096];
+
+    for (int k = 0; lab_allocators[k]; k++)
+        self_test(lab_allocators[k]);
+    puts("self-test: ok");
+
+    double (*const pattern[2])(const lab_allocator *, void **, size_t, size_t, mode) = {
+        rows, names,
+    };
+    static const char *const title[2] = {
+        "rows: 32-byte objects, malloc_batch + free_batch",
+        "names: 8..200-byte strings, malloc one by one, free_batch",
+    };
+    for (int pt = 0; pt < 2; pt++) {
+        printf("\n%s, ns per object (single / batch)\n", title[pt]);
+        printf("%-8s", "batch");
+        for (int b = 0; b < NB; b++)
+            printf(" %15zu", batches[b]);
+        putchar('\n');
+        for (int k = 0; lab_allocators[k]; k++) {
+            const lab_allocator *a = lab_allocators[k];
+            printf("%-8s", a->name);
+            for (int b = 0; b < NB; b++) {
+                double s = pattern[pt](a, v, batches[b], total, SINGLE);
+                double bt = pattern[pt](a, v, batches[b], total, BATCH);
+                printf("    %5.1f / %5.1f", s, bt);
+            }
+            putchar('\n');
+        }
+    }
+    return 0;
+}
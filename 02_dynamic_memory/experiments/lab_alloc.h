@@ -0,0 +1,1263 @@
+/*
+ * lab_alloc.h — the lab's allocators behind one table of function pointers,
+ * so benchmarks and the trace replayer can drive any of them:
+ *
+ *   lab_glibc   malloc/calloc/realloc/free from the C library
+ *   lab_arena   size-class free lists carved from 1 MB chunks; every block
+ *               carries a 16-byte header in front (note 02 §6), one mutex;
+ *               blocks over 64 KB are mmap'd singly and grown with mremap
+ *   lab_pagemap the same size classes without headers: each page belongs to
+ *               a slab of one class, and a two-level radix page map turns
+ *               a pointer into its class
+ *
+ *   const lab_allocator *a = lab_find("arena");
+ *   void *p = a->malloc(100);
+ *   a->free(p);                     or  lab_free_sized(a, p, 100);
+ *
+ *   void *row[64];                  one lock for the whole batch:
+ *   lab_malloc_batch(a, 32, 64, row);
+ *   lab_free_batch(a, row, 64);     or  LAB_SAFER_FREE_BATCH(a, row, 64);
+ *
+ *   lab_counts k = a->counts();     mallocs/frees per size class, every
+ *                                   build (lab_stats.h publishes them)
+ *
+ *   lab_purger_start(a, (lab_purge_opts){ .decay_ms = 100, .interval_ms = 10,
+ *                                         .advice = MADV_DONTNEED });
+ *                                   idle free pages go back to the OS
+ *
+ *   if (!LAB_FAST_TEARDOWN)         at exit: free everything only in
+ *       free_everything(db);        LAB_LEAK_CHECK builds, then report
+ *   lab_exit(a, 0);                 what is left; else just _exit()
+ *
+ * Header-only; define _GNU_SOURCE before including it.
+ */
+#ifndef LAB_ALLOC_H
+#define LAB_ALLOC_H
+
+#include <malloc.h>         /* mallinfo2 */
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef struct {
+    size_t blocks, bytes;            /* bytes: usable size of those blocks */
+} lab_usage;
+
+/* Debug builds (-DLAB_LEAK_CHECK) count live blocks in the locked paths. */
+#ifdef LAB_LEAK_CHECK
+#define LAB_COUNT(g, nblocks, nbytes) \
+    ((g).live.blocks += (size_t)(nblocks), (g).live.bytes += (size_t)(nbytes))
+#else
+#define LAB_COUNT(g, nblocks, nbytes) ((void)(nblocks), (void)(nbytes))
+#endif
+
+#define LAB_CLASSES 48u              /* small size classes of arena and pagemap */
+
+/* Per size class, counted in the same locked sections in every build: a
+ * plain add per call. Index LAB_CLASSES is the large blocks. Live blocks
+ * of a class are mallocs - frees. */
+typedef struct {
+    uint64_t mallocs[LAB_CLASSES + 1];
+    uint64_t frees[LAB_CLASSES + 1];
+    size_t   large_bytes;            /* usable bytes of live large blocks */
+    size_t   chunks;                 /* chunk mappings the slabs come from */
+} lab_counts;
+
+typedef struct {
+    const char *name;
+    void  *(*malloc)(size_t size);
+    void  *(*calloc)(size_t n, size_t size);
+    void  *(*realloc)(void *p, size_t size);
+    void   (*free)(void *p);
+    void   (*free_sized)(void *p, size_t size);   /* C23 free_sized() */
+    size_t (*malloc_batch)(size_t size, size_t n, void **out);
+    void   (*free_batch)(void **ptrs, size_t n);
+    lab_usage (*live)(void);         /* LAB_LEAK_CHECK builds, else zeros */
+    lab_counts (*counts)(void);      /* per size class; glibc: zeros */
+    size_t (*purge)(uint64_t idle_ns);   /* free pages idle that long -> OS */
+    size_t (*footprint)(void);       /* bytes currently held from the OS */
+} lab_allocator;
+
+/* C23-style sized free: size must be the one last passed to malloc, calloc
+ * (n * size) or realloc for p. Lets an allocator skip its size lookup. */
+static inline void lab_free_sized(const lab_allocator *a, void *p, size_t size) {
+    a->free_sized(p, size);
+}
+
+/* n blocks of one size into out[0..n-1]. Returns how many were allocated:
+ * fewer than n only when memory ran out; out[ret..n-1] are left alone. */
+static inline size_t lab_malloc_batch(const lab_allocator *a, size_t size, size_t n,
+                                      void **out) {
+    return a->malloc_batch(size, n, out);
+}
+
+/* Frees ptrs[0..n-1], any mix of sizes; NULL slots are skipped. */
+static inline void lab_free_batch(const lab_allocator *a, void **ptrs, size_t n) {
+    a->free_batch(ptrs, n);
+}
+
+/* SAFER_FREE for a whole array (03_functions note 07): free, then null
+ * every slot so a second pass is a no-op. */
+static inline void lab_safer_free_batch(const lab_allocator *a, void **ptrs, size_t n) {
+    if (ptrs == NULL)
+        return;
+    a->free_batch(ptrs, n);
+    memset(ptrs, 0, n * sizeof *ptrs);
+}
+
+#define LAB_SAFER_FREE_BATCH(a, arr, n) lab_safer_free_batch((a), (void **)(arr), (n))
+
+/* ---------- glibc ---------- */
+
+static inline size_t glibc_footprint(void) {
+    struct mallinfo2 mi = mallinfo2();
+    return mi.arena + mi.hblkhd;     /* sbrk heap + mmap'd blocks */
+}
+
+static inline void glibc_free_sized(void *p, size_t size) {
+    (void)size;                      /* free_sized() arrives with glibc 2.39+ */
+    free(p);
+}
+
+static inline size_t glibc_malloc_batch(size_t size, size_t n, void **out) {
+    for (size_t i = 0; i < n; i++)   /* no batch entry point: one call each */
+        if ((out[i] = malloc(size)) == NULL)
+            return i;
+    return n;
+}
+
+static inline void glibc_free_batch(void **ptrs, size_t n) {
+    for (size_t i = 0; i < n; i++)
+        free(ptrs[i]);
+}
+
+static inline lab_usage glibc_live(void) {
+    return (lab_usage){ 0, 0 };      /* no block count: use LeakSanitizer */
+}
+
+static inline lab_counts glibc_counts(void) {
+    return (lab_counts){ { 0 }, { 0 }, 0, 0 };   /* mallinfo2 has totals only */
+}
+
+static inline size_t glibc_purge(uint64_t idle_ns) {
+    (void)idle_ns;                   /* no free times: all free pages, now */
+    malloc_trim(0);
+    return 0;                        /* glibc does not say how much */
+}
+
+static const lab_allocator lab_glibc = {
+    "glibc", malloc, calloc, realloc, free, glibc_free_sized,
+    glibc_malloc_batch, glibc_free_batch, glibc_live, glibc_counts, glibc_purge,
+    glibc_footprint,
+};
+
+/* ---------- arena: header + size-class free lists ---------- */
+
+#define ARENA_CHUNK     (1u << 20)
+#define ARENA_SMALL_MAX (64u << 10)   /* larger blocks get their own mmap */
+#define ARENA_CLASSES   LAB_CLASSES   /* 16..256 by 16, then 4 per power of 2 */
+#define ARENA_LARGE     UINT64_MAX
+
+typedef struct {
+    uint64_t size;                   /* usable bytes */
+    uint64_t cls;                    /* size class, or ARENA_LARGE */
+} arena_hdr;                         /* 16 bytes: payload stays 16-aligned */
+
+typedef struct arena_chunk {
+    struct arena_chunk *next;
+    uint64_t pad;
+} arena_chunk;
+
+static struct {
+    pthread_mutex_t lock;
+    char           *cur, *end;       /* bump region of the newest chunk */
+    arena_hdr      *free[ARENA_CLASSES];  /* next link in the payload */
+    arena_chunk    *chunks;
+    size_t          mapped;          /* chunks + large blocks */
+    lab_usage       live;            /* LAB_LEAK_CHECK */
+    lab_counts      counts;
+} arena_g = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static inline unsigned arena_class(size_t n) {      /* 1 <= n <= SMALL_MAX */
+    if (n <= 256)
+        return (unsigned)((n + 15) >> 4) - 1;
+    unsigned lg = 63u - (unsigned)__builtin_clzll(n - 1);   /* 2^lg < n */
+    return 16 + (lg - 8) * 4 + (unsigned)((n - 1) >> (lg - 2) & 3);
+}
+
+static inline size_t arena_class_size(unsigned c) {
+    if (c < 16)
+        return (size_t)(c + 1) * 16;
+    unsigned lg = 8 + (c - 16) / 4;
+    return (size_t)(5 + (c - 16) % 4) << (lg - 2);
+}
+
+static inline size_t arena_page_round(size_t n) {
+    return (n + 4095) & ~(size_t)4095;
+}
+
+/*
+ * Large blocks: one mapping each, header in front. A freed one is not
+ * unmapped but parked in a small cache, pages still resident, so the next
+ * large malloc skips mmap and the page faults. Resident pages nobody uses
+ * are the price; each parked block decays: once it has been free for
+ * decay_ms its pages are madvise()d away. The mapping stays, so reusing it
+ * costs faults but no syscall. Large frees apply the decay as they go;
+ * lab_purger_start() also applies it on a timer, for the idle periods.
+ */
+#define LARGE_CACHE     32u           /* parked blocks; the oldest is unmapped */
+#define LARGE_SPLIT_MIN (128u << 10)  /* a longer tail than this is kept apart */
+#define LAB_DECAY_MS    1000          /* default; lab_decay_set() changes it */
+
+/* who parked a block: its resident pages count in that footprint() only */
+enum { LARGE_ARENA, LARGE_PM, LARGE_OWNERS };
+
+typedef struct {
+    char    *base;                   /* mapping start; NULL: empty slot */
+    size_t   len;
+    uint64_t freed_ns;
+    int      dirty;                  /* pages resident, contents stale */
+    int      zero;                   /* MADV_DONTNEED'd: reads back as zeros */
+    int      owner;                  /* LARGE_ARENA or LARGE_PM */
+} large_slot;
+
+typedef struct {
+    uint64_t hits, misses;           /* large mallocs served from the cache;
+                                        a miss grows a parked block if any */
+    uint64_t purged;                 /* bytes madvise()d, ever */
+    size_t   dirty, cached;          /* bytes parked: resident / all */
+} lab_large_stats;
+
+static struct {
+    pthread_mutex_t lock;
+    large_slot      slot[LARGE_CACHE];
+    int             decay_ms;        /* 0: purge at free, -1: never */
+    int             advice;          /* MADV_DONTNEED or MADV_FREE */
+    lab_large_stats st;
+    size_t          dirty[LARGE_OWNERS];   /* st.dirty, by owner */
+} large_g = { .lock = PTHREAD_MUTEX_INITIALIZER, .decay_ms = LAB_DECAY_MS,
+              .advice = MADV_DONTNEED };
+
+static inline uint64_t lab_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/* caller holds large_g.lock: bytes of s are no longer resident and parked */
+static inline void large_undirty(const large_slot *s, size_t bytes) {
+    large_g.st.dirty -= bytes;
+    large_g.dirty[s->owner] -= bytes;
+}
+
+/* caller holds large_g.lock; madvise under it, so no one reuses the block meanwhile */
+static inline size_t large_purge_locked(uint64_t freed_before) {
+    size_t bytes = 0;
+    for (unsigned i = 0; i < LARGE_CACHE; i++) {
+        large_slot *s = &large_g.slot[i];
+        if (s->base == NULL || !s->dirty || s->freed_ns > freed_before)
+            continue;
+        madvise(s->base, s->len, large_g.advice);
+        large_undirty(s, s->len);
+        s->dirty = 0;
+        s->zero = large_g.advice == MADV_DONTNEED;
+        bytes += s->len;
+    }
+    large_g.st.purged += bytes;
+    return bytes;
+}
+
+/* Gives back the pages of parked blocks free for at least idle_ns. */
+static inline size_t lab_large_purge(uint64_t idle_ns) {
+    uint64_t now = lab_now_ns();
+    pthread_mutex_lock(&large_g.lock);
+    size_t bytes = large_purge_locked(now > idle_ns ? now - idle_ns : 0);
+    pthread_mutex_unlock(&large_g.lock);
+    return bytes;
+}
+
+/* decay_ms: 0 purges at free, -1 never; advice: MADV_DONTNEED or MADV_FREE */
+static inline void lab_decay_set(int decay_ms, int advice) {
+    pthread_mutex_lock(&large_g.lock);
+    large_g.decay_ms = decay_ms;
+    large_g.advice = advice;
+    pthread_mutex_unlock(&large_g.lock);
+}
+
+/* the current decay_ms; *advice gets the madvise() advice */
+static inline int lab_decay_get(int *advice) {
+    pthread_mutex_lock(&large_g.lock);
+    int ms = large_g.decay_ms;
+    *advice = large_g.advice;
+    pthread_mutex_unlock(&large_g.lock);
+    return ms;
+}
+
+static inline lab_large_stats lab_large_get_stats(void) {
+    pthread_mutex_lock(&large_g.lock);
+    lab_large_stats st = large_g.st;
+    pthread_mutex_unlock(&large_g.lock);
+    return st;
+}
+
+/* resident bytes parked by one allocator */
+static inline size_t large_dirty(int owner) {
+    pthread_mutex_lock(&large_g.lock);
+    size_t d = large_g.dirty[owner];
+    pthread_mutex_unlock(&large_g.lock);
+    return d;
+}
+
+/*
+ * Best fit from the cache; a long tail stays parked as a block of its own.
+ * Nothing long enough: the longest parked block is grown with mremap, so
+ * only the added pages fault in.
+ */
+static inline arena_hdr *large_take(size_t len, int *zero) {
+    pthread_mutex_lock(&large_g.lock);
+    large_slot *best = NULL, *longest = NULL;
+    for (unsigned i = 0; i < LARGE_CACHE; i++) {
+        large_slot *s = &large_g.slot[i];
+        if (s->base == NULL)
+            continue;
+        if (s->len >= len && (best == NULL || s->len < best->len))
+            best = s;
+        if (longest == NULL || s->len > longest->len)
+            longest = s;
+    }
+    if (best == NULL) {
+        large_slot grow = longest ? *longest : (large_slot){ 0 };
+        if (longest != NULL) {
+            longest->base = NULL;
+            large_g.st.cached -= grow.len;
+            if (grow.dirty)
+                large_undirty(&grow, grow.len);
+        }
+        large_g.st.misses++;
+        pthread_mutex_unlock(&large_g.lock);
+        if (grow.base == NULL)
+            return NULL;
+        arena_hdr *h = mremap(grow.base, grow.len, len, MREMAP_MAYMOVE);
+        if (h == MAP_FAILED) {
+            munmap(grow.base, grow.len);
+            return NULL;
+        }
+        *zero = grow.zero;                             /* new pages are zero */
+        h->size = len - sizeof(arena_hdr);
+        return h;
+    }
+    large_g.st.hits++;
+    arena_hdr *h = (arena_hdr *)best->base;
+    *zero = best->zero;
+    size_t take = best->len - len >= LARGE_SPLIT_MIN ? len : best->len;
+    large_g.st.cached -= take;
+    if (best->dirty)
+        large_undirty(best, take);
+    best->base += take;
+    best->len -= take;
+    if (best->len == 0)
+        best->base = NULL;
+    pthread_mutex_unlock(&large_g.lock);
+    h->size = take - sizeof(arena_hdr);
+    return h;
+}
+
+static inline void *large_map(size_t n, int zero) {
+    if (n > SIZE_MAX - 4096 - sizeof(arena_hdr))
+        return NULL;
+    size_t len = arena_page_round(n + sizeof(arena_hdr));
+    int was_zero = 0;
+    arena_hdr *h = large_take(len, &was_zero);
+    if (h != NULL) {
+        if (zero && !was_zero)
+            memset(h + 1, 0, h->size);
+    } else {
+        h = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (h == MAP_FAILED)
+            return NULL;
+        h->size = len - sizeof(arena_hdr);
+    }
+    h->cls = ARENA_LARGE;
+    return h + 1;
+}
+
+static inline size_t large_len(const void *p) {
+    return ((const arena_hdr *)p - 1)->size + sizeof(arena_hdr);
+}
+
+static inline void *large_remap(void *p, size_t n) {   /* the kernel moves */
+    if (n > SIZE_MAX - 4096 - sizeof(arena_hdr))       /* the pages, no copy */
+        return NULL;
+    size_t len = arena_page_round(n + sizeof(arena_hdr));
+    arena_hdr *h = mremap((arena_hdr *)p - 1, large_len(p), len, MREMAP_MAYMOVE);
+    if (h == MAP_FAILED)
+        return NULL;
+    h->size = len - sizeof(arena_hdr);
+    return h + 1;
+}
+
+static inline void large_unmap(void *p) {
+    munmap((arena_hdr *)p - 1, large_len(p));
+}
+
+/* free: park the block, evicting the oldest if the cache is full */
+static inline void large_release(void *p, int owner) {
+    large_slot in = { (char *)((arena_hdr *)p - 1), large_len(p), lab_now_ns(), 1, 0, owner };
+    large_slot out = { 0 };
+    pthread_mutex_lock(&large_g.lock);
+    large_slot *s = &large_g.slot[0];
+    for (unsigned i = 0; i < LARGE_CACHE && s->base != NULL; i++)
+        if (large_g.slot[i].base == NULL || large_g.slot[i].freed_ns < s->freed_ns)
+            s = &large_g.slot[i];
+    if (s->base != NULL) {
+        out = *s;
+        large_g.st.cached -= out.len;
+        if (out.dirty)
+            large_undirty(&out, out.len);
+    }
+    *s = in;
+    large_g.st.cached += in.len;
+    large_g.st.dirty += in.len;
+    large_g.dirty[owner] += in.len;
+    uint64_t decay_ns = (uint64_t)large_g.decay_ms * 1000000u;
+    if (large_g.decay_ms >= 0 && in.freed_ns >= decay_ns)
+        large_purge_locked(in.freed_ns - decay_ns);
+    pthread_mutex_unlock(&large_g.lock);
+    if (out.base != NULL)
+        munmap(out.base, out.len);
+}
+
+static inline void *arena_large(size_t n, int zero) {
+    void *p = large_map(n, zero);
+    if (p != NULL) {
+        pthread_mutex_lock(&arena_g.lock);
+        arena_g.mapped += large_len(p);
+        arena_g.counts.mallocs[LAB_CLASSES]++;
+        arena_g.counts.large_bytes += large_len(p) - sizeof(arena_hdr);
+        LAB_COUNT(arena_g, 1, large_len(p) - sizeof(arena_hdr));
+        pthread_mutex_unlock(&arena_g.lock);
+    }
+    return p;
+}
+
+/* caller holds the lock */
+static inline arena_hdr *arena_carve(unsigned c) {
+    size_t need = sizeof(arena_hdr) + arena_class_size(c);
+    if (arena_g.cur == NULL || (size_t)(arena_g.end - arena_g.cur) < need) {
+        arena_chunk *k = mmap(NULL, ARENA_CHUNK, PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (k == MAP_FAILED)
+            return NULL;
+        k->next = arena_g.chunks;
+        arena_g.chunks = k;
+        arena_g.mapped += ARENA_CHUNK;
+        arena_g.counts.chunks++;
+        arena_g.cur = (char *)(k + 1);
+        arena_g.end = (char *)k + ARENA_CHUNK;
+    }
+    arena_hdr *h = (arena_hdr *)arena_g.cur;
+    arena_g.cur += need;
+    h->size = arena_class_size(c);
+    h->cls = c;
+    return h;
+}
+
+static inline void *arena_malloc(size_t n) {
+    if (n == 0)
+        n = 1;
+    if (n > ARENA_SMALL_MAX)
+        return arena_large(n, 0);
+
+    unsigned c = arena_class(n);
+    pthread_mutex_lock(&arena_g.lock);
+    arena_hdr *h = arena_g.free[c];
+    if (h != NULL)
+        memcpy(&arena_g.free[c], h + 1, sizeof h);    /* pop */
+    else
+        h = arena_carve(c);
+    if (h != NULL) {
+        arena_g.counts.mallocs[c]++;
+        LAB_COUNT(arena_g, 1, arena_class_size(c));
+    }
+    pthread_mutex_unlock(&arena_g.lock);
+    return h ? h + 1 : NULL;
+}
+
+static inline void arena_free(void *p) {
+    if (p == NULL)
+        return;
+    arena_hdr *h = (arena_hdr *)p - 1;
+    if (h->cls == ARENA_LARGE) {
+        size_t len = large_len(p);
+        large_release(p, LARGE_ARENA);
+        pthread_mutex_lock(&arena_g.lock);
+        arena_g.mapped -= len;
+        arena_g.counts.frees[LAB_CLASSES]++;
+        arena_g.counts.large_bytes -= len - sizeof(arena_hdr);
+        LAB_COUNT(arena_g, -1, -(len - sizeof(arena_hdr)));
+        pthread_mutex_unlock(&arena_g.lock);
+        return;
+    }
+    pthread_mutex_lock(&arena_g.lock);
+    memcpy(p, &arena_g.free[h->cls], sizeof h);       /* push */
+    arena_g.free[h->cls] = h;
+    arena_g.counts.frees[h->cls]++;
+    LAB_COUNT(arena_g, -1, -h->size);
+    pthread_mutex_unlock(&arena_g.lock);
+}
+
+static inline void *arena_calloc(size_t n, size_t size) {
+    size_t total;
+    if (__builtin_mul_overflow(n, size, &total))
+        return NULL;
+    if (total > ARENA_SMALL_MAX)
+        return arena_large(total, 1);                  /* zeroes only if reused */
+    void *p = arena_malloc(total);
+    if (p != NULL)
+        memset(p, 0, total);
+    return p;
+}
+
+static inline void *arena_realloc(void *p, size_t n) {
+    if (p == NULL)
+        return arena_malloc(n);
+    if (n == 0) {
+        arena_free(p);
+        return NULL;
+    }
+    arena_hdr *h = (arena_hdr *)p - 1;
+    if (n <= h->size && (h->cls == ARENA_LARGE || n > h->size / 2))
+        return p;                                      /* still fits well */
+    if (h->cls == ARENA_LARGE && n > ARENA_SMALL_MAX) {
+        size_t old = large_len(p);
+        void *q = large_remap(p, n);
+        if (q != NULL) {
+            pthread_mutex_lock(&arena_g.lock);
+            arena_g.mapped += large_len(q) - old;
+            arena_g.counts.large_bytes += large_len(q) - old;
+            LAB_COUNT(arena_g, 0, large_len(q) - old);
+            pthread_mutex_unlock(&arena_g.lock);
+        }
+        return q;
+    }
+    void *q = arena_malloc(n);
+    if (q != NULL) {
+        memcpy(q, p, n < h->size ? n : h->size);
+        arena_free(p);
+    }
+    return q;
+}
+
+static inline size_t arena_footprint(void) {
+    pthread_mutex_lock(&arena_g.lock);
+    size_t m = arena_g.mapped;
+    pthread_mutex_unlock(&arena_g.lock);
+    return m + large_dirty(LARGE_ARENA);   /* parked large blocks still resident */
+}
+
+static inline void arena_free_sized(void *p, size_t size) {
+    (void)size;                      /* the header already has it */
+    arena_free(p);
+}
+
+/* one lock for the batch: pop a run off the free list, carve the rest */
+static inline size_t arena_malloc_batch(size_t size, size_t n, void **out) {
+    size_t i = 0;
+    if (size == 0)
+        size = 1;
+    if (size > ARENA_SMALL_MAX) {
+        while (i < n && (out[i] = arena_large(size, 0)) != NULL)
+            i++;
+        return i;
+    }
+    unsigned c = arena_class(size);
+    pthread_mutex_lock(&arena_g.lock);
+    arena_hdr *h = arena_g.free[c];
+    for (; i < n && h != NULL; i++) {
+        out[i] = h + 1;
+        memcpy(&h, h + 1, sizeof h);
+    }
+    arena_g.free[c] = h;
+    for (; i < n && (h = arena_carve(c)) != NULL; i++)
+        out[i] = h + 1;
+    arena_g.counts.mallocs[c] += i;
+    LAB_COUNT(arena_g, i, i * arena_class_size(c));
+    pthread_mutex_unlock(&arena_g.lock);
+    return i;
+}
+
+/*
+ * Links the blocks of each class into a local chain without the lock —
+ * those writes into the blocks are the cache misses — then splices every
+ * chain onto its free list in one short critical section.
+ */
+static inline void arena_free_batch(void **ptrs, size_t n) {
+    arena_hdr *head[ARENA_CLASSES], *tail[ARENA_CLASSES];
+    size_t len[ARENA_CLASSES];
+    uint64_t used = 0;                                 /* classes with a chain */
+    size_t blocks = 0, bytes = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (ptrs[i] == NULL)
+            continue;
+        arena_hdr *h = (arena_hdr *)ptrs[i] - 1;
+        if (h->cls == ARENA_LARGE) {
+            arena_free(ptrs[i]);
+            continue;
+        }
+        unsigned c = (unsigned)h->cls;
+        blocks++;
+        bytes += h->size;
+        if (used >> c & 1) {
+            memcpy(h + 1, &head[c], sizeof h);
+            len[c]++;
+        } else {
+            tail[c] = h;
+            len[c] = 1;
+        }
+        head[c] = h;
+        used |= 1ull << c;
+    }
+    if (used == 0)
+        return;
+    pthread_mutex_lock(&arena_g.lock);
+    for (uint64_t m = used; m != 0; m &= m - 1) {
+        unsigned c = (unsigned)__builtin_ctzll(m);
+        memcpy(tail[c] + 1, &arena_g.free[c], sizeof tail[c]);
+        arena_g.free[c] = head[c];
+        arena_g.counts.frees[c] += len[c];
+    }
+    LAB_COUNT(arena_g, -blocks, -bytes);
+    pthread_mutex_unlock(&arena_g.lock);
+}
+
+static inline lab_usage arena_live(void) {
+    pthread_mutex_lock(&arena_g.lock);
+    lab_usage u = arena_g.live;
+    pthread_mutex_unlock(&arena_g.lock);
+    return u;
+}
+
+static inline lab_counts arena_counts(void) {
+    pthread_mutex_lock(&arena_g.lock);
+    lab_counts k = arena_g.counts;
+    pthread_mutex_unlock(&arena_g.lock);
+    return k;
+}
+
+static const lab_allocator lab_arena = {
+    "arena", arena_malloc, arena_calloc, arena_realloc, arena_free,
+    arena_free_sized, arena_malloc_batch, arena_free_batch, arena_live,
+    arena_counts, lab_large_purge, arena_footprint,
+};
+
+
+/* ---------- pagemap: header-less slabs + radix page map ---------- */
+
+/*
+ * 48-bit addresses, 4 KB pages: a page number has 36 bits, split 18 / 18.
+ *
+ *   page = p >> 12 ── root[page >> 18] ──► leaf ── cls[page & 0x3ffff]
+ *
+ * The root is 2 MB of BSS (untouched entries cost nothing); a 256 KB leaf
+ * describes 1 GB and is mmap'd the first time a slab lands there. An entry
+ * holds class + 1, PM_LARGE for the first page of a large block, or 0 for
+ * pages this allocator never handed out.
+ *
+ * Slabs are whole 64 KB spans of a 4 MB chunk. The chunk is aligned to its
+ * size and the page just below it holds one descriptor per span, so the
+ * slab of any small block is address arithmetic and one load:
+ *
+ *   chunk = p & ~(4 MB - 1) ── desc = chunk - 4 KB ── desc[desc[(p - chunk) >> 16].head]
+ *
+ * Each slab keeps its own free list and a count of live blocks. A slab
+ * whose last block is freed drops its free list (its tail is bumped again
+ * on reuse) and waits on the class's dirty list; once it has been empty
+ * for decay_ms (lab_decay_set, shared with the large blocks) its pages are
+ * madvise()d away. The mapping stays, on the clean list, for the class.
+ */
+#define PM_PAGE_SHIFT 12u
+#define PM_LEAF_BITS  18u
+#define PM_ROOT_BITS  (48u - PM_PAGE_SHIFT - PM_LEAF_BITS)
+#define PM_CHUNK      (4u << 20)      /* slabs are cut from 4 MB chunks */
+#define PM_SPAN_SHIFT 16u             /* in whole 64 KB spans */
+#define PM_SPAN       (1u << PM_SPAN_SHIFT)
+#define PM_META       4096u           /* span descriptors, just below the chunk */
+#define PM_LARGE      0xffu
+
+typedef struct {
+    uint8_t cls[1u << PM_LEAF_BITS];
+} pm_leaf;
+
+enum { PM_NONE, PM_PARTIAL, PM_DIRTY, PM_CLEAN, PM_LISTS };
+
+/* one per span; only the slab's first span is used, the others point to it */
+typedef struct pm_slab {
+    void           *free;            /* freed blocks, linked through them */
+    char           *bump, *base;     /* bump: the never-used tail starts here */
+    struct pm_slab *prev, *next;     /* on lists[list][cls] */
+    uint64_t        freed_ns;        /* PM_DIRTY: empty since */
+    uint32_t        live;            /* blocks handed out, not freed */
+    uint8_t         cls, list, head; /* head: the slab's first span */
+} pm_slab;
+
+_Static_assert(sizeof(pm_slab) * (PM_CHUNK / PM_SPAN) <= PM_META,
+               "a chunk's descriptors fit in one page");
+
+typedef struct {
+    pm_slab *head, *tail;            /* newest first */
+} pm_list;
+
+static struct {
+    pthread_mutex_t lock;
+    char           *cur, *end;       /* unused spans of the newest chunk */
+    pm_slab        *slab[ARENA_CLASSES];   /* allocating from; on no list */
+    pm_list         lists[PM_LISTS][ARENA_CLASSES];   /* partly free, empty, purged */
+    size_t          mapped;          /* chunks + descriptor pages + large blocks */
+    size_t          clean;           /* bytes of purged slabs: mapped, not resident */
+    uint64_t        purged;          /* slab bytes madvise()d, ever */
+    size_t          map_bytes;       /* page-map leaves */
+    lab_usage       live;            /* LAB_LEAK_CHECK */
+    lab_counts      counts;
+    pm_leaf        *root[1u << PM_ROOT_BITS];
+} pm_g = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static inline size_t pm_slab_bytes(unsigned c) {   /* >= 8 blocks, whole spans */
+    size_t b = 8 * arena_class_size(c);
+    return (b + PM_SPAN - 1) & ~(size_t)(PM_SPAN - 1);
+}
+
+/* caller holds the lock */
+static inline int pm_set(const char *start, size_t bytes, uint8_t v) {
+    uintptr_t first = (uintptr_t)start >> PM_PAGE_SHIFT;
+    uintptr_t last = ((uintptr_t)start + bytes - 1) >> PM_PAGE_SHIFT;
+    for (uintptr_t pg = first; pg <= last; pg++) {
+        pm_leaf **l = &pm_g.root[pg >> PM_LEAF_BITS];
+        if (*l == NULL) {
+            void *m = mmap(NULL, sizeof(pm_leaf), PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (m == MAP_FAILED)
+                return -1;
+            *l = m;
+            pm_g.map_bytes += sizeof(pm_leaf);
+        }
+        (*l)->cls[pg & ((1u << PM_LEAF_BITS) - 1)] = v;
+    }
+    return 0;
+}
+
+static inline uint8_t pm_lookup(const void *p) {
+    uintptr_t pg = (uintptr_t)p >> PM_PAGE_SHIFT;
+    const pm_leaf *l = pm_g.root[pg >> PM_LEAF_BITS];
+    return l ? l->cls[pg & ((1u << PM_LEAF_BITS) - 1)] : 0;
+}
+
+/* p is a small block */
+static inline pm_slab *pm_slab_of(const void *p) {
+    uintptr_t k = (uintptr_t)p & ~(uintptr_t)(PM_CHUNK - 1);
+    pm_slab *d = (pm_slab *)(k - PM_META);
+    return &d[d[((uintptr_t)p - k) >> PM_SPAN_SHIFT].head];
+}
+
+/* caller holds the lock */
+static inline void pm_list_put(pm_slab *s, int list) {
+    pm_list *l = &pm_g.lists[list][s->cls];
+    s->list = (uint8_t)list;
+    s->prev = NULL;
+    s->next = l->head;
+    if (l->head != NULL)
+        l->head->prev = s;
+    else
+        l->tail = s;
+    l->head = s;
+}
+
+static inline void pm_list_take(pm_slab *s) {
+    pm_list *l = &pm_g.lists[s->list][s->cls];
+    if (s->prev != NULL)
+        s->prev->next = s->next;
+    else
+        l->head = s->next;
+    if (s->next != NULL)
+        s->next->prev = s->prev;
+    else
+        l->tail = s->prev;
+    s->list = PM_NONE;
+}
+
+/* over-map, then trim to a PM_CHUNK-aligned chunk with its descriptor page */
+static inline char *pm_map_chunk(void) {
+    size_t len = 2 * (size_t)PM_CHUNK;
+    char *m = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (m == MAP_FAILED)
+        return NULL;
+    char *k = (char *)(((uintptr_t)m + PM_META + PM_CHUNK - 1) & ~(uintptr_t)(PM_CHUNK - 1));
+    if (k - PM_META > m)
+        munmap(m, (size_t)(k - PM_META - m));
+    if (k + PM_CHUNK < m + len)
+        munmap(k + PM_CHUNK, (size_t)(m + len - (k + PM_CHUNK)));
+    return k;
+}
+
+/* caller holds the lock */
+static inline pm_slab *pm_new_slab(unsigned c) {
+    size_t bytes = pm_slab_bytes(c);
+    if (pm_g.cur == NULL || (size_t)(pm_g.end - pm_g.cur) < bytes) {
+        char *k = pm_map_chunk();
+        if (k == NULL)
+            return NULL;
+        pm_g.mapped += PM_CHUNK + PM_META;
+        pm_g.counts.chunks++;
+        pm_g.cur = k;
+        pm_g.end = k + PM_CHUNK;
+    }
+    char *base = pm_g.cur;
+    if (pm_set(base, bytes, (uint8_t)(c + 1)) != 0)
+        return NULL;
+    pm_g.cur += bytes;
+    pm_slab *d = (pm_slab *)(((uintptr_t)base & ~(uintptr_t)(PM_CHUNK - 1)) - PM_META);
+    unsigned first = (unsigned)(((uintptr_t)base & (PM_CHUNK - 1)) >> PM_SPAN_SHIFT);
+    for (unsigned i = first; i < first + bytes / PM_SPAN; i++)
+        d[i].head = (uint8_t)first;
+    d[first] = (pm_slab){ .bump = base, .base = base, .cls = (uint8_t)c,
+                          .head = (uint8_t)first };
+    return &d[first];
+}
+
+/* caller holds the lock: the current slab, then a partly free one, then an
+ * empty one (still resident first), then a new one */
+static inline void *pm_alloc_locked(unsigned c) {
+    size_t size = arena_class_size(c);
+    pm_slab *s = pm_g.slab[c];
+    for (;;) {
+        if (s != NULL) {
+            void *p = s->free;
+            if (p != NULL) {
+                memcpy(&s->free, p, sizeof p);         /* pop */
+                s->live++;
+                return p;
+            }
+            if ((size_t)(s->base + pm_slab_bytes(c) - s->bump) >= size) {
+                p = s->bump;
+                s->bump += size;
+                s->live++;
+                return p;
+            }
+        }
+        if ((s = pm_g.lists[PM_PARTIAL][c].head) == NULL &&
+            (s = pm_g.lists[PM_DIRTY][c].head) == NULL &&
+            (s = pm_g.lists[PM_CLEAN][c].head) == NULL && (s = pm_new_slab(c)) == NULL)
+            return NULL;
+        if (s->list == PM_CLEAN)
+            pm_g.clean -= pm_slab_bytes(c);
+        if (s->list != PM_NONE)
+            pm_list_take(s);
+        pm_g.slab[c] = s;                              /* the full one is on no list */
+    }
+}
+
+/* caller holds the lock; gives back the class's slabs empty since freed_before */
+static inline size_t pm_purge_class(unsigned c, uint64_t freed_before, int advice) {
+    size_t bytes = 0, len = pm_slab_bytes(c);
+    pm_slab *s;
+    while ((s = pm_g.lists[PM_DIRTY][c].tail) != NULL && s->freed_ns <= freed_before) {
+        madvise(s->base, len, advice);                 /* under the lock: no reuse meanwhile */
+        pm_list_take(s);
+        pm_list_put(s, PM_CLEAN);
+        bytes += len;
+    }
+    pm_g.clean += bytes;
+    pm_g.purged += bytes;
+    return bytes;
+}
+
+/* caller holds the lock; p is small and of class c */
+static inline void pm_free_locked(void *p, unsigned c) {
+    pm_slab *s = pm_slab_of(p);
+    memcpy(p, &s->free, sizeof p);
+    s->free = p;
+    if (--s->live != 0) {
+        if (s->list == PM_NONE && s != pm_g.slab[c])
+            pm_list_put(s, PM_PARTIAL);                /* it was full */
+        return;
+    }
+    if (s == pm_g.slab[c])
+        return;                                        /* the next mallocs use it */
+    if (s->list != PM_NONE)
+        pm_list_take(s);
+    s->free = NULL;                                    /* its blocks are all free: */
+    s->bump = s->base;                                 /* bump them again */
+    s->freed_ns = lab_now_ns();
+    pm_list_put(s, PM_DIRTY);
+    int advice, decay_ms = lab_decay_get(&advice);
+    uint64_t decay_ns = (uint64_t)decay_ms * 1000000u;
+    if (decay_ms >= 0 && s->freed_ns >= decay_ns)
+        pm_purge_class(c, s->freed_ns - decay_ns, advice);
+}
+
+/* blocks over 64 KB keep a 16-byte header: < 0.03% of them */
+static inline void *pm_large(size_t n, int zero) {
+    void *p = large_map(n, zero);
+    if (p == NULL)
+        return NULL;
+    pthread_mutex_lock(&pm_g.lock);
+    int err = pm_set(p, 1, PM_LARGE);
+    if (!err) {
+        pm_g.mapped += large_len(p);
+        pm_g.counts.mallocs[LAB_CLASSES]++;
+        pm_g.counts.large_bytes += large_len(p) - sizeof(arena_hdr);
+        LAB_COUNT(pm_g, 1, large_len(p) - sizeof(arena_hdr));
+    }
+    pthread_mutex_unlock(&pm_g.lock);
+    if (err) {
+        large_unmap(p);
+        return NULL;
+    }
+    return p;
+}
+
+static inline void *pm_malloc(size_t n) {
+    if (n == 0)
+        n = 1;
+    if (n > ARENA_SMALL_MAX)
+        return pm_large(n, 0);
+
+    unsigned c = arena_class(n);
+    pthread_mutex_lock(&pm_g.lock);
+    void *p = pm_alloc_locked(c);
+    if (p != NULL) {
+        pm_g.counts.mallocs[c]++;
+        LAB_COUNT(pm_g, 1, arena_class_size(c));
+    }
+    pthread_mutex_unlock(&pm_g.lock);
+    return p;
+}
+
+/* caller knows p is small and of class c */
+static inline void pm_push(void *p, unsigned c) {
+    pthread_mutex_lock(&pm_g.lock);
+    pm_free_locked(p, c);
+    pm_g.counts.frees[c]++;
+    LAB_COUNT(pm_g, -1, -arena_class_size(c));
+    pthread_mutex_unlock(&pm_g.lock);
+}
+
+static inline void pm_free_large(void *p) {
+    size_t len = large_len(p);
+    pthread_mutex_lock(&pm_g.lock);
+    pm_g.mapped -= len;
+    pm_g.counts.frees[LAB_CLASSES]++;
+    pm_g.counts.large_bytes -= len - sizeof(arena_hdr);
+    LAB_COUNT(pm_g, -1, -(len - sizeof(arena_hdr)));
+    pm_set(p, 1, 0);                                   /* leaf exists: can't fail */
+    pthread_mutex_unlock(&pm_g.lock);
+    large_release(p, LARGE_PM);
+}
+
+static inline void pm_free(void *p) {
+    if (p == NULL)
+        return;
+    uint8_t v = pm_lookup(p);                          /* two dependent loads */
+    if (v == 0)
+        abort();                                       /* not ours */
+    if (v == PM_LARGE)
+        pm_free_large(p);
+    else
+        pm_push(p, v - 1u);
+}
+
+static inline void pm_free_sized(void *p, size_t size) {
+    if (p == NULL)
+        return;
+    if (size > ARENA_SMALL_MAX)
+        pm_free_large(p);
+    else
+        pm_push(p, arena_class(size ? size : 1));      /* no page-map lookup */
+}
+
+static inline size_t pm_usable(const void *p) {
+    uint8_t v = pm_lookup(p);
+    return v == PM_LARGE ? large_len(p) - sizeof(arena_hdr)
+                         : arena_class_size(v - 1u);
+}
+
+static inline void *pm_calloc(size_t n, size_t size) {
+    size_t total;
+    if (__builtin_mul_overflow(n, size, &total))
+        return NULL;
+    if (total > ARENA_SMALL_MAX)
+        return pm_large(total, 1);
+    void *p = pm_malloc(total);
+    if (p != NULL)
+        memset(p, 0, total);
+    return p;
+}
+
+static inline void *pm_realloc(void *p, size_t n) {
+    if (p == NULL)
+        return pm_malloc(n);
+    if (n == 0) {
+        pm_free(p);
+        return NULL;
+    }
+    uint8_t v = pm_lookup(p);
+    size_t have = pm_usable(p);
+    /* stay only in the exact class of n, so free_sized(p, n) stays right */
+    if (v != PM_LARGE && n <= ARENA_SMALL_MAX && arena_class(n) == v - 1u)
+        return p;
+    if (v == PM_LARGE && n > ARENA_SMALL_MAX) {
+        /* remap under the lock: once mremap moves the block, another thread's
+         * pm_large may get the old address, and its entry must not be
+         * cleared after it was set */
+        size_t old = large_len(p);
+        int err = 0;
+        pthread_mutex_lock(&pm_g.lock);
+        void *q = large_remap(p, n);
+        if (q != NULL) {
+            pm_g.mapped += large_len(q) - old;
+            pm_g.counts.large_bytes += large_len(q) - old;
+            LAB_COUNT(pm_g, 0, large_len(q) - old);
+            if (q != p) {
+                pm_set(p, 1, 0);
+                err = pm_set(q, 1, PM_LARGE);
+            }
+        }
+        pthread_mutex_unlock(&pm_g.lock);
+        if (err)
+            abort();
+        return q;
+    }
+    void *q = pm_malloc(n);
+    if (q != NULL) {
+        memcpy(q, p, n < have ? n : have);
+        pm_free(p);
+    }
+    return q;
+}
+
+static inline size_t pm_footprint(void) {
+    pthread_mutex_lock(&pm_g.lock);
+    size_t m = pm_g.mapped - pm_g.clean;
+    pthread_mutex_unlock(&pm_g.lock);
+    return m + large_dirty(LARGE_PM);
+}
+
+/* Gives back the pages of slabs empty for at least idle_ns, and of parked
+ * large blocks. */
+static inline size_t pm_purge(uint64_t idle_ns) {
+    int advice;
+    lab_decay_get(&advice);
+    uint64_t now = lab_now_ns(), before = now > idle_ns ? now - idle_ns : 0;
+    size_t bytes = 0;
+    pthread_mutex_lock(&pm_g.lock);
+    for (unsigned c = 0; c < ARENA_CLASSES; c++)
+        bytes += pm_purge_class(c, before, advice);
+    pthread_mutex_unlock(&pm_g.lock);
+    return bytes + lab_large_purge(idle_ns);
+}
+
+static inline size_t pm_malloc_batch(size_t size, size_t n, void **out) {
+    size_t i = 0;
+    if (size == 0)
+        size = 1;
+    if (size > ARENA_SMALL_MAX) {
+        while (i < n && (out[i] = pm_large(size, 0)) != NULL)
+            i++;
+        return i;
+    }
+    unsigned c = arena_class(size);
+    size_t bs = arena_class_size(c);
+    pthread_mutex_lock(&pm_g.lock);
+    while (i < n && (out[i] = pm_alloc_locked(c)) != NULL)
+        i++;
+    pm_g.counts.mallocs[c] += i;
+    LAB_COUNT(pm_g, i, i * bs);
+    pthread_mutex_unlock(&pm_g.lock);
+    return i;
+}
+
+/* one lock for the small blocks; large ones after it, as pm_free does */
+static inline void pm_free_batch(void **ptrs, size_t n) {
+    size_t blocks = 0, bytes = 0, large = 0;
+    pthread_mutex_lock(&pm_g.lock);
+    for (size_t i = 0; i < n; i++) {
+        void *p = ptrs[i];
+        if (p == NULL)
+            continue;
+        uint8_t v = pm_lookup(p);
+        if (v == 0)
+            abort();
+        if (v == PM_LARGE) {
+            large++;
+            continue;
+        }
+        unsigned c = v - 1u;
+        pm_free_locked(p, c);
+        pm_g.counts.frees[c]++;
+        blocks++;
+        bytes += arena_class_size(c);
+    }
+    LAB_COUNT(pm_g, -blocks, -bytes);
+    pthread_mutex_unlock(&pm_g.lock);
+    for (size_t i = 0; large != 0 && i < n; i++)
+        if (ptrs[i] != NULL && pm_lookup(ptrs[i]) == PM_LARGE) {
+            pm_free_large(ptrs[i]);
+            large--;
+        }
+}
+
+static inline lab_usage pm_live(void) {
+    pthread_mutex_lock(&pm_g.lock);
+    lab_usage u = pm_g.live;
+    pthread_mutex_unlock(&pm_g.lock);
+    return u;
+}
+
+static inline lab_counts pm_counts(void) {
+    pthread_mutex_lock(&pm_g.lock);
+    lab_counts k = pm_g.counts;
+    pthread_mutex_unlock(&pm_g.lock);
+    return k;
+}
+
+static const lab_allocator lab_pagemap = {
+    "pagemap", pm_malloc, pm_calloc, pm_realloc, pm_free, pm_free_sized,
+    pm_malloc_batch, pm_free_batch, pm_live, pm_counts, pm_purge, pm_footprint,
+};
+
+/* ---------- registry ---------- */
+
+static const lab_allocator *const lab_allocators[] = {
+    &lab_glibc, &lab_arena, &lab_pagemap, NULL,
+};
+
+static inline const lab_allocator *lab_find(const char *name) {
+    for (int i = 0; lab_allocators[i]; i++)
+        if (strcmp(lab_allocators[i]->name, name) == 0)
+            return lab_allocators[i];
+    return NULL;
+}
+
+/* ---------- background purger ---------- */
+
+typedef struct {
+    int decay_ms;                    /* free pages stay resident this long;
+                                        0: purge at free, -1: never */
+    int interval_ms;                 /* purger wakeups; 0: no thread */
+    int advice;                      /* MADV_DONTNEED: RSS drops now;
+                                        MADV_FREE: when memory runs short */
+} lab_purge_opts;
+
+static struct {
+    pthread_mutex_t      lock;
+    pthread_cond_t       wake;
+    pthread_t            thread;
+    int                  running;
+    const lab_allocator *a;
+    lab_purge_opts       o;
+} purger_g = { .lock = PTHREAD_MUTEX_INITIALIZER, .wake = PTHREAD_COND_INITIALIZER };
+
+static inline void *lab_purger_main(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&purger_g.lock);
+    while (purger_g.running) {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        uint64_t ns = (uint64_t)ts.tv_nsec + (uint64_t)purger_g.o.interval_ms * 1000000u;
+        ts.tv_sec += (time_t)(ns / 1000000000u);
+        ts.tv_nsec = (long)(ns % 1000000000u);
+        pthread_cond_timedwait(&purger_g.wake, &purger_g.lock, &ts);
+        if (!purger_g.running)
+            break;
+        const lab_allocator *a = purger_g.a;         /* a retune may change them */
+        uint64_t decay_ns = (uint64_t)purger_g.o.decay_ms * 1000000u;
+        pthread_mutex_unlock(&purger_g.lock);
+        a->purge(decay_ns);
+        pthread_mutex_lock(&purger_g.lock);
+    }
+    pthread_mutex_unlock(&purger_g.lock);
+    return NULL;
+}
+
+static inline void lab_purger_stop(void) {
+    pthread_mutex_lock(&purger_g.lock);
+    int was = purger_g.running;
+    purger_g.running = 0;
+    pthread_cond_signal(&purger_g.wake);
+    pthread_mutex_unlock(&purger_g.lock);
+    if (was) {
+        pthread_join(purger_g.thread, NULL);
+        pthread_cond_destroy(&purger_g.wake);
+    }
+}
+
+/* Sets the decay for a and, with interval_ms > 0 and decay_ms > 0, starts a
+ * thread that purges every interval_ms — the idle periods, when no free
+ * comes along to apply the decay. Called again while the thread runs, it
+ * retunes it in place; with no interval it stops it. Returns 0, or an
+ * errno value. */
+static inline int lab_purger_start(const lab_allocator *a, lab_purge_opts o) {
+    lab_decay_set(o.decay_ms, o.advice);
+    if (o.interval_ms <= 0 || o.decay_ms <= 0) {
+        lab_purger_stop();
+        return 0;
+    }
+    pthread_mutex_lock(&purger_g.lock);
+    if (purger_g.running) {
+        purger_g.a = a;
+        purger_g.o = o;
+        pthread_cond_signal(&purger_g.wake);         /* the next wait uses the new interval */
+        pthread_mutex_unlock(&purger_g.lock);
+        return 0;
+    }
+    pthread_condattr_t ca;
+    pthread_condattr_init(&ca);
+    pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+    pthread_cond_init(&purger_g.wake, &ca);
+    pthread_condattr_destroy(&ca);
+    purger_g.a = a;
+    purger_g.o = o;
+    purger_g.running = 1;
+    int err = pthread_create(&purger_g.thread, NULL, lab_purger_main, NULL);
+    if (err != 0)
+        purger_g.running = 0;
+    pthread_mutex_unlock(&purger_g.lock);
+    return err;
+}
+
+/* ---------- teardown ---------- */
+
+/*
+ * At exit the kernel takes the address space back in one sweep; freeing
+ * each object first only walks the heap to throw it away (note 08 §8).
+ * Release builds skip that walk. LAB_LEAK_CHECK builds keep it, because
+ * the blocks still live after a full cleanup are exactly the leaks.
+ */
+#ifdef LAB_LEAK_CHECK
+#define LAB_FAST_TEARDOWN 0
+#else
+#define LAB_FAST_TEARDOWN 1
+#endif
+
+/* Ends the process. LAB_LEAK_CHECK: report a's live blocks, then exit().
+ * Otherwise flush stdio and _exit(): no atexit handlers, no frees. */
+static inline _Noreturn void lab_exit(const lab_allocator *a, int status) {
+#ifdef LAB_LEAK_CHECK
+    lab_usage u = a->live();
+    if (u.blocks != 0)
+        fprintf(stderr, "lab_exit: %s: %zu blocks, %zu bytes still live\n",
+                a->name, u.blocks, u.bytes);
+    exit(status);
+#else
+    (void)a;
+    fflush(NULL);
+    _exit(status);
+#endif
+}
+
+#endif /* LAB_ALLOC_H */
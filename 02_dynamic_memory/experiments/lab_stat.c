@@ -0,0 +1,189 @@
+/*
+ * lab_stat.c — reads the heap statistics a process publishes with
+ * lab_stats_start() (lab_stats.h). It maps the page read-only: the
+ * process is never stopped, signalled or slowed down by a lock.
+ *
+ *   gcc -O2 lab_stat.c -o lab_stat
+ *   ./lab_stat                         list publishing processes
+ *   ./lab_stat PID                     one report: classes, large cache, latency
+ *   ./lab_stat -w 500 [-n 20] PID      a line every 500 ms with rates and
+ *                                      that window's p99 / p99.9
+ */
+#define _GNU_SOURCE
+#include "lab_stats.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MB (1024.0 * 1024.0)
+
+static double live_bytes(const lab_stats_data *d) {
+    double sum = (double)d->counts.large_bytes;
+    for (unsigned c = 0; c < LAB_CLASSES; c++)
+        sum += (double)(d->counts.mallocs[c] - d->counts.frees[c]) * (double)d->class_size[c];
+    return sum;
+}
+
+static uint64_t total(const uint64_t *v) {
+    uint64_t n = 0;
+    for (unsigned c = 0; c <= LAB_CLASSES; c++)
+        n += v[c];
+    return n;
+}
+
+static int list(void) {
+    DIR *dir = opendir("/dev/shm");
+    if (dir == NULL) {
+        perror("/dev/shm");
+        return 1;
+    }
+    struct dirent *e;
+    int n = 0;
+    while ((e = readdir(dir)) != NULL) {
+        long pid;
+        if (sscanf(e->d_name, "lab_stats.%ld", &pid) != 1)
+            continue;
+        const lab_stats_page *pg = lab_stats_attach(pid);
+        static lab_stats_data d;
+        if (pg == NULL || lab_stats_read(pg, &d, NULL) != 0) {
+            printf("%8ld  (unreadable: %s)\n", pid, strerror(errno));
+        } else {
+            int alive = kill((pid_t)pid, 0) == 0 || errno == EPERM;   /* no signal sent */
+            printf("%8ld  %-8s  %7.1f MB  %s\n", pid, d.allocator, (double)d.footprint / MB,
+                   alive ? "" : "(exited without lab_stats_stop: stale)");
+        }
+        if (pg != NULL)
+            lab_stats_detach(pg);
+        n++;
+    }
+    closedir(dir);
+    if (n == 0)
+        puts("no process is publishing lab_stats");
+    return 0;
+}
+
+static void report(const lab_stats_data *d) {
+    const lab_counts *k = &d->counts;
+    printf("pid %d  %s  up %.1f s  published %llu times, every %u ms\n", d->pid,
+           d->allocator, (double)(d->now_ns - d->started_ns) * 1e-9,
+           (unsigned long long)d->publishes, d->interval_ms);
+    printf("footprint %.1f MB  live %.1f MB  chunks %zu\n", (double)d->footprint / MB,
+           live_bytes(d) / MB, k->chunks);
+    uint64_t lookups = d->large.hits + d->large.misses;
+    printf("large cache %.1f MB (%.1f MB resident)  hits %.0f%%  purged %.1f MB\n\n",
+           (double)d->large.cached / MB, (double)d->large.dirty / MB,
+           lookups ? 100.0 * (double)d->large.hits / (double)lookups : 0.0,
+           (double)d->large.purged / MB);
+
+    printf("%6s %8s %12s %10s %12s\n", "class", "size", "live blocks", "live KB", "mallocs");
+    for (unsigned c = 0; c <= LAB_CLASSES; c++) {
+        uint64_t live = k->mallocs[c] - k->frees[c];
+        if (k->mallocs[c] == 0)
+            continue;
+        if (c == LAB_CLASSES)
+            printf("%6s %8s %12llu %10.1f %12llu\n", "large", "-", (unsigned long long)live,
+                   (double)k->large_bytes / 1024, (unsigned long long)k->mallocs[c]);
+        else
+            printf("%6u %8llu %12llu %10.1f %12llu\n", c, (unsigned long long)d->class_size[c],
+                   (unsigned long long)live, (double)live * (double)d->class_size[c] / 1024,
+                   (unsigned long long)k->mallocs[c]);
+    }
+    if (total(k->mallocs) == 0)
+        puts("   (no size classes: glibc)");
+
+    if (d->sample == 1)
+        printf("\nlatency, every call\n");
+    else
+        printf("\nlatency, 1 call in %u (build with -DHDR_ENABLE to time all)\n", d->sample);
+    hdr_print_header(stdout);
+    hdr_print(stdout, "malloc", &d->lat[LAB_LAT_MALLOC], d->ns_per_tick);
+    hdr_print(stdout, "free", &d->lat[LAB_LAT_FREE], d->ns_per_tick);
+}
+
+static const char *window_p(char buf[16], const hdr_counts *h, double q, double k) {
+    if (h->n == 0)
+        return "-";
+    return hdr_fmt(buf, (double)hdr_value_at(h, q) * k);
+}
+
+/* one line per interval: rates and latency over that interval only */
+static void stream(const lab_stats_page *pg, int ms, int count) {
+    static lab_stats_data prev, d;   /* 37 KB each */
+    static hdr_counts h[2];
+    unsigned retries = 0;
+    if (lab_stats_read(pg, &prev, &retries) != 0)
+        return;
+    printf("%8s %9s %8s %10s %10s %10s %9s %9s %9s %9s %7s\n", "time s", "footprnt",
+           "live MB", "malloc/s", "free/s", "purge MB/s", "malloc99", "malloc999", "free99",
+           "free999", "retry");
+    for (int i = 0; count == 0 || i < count; i++) {
+        struct timespec ts = { ms / 1000, (long)(ms % 1000) * 1000000 };
+        nanosleep(&ts, NULL);
+        if (lab_stats_read(pg, &d, &retries) != 0) {
+            puts("publisher busy");
+            continue;
+        }
+        if (d.now_ns == prev.now_ns)
+            continue;                /* not published since: nothing new */
+        double dt = (double)(d.now_ns - prev.now_ns) * 1e-9;
+        char b[4][16];
+        for (int op = 0; op < 2; op++)
+            hdr_diff(&h[op], &d.lat[op], &prev.lat[op]);
+        printf("%8.1f %8.1fM %8.1f %10.0f %10.0f %10.1f %9s %9s %9s %9s %7u\n",
+               (double)(d.now_ns - d.started_ns) * 1e-9, (double)d.footprint / MB,
+               live_bytes(&d) / MB,
+               (double)(total(d.counts.mallocs) - total(prev.counts.mallocs)) / dt,
+               (double)(total(d.counts.frees) - total(prev.counts.frees)) / dt,
+               (double)(d.large.purged - prev.large.purged) / MB / dt,
+               window_p(b[0], &h[LAB_LAT_MALLOC], 0.99, d.ns_per_tick),
+               window_p(b[1], &h[LAB_LAT_MALLOC], 0.999, d.ns_per_tick),
+               window_p(b[2], &h[LAB_LAT_FREE], 0.99, d.ns_per_tick),
+               window_p(b[3], &h[LAB_LAT_FREE], 0.999, d.ns_per_tick), retries);
+        fflush(stdout);
+        prev = d;
+        if (kill((pid_t)d.pid, 0) != 0 && errno == ESRCH) {
+            puts("process exited");
+            return;
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    int ms = 0, count = 0, opt;
+    while ((opt = getopt(argc, argv, "w:n:")) != -1) {
+        if (opt == 'w')
+            ms = atoi(optarg);
+        else if (opt == 'n')
+            count = atoi(optarg);
+        else
+            return 2;
+    }
+    if (optind == argc)
+        return list();
+
+    long pid = strtol(argv[optind], NULL, 10);
+    const lab_stats_page *pg = lab_stats_attach(pid);
+    if (pg == NULL) {
+        fprintf(stderr, "lab_stat: pid %ld: %s\n", pid,
+                errno == ENOENT ? "not publishing" : strerror(errno));
+        return 1;
+    }
+    if (ms > 0) {
+        stream(pg, ms, count);
+    } else {
+        static lab_stats_data d;
+        if (lab_stats_read(pg, &d, NULL) != 0) {
+            fputs("lab_stat: publisher busy\n", stderr);
+            return 1;
+        }
+        report(&d);
+    }
+    lab_stats_detach(pg);
+    return 0;
+}
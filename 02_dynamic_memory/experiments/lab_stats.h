@@ -0,0 +1,315 @@
+/*
+ * lab_stats.h — live heap statistics in a shared-memory page, for a scraper
+ * in another process (lab_stat.c) that never stops or signals this one.
+ *
+ *   a = lab_stats_start(lab_find("arena"), 100);   publish every 100 ms
+ *   void *p = a->malloc(n);                        a also samples latency
+ *   ...
+ *   lab_stats_stop();                              unlinks the segment
+ *
+ * The page is /dev/shm/lab_stats.<pid>. A publisher thread fills it every
+ * interval from what the allocator already counts (lab_counts, the large
+ * cache, footprint) and from the latency histograms, under a seqlock:
+ *
+ *   writer   seq = odd, copy, seq = even      never waits for anyone
+ *   reader   seq, copy, seq again             retries on odd or changed
+ *
+ * Readers map the page read-only, so they cannot write anything the
+ * allocator or the publisher would wait on. The allocator's own fast path
+ * is unchanged except for the wrapper returned by lab_stats_start(): every
+ * LAB_STATS_SAMPLE-th malloc and free on a thread is timed into an HDR
+ * histogram (hdr.h, a per-thread shard: no atomic read-modify-write).
+ * Built with -DHDR_ENABLE, every call is timed.
+ *
+ * Header-only; define _GNU_SOURCE before including it.
+ */
+#ifndef LAB_STATS_H
+#define LAB_STATS_H
+
+#include "lab_alloc.h"
+#include "../../03_functions/experiments/hdr.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LAB_STATS_MAGIC   0x31746174736261ull  /* "abstat1" */
+#define LAB_STATS_VERSION 2u
+#ifdef HDR_ENABLE
+#define LAB_STATS_SAMPLE  1u        /* every malloc/free is timed */
+#else
+#define LAB_STATS_SAMPLE  64u       /* one malloc/free in 64 is timed */
+#endif
+
+enum { LAB_LAT_MALLOC, LAB_LAT_FREE };
+
+typedef struct {
+    int32_t  pid;
+    uint32_t interval_ms;
+    char     allocator[16];
+    uint64_t started_ns, now_ns;    /* CLOCK_MONOTONIC of the process */
+    uint64_t publishes;
+    uint64_t class_size[LAB_CLASSES];
+    lab_counts counts;              /* all zeros for glibc */
+    uint64_t footprint;
+    lab_large_stats large;
+    uint32_t sample;                /* LAB_STATS_SAMPLE of the publisher */
+    double   ns_per_tick;           /* lat[] is in hdr_ticks() */
+    hdr_counts lat[2];              /* LAB_LAT_MALLOC, LAB_LAT_FREE */
+} lab_stats_data;
+
+typedef struct {
+    uint64_t         magic;
+    uint32_t         version, size;     /* size: sizeof(lab_stats_page) */
+    _Atomic uint64_t seq;               /* odd while the publisher writes */
+    char             pad[40];           /* seq alone on its cache line */
+    lab_stats_data   d;
+} lab_stats_page;
+
+/* ---------- seqlock ---------- */
+
+/* single writer: the publisher thread */
+static inline void lab_stats_write(lab_stats_page *pg, const lab_stats_data *d) {
+    uint64_t s = atomic_load_explicit(&pg->seq, memory_order_relaxed);
+    atomic_store_explicit(&pg->seq, s + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy(&pg->d, d, sizeof *d);
+    atomic_store_explicit(&pg->seq, s + 2, memory_order_release);
+}
+
+/* 0 with a consistent copy in *d; EBUSY if the writer kept it busy */
+static inline int lab_stats_read(const lab_stats_page *pg, lab_stats_data *d,
+                                 unsigned *retries) {
+    for (unsigned i = 0; i < 1000; i++) {
+        uint64_t s1 = atomic_load_explicit((_Atomic uint64_t *)&pg->seq, memory_order_acquire);
+        if ((s1 & 1) == 0) {
+            memcpy(d, &pg->d, sizeof *d);
+            atomic_thread_fence(memory_order_acquire);
+            if (atomic_load_explicit((_Atomic uint64_t *)&pg->seq, memory_order_relaxed) == s1)
+                return 0;
+        }
+        if (retries != NULL)
+            ++*retries;
+        sched_yield();              /* the writer may be on this CPU */
+    }
+    return EBUSY;
+}
+
+static inline void lab_stats_name(char *buf, size_t len, long pid) {
+    snprintf(buf, len, "/lab_stats.%ld", pid);
+}
+
+/* Maps another process's page read-only; NULL with errno set. */
+static inline const lab_stats_page *lab_stats_attach(long pid) {
+    char name[64];
+    lab_stats_name(name, sizeof name, pid);
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+        return NULL;
+    void *m = mmap(NULL, sizeof(lab_stats_page), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (m == MAP_FAILED)
+        return NULL;
+    const lab_stats_page *pg = m;
+    if (pg->magic != LAB_STATS_MAGIC || pg->version != LAB_STATS_VERSION
+        || pg->size != sizeof *pg) {
+        munmap(m, sizeof *pg);
+        errno = EPROTO;             /* another build of this header */
+        return NULL;
+    }
+    return pg;
+}
+
+static inline void lab_stats_detach(const lab_stats_page *pg) {
+    munmap((void *)pg, sizeof *pg);
+}
+
+/* ---------- latency sampling wrapper ---------- */
+
+static hdr_hist lab_lat_g[2] = { HDR_HIST("malloc"), HDR_HIST("free") };
+static __thread unsigned lab_lat_skip[2];  /* calls left until the next sample;
+                                              one each, or alternating malloc/free
+                                              would put every sample on one side */
+static const lab_allocator *lab_timed_base;
+static lab_allocator lab_timed;
+
+static inline int lab_lat_due(int op) {
+    if (LAB_STATS_SAMPLE == 1 || __builtin_expect(lab_lat_skip[op]-- == 0, 0)) {
+        lab_lat_skip[op] = LAB_STATS_SAMPLE - 1;
+        return 1;
+    }
+    return 0;
+}
+
+static inline void *lab_timed_malloc(size_t n) {
+    if (!lab_lat_due(LAB_LAT_MALLOC))
+        return lab_timed_base->malloc(n);
+    uint64_t t = hdr_ticks();
+    void *p = lab_timed_base->malloc(n);
+    hdr_record(&lab_lat_g[LAB_LAT_MALLOC], hdr_ticks() - t);
+    return p;
+}
+
+static inline void *lab_timed_calloc(size_t n, size_t size) {
+    if (!lab_lat_due(LAB_LAT_MALLOC))
+        return lab_timed_base->calloc(n, size);
+    uint64_t t = hdr_ticks();
+    void *p = lab_timed_base->calloc(n, size);
+    hdr_record(&lab_lat_g[LAB_LAT_MALLOC], hdr_ticks() - t);
+    return p;
+}
+
+static inline void lab_timed_free(void *p) {
+    if (!lab_lat_due(LAB_LAT_FREE)) {
+        lab_timed_base->free(p);
+        return;
+    }
+    uint64_t t = hdr_ticks();
+    lab_timed_base->free(p);
+    hdr_record(&lab_lat_g[LAB_LAT_FREE], hdr_ticks() - t);
+}
+
+static inline void lab_timed_free_sized(void *p, size_t size) {
+    if (!lab_lat_due(LAB_LAT_FREE)) {
+        lab_timed_base->free_sized(p, size);
+        return;
+    }
+    uint64_t t = hdr_ticks();
+    lab_timed_base->free_sized(p, size);
+    hdr_record(&lab_lat_g[LAB_LAT_FREE], hdr_ticks() - t);
+}
+
+/* ---------- publisher ---------- */
+
+static struct {
+    pthread_mutex_t      lock;
+    pthread_cond_t       wake;
+    pthread_t            thread;
+    int                  running;
+    const lab_allocator *a;
+    lab_stats_page      *pg;
+    lab_stats_data       d;         /* built here, then copied under the seqlock */
+    char                 name[64];
+} stats_g = { .lock = PTHREAD_MUTEX_INITIALIZER, .wake = PTHREAD_COND_INITIALIZER };
+
+static inline void lab_stats_publish(void) {
+    lab_stats_data *d = &stats_g.d;
+    d->now_ns = lab_now_ns();
+    d->publishes++;
+    d->counts = stats_g.a->counts();
+    d->footprint = stats_g.a->footprint();
+    d->large = lab_large_get_stats();
+    for (int op = 0; op < 2; op++)
+        hdr_merge(&lab_lat_g[op], &d->lat[op]);
+    lab_stats_write(stats_g.pg, d);
+}
+
+static inline void *lab_stats_main(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&stats_g.lock);
+    while (stats_g.running) {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        uint64_t ns = (uint64_t)ts.tv_nsec + (uint64_t)stats_g.d.interval_ms * 1000000u;
+        ts.tv_sec += (time_t)(ns / 1000000000u);
+        ts.tv_nsec = (long)(ns % 1000000000u);
+        pthread_cond_timedwait(&stats_g.wake, &stats_g.lock, &ts);
+        if (!stats_g.running)
+            break;
+        pthread_mutex_unlock(&stats_g.lock);
+        lab_stats_publish();
+        pthread_mutex_lock(&stats_g.lock);
+    }
+    pthread_mutex_unlock(&stats_g.lock);
+    return NULL;
+}
+
+/*
+ * Creates /dev/shm/lab_stats.<pid> and publishes a's statistics into it
+ * every interval_ms. Returns the allocator to use from now on: a, with
+ * sampled malloc/free latency. NULL with errno set on failure.
+ */
+static inline const lab_allocator *lab_stats_start(const lab_allocator *a, int interval_ms) {
+    if (stats_g.running || interval_ms <= 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    lab_stats_name(stats_g.name, sizeof stats_g.name, (long)getpid());
+    int fd = shm_open(stats_g.name, O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (fd < 0)
+        return NULL;
+    void *m = MAP_FAILED;
+    if (ftruncate(fd, sizeof(lab_stats_page)) == 0)
+        m = mmap(NULL, sizeof(lab_stats_page), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    int err = errno;
+    close(fd);
+    if (m == MAP_FAILED) {
+        shm_unlink(stats_g.name);
+        errno = err;
+        return NULL;
+    }
+    stats_g.pg = m;
+    stats_g.a = a;
+    stats_g.d = (lab_stats_data){ .pid = (int32_t)getpid(),
+                                  .interval_ms = (uint32_t)interval_ms,
+                                  .started_ns = lab_now_ns(),
+                                  .sample = LAB_STATS_SAMPLE,
+                                  .ns_per_tick = hdr_ns_per_tick() };
+    snprintf(stats_g.d.allocator, sizeof stats_g.d.allocator, "%s", a->name);
+    for (unsigned c = 0; c < LAB_CLASSES; c++)
+        stats_g.d.class_size[c] = arena_class_size(c);
+    stats_g.pg->magic = LAB_STATS_MAGIC;
+    stats_g.pg->version = LAB_STATS_VERSION;
+    stats_g.pg->size = sizeof(lab_stats_page);
+    lab_stats_publish();            /* readers never see an empty page */
+
+    lab_timed_base = a;
+    lab_timed = *a;
+    lab_timed.malloc = lab_timed_malloc;
+    lab_timed.calloc = lab_timed_calloc;
+    lab_timed.free = lab_timed_free;
+    lab_timed.free_sized = lab_timed_free_sized;
+
+    pthread_condattr_t ca;
+    pthread_condattr_init(&ca);
+    pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+    pthread_cond_init(&stats_g.wake, &ca);
+    pthread_condattr_destroy(&ca);
+    stats_g.running = 1;
+    if ((err = pthread_create(&stats_g.thread, NULL, lab_stats_main, NULL)) != 0) {
+        stats_g.running = 0;
+        munmap(stats_g.pg, sizeof(lab_stats_page));
+        shm_unlink(stats_g.name);
+        errno = err;
+        return NULL;
+    }
+    return &lab_timed;
+}
+
+/* Publishes once more, then removes the segment. The wrapper returned by
+ * lab_stats_start() keeps working: it only stops being published. */
+static inline void lab_stats_stop(void) {
+    pthread_mutex_lock(&stats_g.lock);
+    int was = stats_g.running;
+    stats_g.running = 0;
+    pthread_cond_signal(&stats_g.wake);
+    pthread_mutex_unlock(&stats_g.lock);
+    if (!was)
+        return;
+    pthread_join(stats_g.thread, NULL);
+    pthread_cond_destroy(&stats_g.wake);
+    lab_stats_publish();
+    munmap(stats_g.pg, sizeof(lab_stats_page));
+    shm_unlink(stats_g.name);
+}
+
+#endif /* LAB_STATS_H */
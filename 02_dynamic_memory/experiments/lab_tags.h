@@ -0,0 +1,269 @@
+/*
+ * lab_tags.h — who owns the heap: allocation tags with per-tag budgets on
+ * top of any lab_alloc.h allocator.
+ *
+ *   lab_tag_config(TAG_STRINGS, NULL, 64 << 20, 96 << 20, on_budget, NULL);
+ *   char *s = lab_malloc_tagged(a, TAG_STRINGS, n);
+ *   lab_free_tagged(a, TAG_STRINGS, s, n);        sized, like lab_free_sized
+ *   lab_tag_snapshot(stats);                      LAB_TAGS rows for a dashboard
+ *
+ * Hot path: one add to this thread's counter (plain load + store, no lock
+ * prefix, no shared cache line) and a compare: against the thread's
+ * checkpoint on malloc, against "not registered yet" on free. Totals are folded lazily: a snapshot sums the registered
+ * threads; an exiting thread folds its counters into `retired`.
+ *
+ * Budgets are checked on the slow path, which a thread takes when its own
+ * net growth for a tag passes its checkpoint: LAB_TAG_BATCH bytes while the
+ * tag is far from its limits, a share of the headroom close to them, every
+ * allocation once over. So a hard budget can be overshot by less than one
+ * share per thread. A soft budget calls back once per crossing; the
+ * crossing back down is noticed at the next slow path, since frees never
+ * take it.
+ *
+ * Header-only; define _GNU_SOURCE before including it.
+ */
+#ifndef LAB_TAGS_H
+#define LAB_TAGS_H
+
+#include "lab_alloc.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+enum {
+    TAG_OTHER, TAG_WORKFLOW, TAG_ARRAYS, TAG_STRINGS,
+    TAG_USER,                        /* first free tag number */
+    LAB_TAGS = 16
+};
+
+#define LAB_TAG_THREADS 256
+#define LAB_TAG_BATCH   (256 << 10)   /* per-thread growth between checks */
+
+enum { LAB_BUDGET_SOFT, LAB_BUDGET_HARD };
+
+/* level: LAB_BUDGET_SOFT (crossed, allocation goes ahead) or
+ * LAB_BUDGET_HARD (this allocation is refused) */
+typedef void (*lab_budget_fn)(int tag, int level, int64_t bytes, void *arg);
+
+typedef struct {
+    const char *name;
+    int64_t     bytes;               /* net bytes live under the tag */
+    int64_t     soft, hard;          /* 0: none */
+    uint64_t    soft_events;         /* soft crossings */
+    uint64_t    denied;              /* allocations refused by the hard budget */
+} lab_tag_stat;
+
+typedef struct {
+    _Atomic int64_t bytes[LAB_TAGS]; /* owner thread writes, snapshots read */
+    _Atomic int64_t check[LAB_TAGS]; /* slow path once bytes passes this;
+                                        lab_tag_config resets it from any thread */
+    int             slot1;           /* registry slot + 1; 0: not registered */
+} lab_tag_tls;
+
+static __thread lab_tag_tls lab_tag_me; /* check[] = 0: first use registers */
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_once_t  once;
+    pthread_key_t   key;             /* runs lab_tag_retire at thread exit */
+    lab_tag_tls    *thread[LAB_TAG_THREADS];
+    int             nthreads;
+    int64_t         retired[LAB_TAGS];
+    const char     *name[LAB_TAGS];
+    int64_t         soft[LAB_TAGS], hard[LAB_TAGS];
+    lab_budget_fn   cb[LAB_TAGS];
+    void           *arg[LAB_TAGS];
+    int             over_soft[LAB_TAGS];
+    uint64_t        soft_events[LAB_TAGS], denied[LAB_TAGS];
+} lab_tags_g = {
+    .lock = PTHREAD_MUTEX_INITIALIZER, .once = PTHREAD_ONCE_INIT,
+    .name = { "other", "workflow", "arrays", "strings" },
+};
+
+/* ---------- registry (lab_tags_g.lock held) ---------- */
+
+static inline int64_t lab_tag_total(int tag) {
+    int64_t sum = lab_tags_g.retired[tag];
+    for (int i = 0; i < LAB_TAG_THREADS; i++)
+        if (lab_tags_g.thread[i] != NULL)
+            sum += atomic_load_explicit(&lab_tags_g.thread[i]->bytes[tag],
+                                        memory_order_relaxed);
+    return sum;
+}
+
+static inline void lab_tag_retire(void *arg) {
+    lab_tag_tls *t = arg;
+    pthread_mutex_lock(&lab_tags_g.lock);
+    for (int tag = 0; tag < LAB_TAGS; tag++) {
+        lab_tags_g.retired[tag] += atomic_load_explicit(&t->bytes[tag], memory_order_relaxed);
+        atomic_store_explicit(&t->bytes[tag], 0, memory_order_relaxed);
+        atomic_store_explicit(&t->check[tag], 0, memory_order_relaxed);
+    }
+    lab_tags_g.thread[t->slot1 - 1] = NULL;
+    lab_tags_g.nthreads--;
+    t->slot1 = 0;
+    pthread_mutex_unlock(&lab_tags_g.lock);
+}
+
+static inline void lab_tag_make_key(void) {
+    pthread_key_create(&lab_tags_g.key, lab_tag_retire);
+}
+
+static inline void lab_tag_register(lab_tag_tls *t) {
+    int i = 0;
+    while (i < LAB_TAG_THREADS && lab_tags_g.thread[i] != NULL)
+        i++;
+    if (i == LAB_TAG_THREADS) {
+        fprintf(stderr, "lab_tags: more than %d threads\n", LAB_TAG_THREADS);
+        abort();                     /* uncounted bytes would be worse */
+    }
+    lab_tags_g.thread[i] = t;
+    lab_tags_g.nthreads++;
+    t->slot1 = i + 1;
+    pthread_setspecific(lab_tags_g.key, t);
+}
+
+/* a thread that only frees still has to be counted */
+__attribute__((noinline, cold)) static void lab_tag_join(lab_tag_tls *t) {
+    pthread_once(&lab_tags_g.once, lab_tag_make_key);
+    pthread_mutex_lock(&lab_tags_g.lock);
+    lab_tag_register(t);
+    pthread_mutex_unlock(&lab_tags_g.lock);
+}
+
+/* ---------- slow path: budgets and the next checkpoint ---------- */
+
+/* bytes[tag] already includes the n being charged; 0 refuses it. Kept out
+ * of line so the hot path does not pay for its registers. */
+__attribute__((noinline, cold)) static int lab_tag_slow(lab_tag_tls *t, int tag, int64_t n) {
+    int fire = -1, allow = 1;
+    pthread_once(&lab_tags_g.once, lab_tag_make_key);
+    pthread_mutex_lock(&lab_tags_g.lock);
+    if (t->slot1 == 0)
+        lab_tag_register(t);
+    int64_t total = lab_tag_total(tag);
+    int64_t soft = lab_tags_g.soft[tag], hard = lab_tags_g.hard[tag];
+    if (hard && total > hard) {
+        allow = 0;
+        total -= n;
+        lab_tags_g.denied[tag]++;
+        fire = LAB_BUDGET_HARD;
+    } else if (soft && total > soft && !lab_tags_g.over_soft[tag]) {
+        lab_tags_g.over_soft[tag] = 1;
+        lab_tags_g.soft_events[tag]++;
+        fire = LAB_BUDGET_SOFT;
+    } else if (soft && total <= soft) {
+        lab_tags_g.over_soft[tag] = 0;
+    }
+    /* next check: LAB_TAG_BATCH, or this thread's share of the headroom */
+    int64_t limit = soft && !lab_tags_g.over_soft[tag] ? soft : hard;
+    int64_t step = LAB_TAG_BATCH;
+    if (limit) {
+        int64_t share = (limit - total) / lab_tags_g.nthreads;
+        step = share < 0 ? 0 : share < step ? share : step;
+    }
+    int64_t mine = atomic_load_explicit(&t->bytes[tag], memory_order_relaxed) - (allow ? 0 : n);
+    atomic_store_explicit(&t->check[tag], mine + step, memory_order_relaxed);
+    lab_budget_fn cb = lab_tags_g.cb[tag];
+    void *arg = lab_tags_g.arg[tag];
+    pthread_mutex_unlock(&lab_tags_g.lock);
+    if (fire >= 0 && cb != NULL)
+        cb(tag, fire, total, arg);
+    return allow;
+}
+
+/* ---------- hot path ---------- */
+
+static inline void lab_tag_add(lab_tag_tls *t, int tag, int64_t n) {
+    atomic_store_explicit(&t->bytes[tag],
+                          atomic_load_explicit(&t->bytes[tag], memory_order_relaxed) + n,
+                          memory_order_relaxed);
+}
+
+/* Charges n bytes to tag; 0 if its hard budget refuses them. */
+static inline int lab_tag_charge(int tag, int64_t n) {
+    lab_tag_tls *t = &lab_tag_me;
+    int64_t b = atomic_load_explicit(&t->bytes[tag], memory_order_relaxed) + n;
+    atomic_store_explicit(&t->bytes[tag], b, memory_order_relaxed);
+    if (__builtin_expect(b > atomic_load_explicit(&t->check[tag], memory_order_relaxed), 0) &&
+        !lab_tag_slow(t, tag, n)) {
+        lab_tag_add(t, tag, -n);
+        return 0;
+    }
+    return 1;
+}
+
+static inline void lab_tag_credit(int tag, int64_t n) {
+    lab_tag_tls *t = &lab_tag_me;
+    if (__builtin_expect(t->slot1 == 0, 0))
+        lab_tag_join(t);
+    lab_tag_add(t, tag, -n);
+}
+
+static inline void *lab_malloc_tagged(const lab_allocator *a, int tag, size_t n) {
+    if (!lab_tag_charge(tag, (int64_t)n))
+        return NULL;
+    void *p = a->malloc(n);
+    if (p == NULL)
+        lab_tag_credit(tag, (int64_t)n);
+    return p;
+}
+
+/* n must be the size passed to lab_malloc_tagged: frees are sized */
+static inline void lab_free_tagged(const lab_allocator *a, int tag, void *p, size_t n) {
+    if (p == NULL)
+        return;
+    lab_tag_credit(tag, (int64_t)n);
+    lab_free_sized(a, p, n);
+}
+
+static inline void *lab_realloc_tagged(const lab_allocator *a, int tag, void *p,
+                                       size_t old, size_t n) {
+    if (n > old && !lab_tag_charge(tag, (int64_t)(n - old)))
+        return NULL;
+    void *q = a->realloc(p, n);
+    if (q == NULL && n != 0) {
+        if (n > old)
+            lab_tag_credit(tag, (int64_t)(n - old));
+        return NULL;
+    }
+    if (n < old)
+        lab_tag_credit(tag, (int64_t)(old - n));
+    return q;
+}
+
+/* ---------- configuration and snapshots ---------- */
+
+/* soft, hard: bytes, 0 for none; cb may be NULL. name may be NULL to keep it. */
+static inline void lab_tag_config(int tag, const char *name, int64_t soft, int64_t hard,
+                                  lab_budget_fn cb, void *arg) {
+    pthread_mutex_lock(&lab_tags_g.lock);
+    if (name != NULL)
+        lab_tags_g.name[tag] = name;
+    lab_tags_g.soft[tag] = soft;
+    lab_tags_g.hard[tag] = hard;
+    lab_tags_g.cb[tag] = cb;
+    lab_tags_g.arg[tag] = arg;
+    lab_tags_g.over_soft[tag] = 0;
+    for (int i = 0; i < LAB_TAG_THREADS; i++)     /* re-check at the next charge */
+        if (lab_tags_g.thread[i] != NULL)
+            atomic_store_explicit(&lab_tags_g.thread[i]->check[tag], 0, memory_order_relaxed);
+    pthread_mutex_unlock(&lab_tags_g.lock);
+}
+
+/* Fills out[0..LAB_TAGS-1]; other threads' counters are read as they are,
+ * so a busy tag can be off by the allocations in flight. */
+static inline void lab_tag_snapshot(lab_tag_stat out[LAB_TAGS]) {
+    pthread_mutex_lock(&lab_tags_g.lock);
+    for (int tag = 0; tag < LAB_TAGS; tag++)
+        out[tag] = (lab_tag_stat){
+            lab_tags_g.name[tag], lab_tag_total(tag), lab_tags_g.soft[tag],
+            lab_tags_g.hard[tag], lab_tags_g.soft_events[tag], lab_tags_g.denied[tag],
+        };
+    pthread_mutex_unlock(&lab_tags_g.lock);
+}
+
+#endif /* LAB_TAGS_H */
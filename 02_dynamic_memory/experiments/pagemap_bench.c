@@ -0,0 +1,222 @@
+/*
+ * pagemap_bench.c — what a 16-byte block header costs, and what the
+ * header-less page-map allocator in lab_alloc.h saves.
+ *
+ *   gcc -O2 -pthread pagemap_bench.c -o pagemap_bench
+ *   ./pagemap_bench [objects]          default 1M objects per size
+ *
+ * 1. Memory: allocate N objects of one size and divide the allocator's
+ *    footprint growth by N — bytes per object, headers, rounding and slack
+ *    included. Each allocator runs in its own child process.
+ * 2. Time: free N 32-byte objects, in allocation order and shuffled, with
+ *    free() (page-map lookup) and lab_free_sized() (class from the size).
+ */
+#define _GNU_SOURCE
+#include "lab_alloc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static uint64_t rng = 88172645463325252ULL;
+static uint64_t rnd(void) {
+    rng ^= rng << 13, rng ^= rng >> 7, rng ^= rng << 17;
+    return rng;
+}
+
+static void shuffle(void **v, size_t n) {
+    for (size_t i = n - 1; i > 0; i--) {
+        size_t j = rnd() % (i + 1);
+        void *t = v[i];
+        v[i] = v[j];
+        v[j] = t;
+    }
+}
+
+/* ---------- self-test ---------- */
+
+static void self_test(void) {
+    static const size_t sizes[] = { 1, 15, 16, 17, 100, 256, 257, 4000, 65536,
+                                    65537, 300000 };
+    enum { N = sizeof sizes / sizeof sizes[0] };
+    const lab_allocator *a = &lab_pagemap;
+    unsigned char *p[N];
+
+    for (int i = 0; i < N; i++) {
+        p[i] = a->malloc(sizes[i]);
+        memset(p[i], i + 1, sizes[i]);
+        if (pm_usable(p[i]) < sizes[i]) {
+            fprintf(stderr, "self-test: usable %zu < %zu\n", pm_usable(p[i]), sizes[i]);
+            exit(1);
+        }
+    }
+    for (int i = 0; i < N; i++) {            /* grow small -> large -> small */
+        size_t n = sizes[N - 1 - i];
+        p[i] = a->realloc(p[i], n);
+        size_t keep = n < sizes[i] ? n : sizes[i];
+        for (size_t k = 0; k < keep; k++)
+            if (p[i][k] != i + 1) {
+                fprintf(stderr, "self-test: realloc lost byte %zu of %zu\n", k, keep);
+                exit(1);
+            }
+    }
+    for (int i = 0; i < N; i++)              /* sized and unsized frees mixed */
+        if (i & 1)
+            lab_free_sized(a, p[i], sizes[N - 1 - i]);
+        else
+            a->free(p[i]);
+
+    /* freed blocks come back from the class that free_sized() chose */
+    void *x = a->malloc(40);
+    lab_free_sized(a, x, 40);
+    void *y = a->malloc(48);
+    if (x != y) {
+        fprintf(stderr, "self-test: free_sized used the wrong class\n");
+        exit(1);
+    }
+    a->free(y);
+    lab_large_purge(0);                      /* the parked large blocks too */
+    if (pm_footprint() != PM_CHUNK + PM_META) {
+        fprintf(stderr, "self-test: %zu bytes still mapped\n", pm_footprint());
+        exit(1);
+    }
+    puts("self-test: ok");
+}
+
+/* in a child too: the parent must fork the measurements with nothing mapped,
+ * or they start from the chunk the self-test leaves behind */
+static void self_test_apart(void) {
+    int st = 1;
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        self_test();
+        fflush(stdout);
+        _exit(0);
+    }
+    if (pid < 0 || waitpid(pid, &st, 0) != pid || !WIFEXITED(st) || WEXITSTATUS(st) != 0)
+        exit(1);
+}
+
+/* ---------- memory per object ---------- */
+
+static double bytes_per_object(const lab_allocator *a, size_t size, size_t n) {
+    void **v = malloc(n * sizeof *v);        /* glibc: before the baseline */
+    size_t before = a->footprint();
+    for (size_t i = 0; i < n; i++)
+        v[i] = a->malloc(size);
+    double per = (double)(a->footprint() - before) / (double)n;
+    for (size_t i = 0; i < n; i++)
+        a->free(v[i]);
+    free(v);
+    return per;
+}
+
+/* in a child, so one allocator's leftovers don't show in the next one */
+static double measure(const lab_allocator *a, size_t size, size_t n) {
+    int fd[2];
+    double per = 0;
+    if (pipe(fd) != 0)
+        return 0;
+    pid_t pid = fork();
+    if (pid == 0) {
+        per = bytes_per_object(a, size, n);
+        if (write(fd[1], &per, sizeof per) != sizeof per)
+            _exit(1);
+        _exit(0);
+    }
+    close(fd[1]);
+    if (read(fd[0], &per, sizeof per) != sizeof per)
+        per = 0;
+    close(fd[0]);
+    waitpid(pid, NULL, 0);
+    return per;
+}
+
+/* ---------- free vs free_sized ---------- */
+
+static double time_free(const lab_allocator *a, void **v, size_t n, size_t size,
+                        int sized, int shuffled) {
+    for (size_t i = 0; i < n; i++)
+        v[i] = a->malloc(size);
+    if (shuffled)
+        shuffle(v, n);
+    double t = now_sec();
+    if (sized)
+        for (size_t i = 0; i < n; i++)
+            lab_free_sized(a, v[i], size);
+    else
+        for (size_t i = 0; i < n; i++)
+            a->free(v[i]);
+    return (now_sec() - t) / (double)n * 1e9;
+}
+
+/*
+ * Best of 15, in a fresh child: once a shuffled run has refilled the free
+ * lists, even "in order" frees would walk memory at random.
+ */
+static double best_free(const lab_allocator *a, size_t n, int sized, int shuffled) {
+    int fd[2];
+    double best = 1e9;
+    if (pipe(fd) != 0)
+        return 0;
+    pid_t pid = fork();
+    if (pid == 0) {
+        void **v = malloc(n * sizeof *v);
+        for (int r = 0; r < 15; r++) {
+            double t = time_free(a, v, n, 32, sized, shuffled);
+            if (t < best)
+                best = t;
+        }
+        if (write(fd[1], &best, sizeof best) != sizeof best)
+            _exit(1);
+        _exit(0);
+    }
+    close(fd[1]);
+    if (read(fd[0], &best, sizeof best) != sizeof best)
+        best = 0;
+    close(fd[0]);
+    waitpid(pid, NULL, 0);
+    return best;
+}
+
+int main(int argc, char **argv) {
+    size_t n = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+    self_test_apart();
+
+    static const size_t sizes[] = { 8, 16, 24, 32, 48, 64, 96, 128, 256, 1024, 4096 };
+    printf("\nbytes per object (%zu objects)\n", n);
+    printf("%6s %9s %9s %9s %13s\n", "size", "glibc", "arena", "pagemap", "saved/arena");
+    for (size_t i = 0; i < sizeof sizes / sizeof sizes[0]; i++) {
+        size_t s = sizes[i], m = s >= 1024 ? n / 8 : n;
+        double g = measure(&lab_glibc, s, m);
+        double ar = measure(&lab_arena, s, m);
+        double pm = measure(&lab_pagemap, s, m);
+        printf("%6zu %9.1f %9.1f %9.1f %12.0f%%\n", s, g, ar, pm, 100.0 * (1.0 - pm / ar));
+    }
+
+    static const char *const what[3] = {
+        "arena   free()        header read before the block",
+        "pagemap free()        root -> leaf lookup",
+        "pagemap free_sized()  class from the size",
+    };
+    printf("\nfree of %zu 32-byte objects, ns each (best of 15)\n", n);
+    printf("%-52s %8s %8s\n", "", "in order", "shuffled");
+    for (int i = 0; i < 3; i++) {
+        const lab_allocator *a = i == 0 ? &lab_arena : &lab_pagemap;
+        double best[2];
+        for (int sh = 0; sh < 2; sh++)
+            best[sh] = best_free(a, n, i == 2, sh);
+        printf("  %-50s %8.1f %8.1f\n", what[i], best[0], best[1]);
+    }
+    return 0;
+}
@@ -0,0 +1,400 @@
+/*
+ * persistent_heap.c — file-backed heap whose pointers survive restarts.
+ *
+ * Every link stored inside the heap is an *offset* from the heap base
+ * (see 01_intro/notes/11_intptr_t_and_uintptr_t.md for the uintptr_t
+ * round-trip). Offsets are swizzled into native pointers lazily, the first
+ * time a slot is dereferenced, so reopening the file costs one mmap().
+ *
+ *   ./persistent_heap build heap.bin 1000000   # create + fill a list
+ *   ./persistent_heap load  heap.bin           # reopen + walk it
+ *   ./persistent_heap pop   heap.bin           # free the first node
+ *   ./persistent_heap crash heap.bin           # die mid-transaction
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define PH_MAGIC     0x5048454150303031ULL /* "PHEAP001" */
+#define PH_ALIGN     16u
+#define PH_CLASSES   32u                   /* size classes: 16, 32, ... 512 */
+#define PH_LOG_MAX   16u
+#define PH_DEFAULT   (64u << 20)           /* 64 MB file */
+
+/*
+ * Slot encoding (one 64-bit word stored in the file):
+ *   0             -> NULL
+ *   bit 0 == 1    -> persistent form: (offset << 1) | 1
+ *   bit 0 == 0    -> swizzled form: absolute address in the mapping that
+ *                    was active when header->swizzle_base was recorded
+ */
+typedef uint64_t pslot;
+
+typedef struct {
+    uint64_t off;      /* where the word lives (offset in heap) */
+    uint64_t old;      /* value before the transaction touched it */
+} ph_undo;
+
+typedef struct {
+    uint64_t magic;
+    uint64_t size;                 /* bytes in file */
+    uint64_t swizzle_base;         /* base that swizzled slots refer to */
+    uint64_t top;                  /* bump pointer (offset) */
+    uint64_t free_head[PH_CLASSES];/* offset of first free block per class */
+    pslot    root;                 /* user entry point */
+    /* undo log: valid != 0 means a transaction was in flight */
+    uint64_t log_valid;
+    uint64_t log_count;
+    ph_undo  log[PH_LOG_MAX];
+} ph_header;
+
+typedef struct {
+    uint64_t size_class;           /* index into free_head[] */
+    uint64_t next;                 /* free-list link (offset), 0 if in use */
+} ph_block;
+
+typedef struct {
+    int        fd;
+    char      *base;
+    ph_header *hdr;
+    int        sync;               /* msync on every commit? */
+} pheap;
+
+/* ---------- offset <-> pointer ---------- */
+
+static inline void *ph_ptr(const pheap *h, uint64_t off) {
+    return off ? h->base + off : NULL;
+}
+
+static inline uint64_t ph_off(const pheap *h, const void *p) {
+    return p ? (uint64_t)((uintptr_t)p - (uintptr_t)h->base) : 0;
+}
+
+/* Lazy swizzle: decode a slot, and if this mapping is the one that owns
+ * swizzled words, rewrite the slot so the next load is a plain pointer. */
+static void *pslot_get(pheap *h, pslot *slot) {
+    pslot w = *slot;
+    if (w == 0)
+        return NULL;
+    if (w & 1u) {
+        void *p = h->base + (w >> 1);
+        if (h->hdr->swizzle_base == (uintptr_t)h->base)
+            *slot = (pslot)(uintptr_t)p;    /* swizzle in place */
+        return p;
+    }
+    if (h->hdr->swizzle_base == (uintptr_t)h->base)
+        return (void *)(uintptr_t)w;        /* already swizzled */
+    /* mapped elsewhere: translate relative to the recorded base */
+    return h->base + (w - h->hdr->swizzle_base);
+}
+
+/* Stores always use the persistent form. */
+static inline void pslot_set(pheap *h, pslot *slot, const void *p) {
+    *slot = p ? (ph_off(h, p) << 1) | 1u : 0;
+}
+
+/* ---------- crash consistency (undo log) ---------- */
+
+static void ph_flush(pheap *h, const void *addr, size_t len) {
+    if (!h->sync)
+        return;
+    long pg = sysconf(_SC_PAGESIZE);
+    uintptr_t start = (uintptr_t)addr & ~(uintptr_t)(pg - 1);
+    msync((void *)start, (uintptr_t)addr + len - start, MS_SYNC);
+}
+
+static void ph_tx_begin(pheap *h) {
+    h->hdr->log_count = 0;
+}
+
+/* Record the current value of a metadata word before modifying it. */
+static void ph_tx_log(pheap *h, uint64_t *word) {
+    ph_header *hd = h->hdr;
+    if (hd->log_count == PH_LOG_MAX) {
+        fprintf(stderr, "pheap: undo log overflow\n");
+        abort();
+    }
+    hd->log[hd->log_count].off = ph_off(h, word);
+    hd->log[hd->log_count].old = *word;
+    hd->log_count++;
+}
+
+/* Drop a transaction that was never armed: nothing was modified yet. */
+static void ph_tx_abort(pheap *h) {
+    h->hdr->log_count = 0;
+}
+
+static void ph_tx_arm(pheap *h) {
+    ph_flush(h, h->hdr->log, sizeof h->hdr->log);
+    h->hdr->log_valid = 1;
+    ph_flush(h, &h->hdr->log_valid, sizeof h->hdr->log_valid);
+}
+
+static void ph_tx_commit(pheap *h) {
+    ph_flush(h, h->base, h->hdr->top);   /* data + metadata reach the file */
+    h->hdr->log_valid = 0;
+    ph_flush(h, &h->hdr->log_valid, sizeof h->hdr->log_valid);
+}
+
+/* Called on open: roll back a transaction that never committed. */
+static void ph_recover(pheap *h) {
+    ph_header *hd = h->hdr;
+    if (!hd->log_valid)
+        return;
+    for (uint64_t i = hd->log_count; i-- > 0;) {
+        uint64_t *word = (uint64_t *)(h->base + hd->log[i].off);
+        *word = hd->log[i].old;
+    }
+    hd->log_valid = 0;
+    ph_flush(h, h->base, hd->size);
+    fprintf(stderr, "pheap: rolled back %llu metadata words\n",
+            (unsigned long long)hd->log_count);
+}
+
+/* ---------- open / close ---------- */
+
+static int pheap_open(pheap *h, const char *path, size_t size, int sync) {
+    ph_header probe;
+    int created = 0;
+
+    memset(h, 0, sizeof *h);
+    h->sync = sync;
+    h->fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (h->fd >= 0)
+        created = 1;
+    else if (errno == EEXIST)
+        h->fd = open(path, O_RDWR);
+    if (h->fd < 0)
+        return -1;
+
+    void *hint = NULL;
+    struct stat st;
+    if (!created && pread(h->fd, &probe, sizeof probe, 0) == (ssize_t)sizeof probe &&
+        probe.magic == PH_MAGIC) {
+        size = probe.size;
+        hint = (void *)(uintptr_t)probe.swizzle_base; /* ask for the old address */
+    } else if (!created && (fstat(h->fd, &st) != 0 || st.st_size != 0)) {
+        close(h->fd);                        /* someone else's file: leave it alone */
+        errno = EINVAL;
+        return -1;
+    } else {
+        if (ftruncate(h->fd, (off_t)size) != 0) {
+            close(h->fd);
+            return -1;
+        }
+        created = 1;
+    }
+
+    h->base = mmap(hint, size, PROT_READ | PROT_WRITE, MAP_SHARED, h->fd, 0);
+    if (h->base == MAP_FAILED) {
+        close(h->fd);
+        return -1;
+    }
+    h->hdr = (ph_header *)h->base;
+
+    if (created) {
+        memset(h->hdr, 0, sizeof *h->hdr);
+        h->hdr->size = size;
+        h->hdr->swizzle_base = (uintptr_t)h->base;
+        h->hdr->top = (sizeof(ph_header) + PH_ALIGN - 1) & ~(uint64_t)(PH_ALIGN - 1);
+        h->hdr->magic = PH_MAGIC;            /* written last */
+        ph_flush(h, h->hdr, sizeof *h->hdr);
+    } else {
+        ph_recover(h);
+    }
+    return 0;
+}
+
+static void pheap_close(pheap *h) {
+    ph_flush(h, h->base, h->hdr->size);
+    munmap(h->base, h->hdr->size);
+    close(h->fd);
+}
+
+/* ---------- allocation ---------- */
+
+static unsigned ph_class(size_t n) {
+    size_t rounded = (n + PH_ALIGN - 1) / PH_ALIGN;
+    return rounded ? (unsigned)(rounded - 1) : 0;
+}
+
+/* Allocate and publish into `dest` as one transaction: after a crash the
+ * block is either reachable from `dest` or still on the free list. */
+static void *pheap_alloc_into(pheap *h, pslot *dest, size_t n) {
+    unsigned c = ph_class(n);
+    if (c >= PH_CLASSES)
+        return NULL;
+    ph_header *hd = h->hdr;
+    ph_block *b;
+
+    ph_tx_begin(h);
+    ph_tx_log(h, (uint64_t *)dest);
+    if (hd->free_head[c]) {
+        b = ph_ptr(h, hd->free_head[c]);
+        ph_tx_log(h, &hd->free_head[c]);
+        ph_tx_log(h, &b->next);              /* or a rollback loses the rest of the list */
+        ph_tx_arm(h);
+        hd->free_head[c] = b->next;
+    } else {
+        uint64_t need = sizeof(ph_block) + (uint64_t)(c + 1) * PH_ALIGN;
+        if (hd->top + need > hd->size) {
+            ph_tx_abort(h);
+            return NULL;
+        }
+        b = ph_ptr(h, hd->top);
+        ph_tx_log(h, &hd->top);
+        ph_tx_arm(h);
+        hd->top += need;
+        b->size_class = c;
+    }
+    b->next = 0;
+    void *user = b + 1;
+    pslot_set(h, dest, user);
+    ph_tx_commit(h);
+    return user;
+}
+
+/* Replace `*src` with `repl` and push the old target on the free list as
+ * one transaction (repl is usually the freed object's own next link). */
+static void pheap_free_from(pheap *h, pslot *src, pslot repl) {
+    void *user = pslot_get(h, src);
+    if (!user)
+        return;
+    ph_block *b = (ph_block *)user - 1;
+    ph_header *hd = h->hdr;
+
+    ph_tx_begin(h);
+    ph_tx_log(h, (uint64_t *)src);
+    ph_tx_log(h, &hd->free_head[b->size_class]);
+    ph_tx_log(h, &b->next);
+    ph_tx_arm(h);
+    *src = repl;
+    b->next = hd->free_head[b->size_class];
+    hd->free_head[b->size_class] = ph_off(h, b);
+    ph_tx_commit(h);
+}
+
+/* ---------- demo: a persistent singly linked list ---------- */
+
+typedef struct node {
+    pslot   next;
+    int64_t value;
+} node;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int cmd_build(const char *path, long n) {
+    pheap h;
+    unlink(path);
+    if (pheap_open(&h, path, PH_DEFAULT, 0) != 0) {
+        perror("pheap_open");
+        return 1;
+    }
+    double t0 = now_sec();
+    pslot *tail = &h.hdr->root;
+    long i;
+    for (i = 0; i < n; i++) {
+        node *nd = pheap_alloc_into(&h, tail, sizeof(node));
+        if (!nd) {
+            fprintf(stderr, "heap full after %ld nodes\n", i);
+            break;
+        }
+        nd->value = i;
+        tail = &nd->next;
+    }
+    printf("built %ld nodes in %.3f s (base %p)\n", i, now_sec() - t0,
+           (void *)h.base);
+    h.sync = 1;
+    pheap_close(&h);
+    return i < n;               /* the list is kept, but it is short */
+}
+
+static int cmd_load(const char *path) {
+    pheap h;
+    double t0 = now_sec();
+    if (pheap_open(&h, path, PH_DEFAULT, 0) != 0) {
+        perror("pheap_open");
+        return 1;
+    }
+    double t_open = now_sec() - t0;
+
+    t0 = now_sec();
+    long count = 0;
+    int64_t sum = 0;
+    for (node *nd = pslot_get(&h, &h.hdr->root); nd;
+         nd = pslot_get(&h, &nd->next)) {
+        sum += nd->value;
+        count++;
+    }
+    double t_walk = now_sec() - t0;
+
+    int same = h.hdr->swizzle_base == (uintptr_t)h.base;
+    printf("open %.3f ms | walk %ld nodes %.3f ms | sum %lld | %s mapping\n",
+           t_open * 1e3, count, t_walk * 1e3, (long long)sum,
+           same ? "same" : "relocated");
+    pheap_close(&h);
+    return 0;
+}
+
+static int cmd_pop(const char *path) {
+    pheap h;
+    if (pheap_open(&h, path, PH_DEFAULT, 1) != 0) {
+        perror("pheap_open");
+        return 1;
+    }
+    node *first = pslot_get(&h, &h.hdr->root);
+    if (first) {
+        printf("popped %lld\n", (long long)first->value);
+        pheap_free_from(&h, &h.hdr->root, first->next);
+    }
+    pheap_close(&h);
+    return 0;
+}
+
+/* Start a free but never commit it: the next load must roll it back. */
+static int cmd_crash(const char *path) {
+    pheap h;
+    if (pheap_open(&h, path, PH_DEFAULT, 1) != 0) {
+        perror("pheap_open");
+        return 1;
+    }
+    node *first = pslot_get(&h, &h.hdr->root);
+    if (!first)
+        return 0;
+    ph_tx_begin(&h);
+    ph_tx_log(&h, (uint64_t *)&h.hdr->root);
+    ph_tx_arm(&h);
+    h.hdr->root = first->next;        /* half-done unlink */
+    msync(h.base, h.hdr->size, MS_SYNC);
+    fprintf(stderr, "simulated crash mid-transaction\n");
+    _exit(1);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s build|load|pop|crash FILE [N]\n", argv[0]);
+        return 2;
+    }
+    if (strcmp(argv[1], "build") == 0)
+        return cmd_build(argv[2], argc > 3 ? atol(argv[3]) : 1000000);
+    if (strcmp(argv[1], "load") == 0)
+        return cmd_load(argv[2]);
+    if (strcmp(argv[1], "pop") == 0)
+        return cmd_pop(argv[2]);
+    if (strcmp(argv[1], "crash") == 0)
+        return cmd_crash(argv[2]);
+    fprintf(stderr, "unknown command '%s'\n", argv[1]);
+    return 2;
+}
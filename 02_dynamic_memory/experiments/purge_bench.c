@@ -0,0 +1,368 @@
+/*
+ * purge_bench.c — resident memory vs latency for the large-block cache,
+ * the pagemap's empty slabs and their decay, over bursty workloads in real
+ * time.
+ *
+ *   gcc -O2 -pthread purge_bench.c -o purge_bench
+ *   ./purge_bench [cycles]             default 6 bursts
+ *
+ * Large: a burst of 2000 large buffers (128 KB - 2 MB, a window of 16
+ * live, one byte written per page as real use would), everything freed,
+ * then 300 ms idle. Small: a burst of 200 000 blocks of 16 - 512 bytes,
+ * all live at the peak, freed in random order, then 300 ms idle. A sampler
+ * thread reads VmRSS every 5 ms; getrusage() counts the page faults. Each
+ * row runs in its own child: glibc as is, glibc with malloc_trim() on a
+ * timer, and arena or pagemap with decay times from "at free" to "never".
+ * Every purging row has the purger thread waking each 10 ms.
+ */
+#define _GNU_SOURCE
+#include "lab_alloc.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+enum { BURST = 2000, WINDOW = 16, SMALL_BURST = 200000, IDLE_MS = 300, SAMPLE_MS = 5 };
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static uint64_t rng = 88172645463325252ULL;
+static uint64_t rnd(void) {
+    rng ^= rng << 13, rng ^= rng >> 7, rng ^= rng << 17;
+    return rng;
+}
+
+/* VmRSS in KB, read without stdio so the heap is left alone */
+static size_t rss_kb(void) {
+    char text[4096];
+    int fd = open("/proc/self/status", O_RDONLY);
+    ssize_t n = fd < 0 ? -1 : read(fd, text, sizeof text - 1);
+    if (fd >= 0)
+        close(fd);
+    if (n <= 0)
+        return 0;
+    text[n] = '\0';
+    const char *p = strstr(text, "VmRSS:");
+    return p ? strtoul(p + 6, NULL, 10) : 0;
+}
+
+static void sleep_ms(int ms) {
+    struct timespec ts = { ms / 1000, (long)(ms % 1000) * 1000000 };
+    while (nanosleep(&ts, &ts) != 0)
+        ;
+}
+
+/* ---------- self-test ---------- */
+
+static void expect(int ok, const char *what) {
+    if (!ok) {
+        fprintf(stderr, "self-test: %s\n", what);
+        exit(1);
+    }
+}
+
+static void self_test(void) {
+    const lab_allocator *a = &lab_arena;
+    size_t mb = 1u << 20;
+
+    lab_decay_set(-1, MADV_DONTNEED);
+    unsigned char *p = a->malloc(mb);
+    memset(p, 0xaa, mb);
+    size_t len = large_len(p), pm_before = lab_pagemap.footprint();
+    a->free(p);
+    lab_large_stats st = lab_large_get_stats();
+    expect(st.dirty == len && st.cached == len, "a freed block is parked dirty");
+    expect(lab_pagemap.footprint() == pm_before, "parked bytes count for their owner only");
+    unsigned char *q = a->calloc(1, mb);             /* reused dirty: must zero */
+    expect(q == p && q[0] == 0 && q[mb - 1] == 0, "calloc of a dirty block");
+    a->free(q);
+    expect(lab_large_purge(0) == len && lab_large_get_stats().dirty == 0, "purge");
+    q = a->malloc(mb);
+    expect(q == p && q[4096] == 0, "a purged block reads back zero");
+    a->free(q);
+
+    /* a long block serves a short request and keeps its tail parked */
+    p = a->malloc(4 * mb);
+    a->free(p);
+    q = a->malloc(mb);
+    expect(lab_large_get_stats().cached >= 3 * mb, "split keeps the tail");
+    a->free(q);
+
+    lab_decay_set(0, MADV_DONTNEED);                 /* purge at free */
+    a->free(a->malloc(mb));
+    expect(lab_large_get_stats().dirty == 0, "decay 0 purges at free");
+
+    lab_purger_start(a, (lab_purge_opts){ 20, 1000, MADV_DONTNEED });
+    lab_purger_start(a, (lab_purge_opts){ 20, 5, MADV_DONTNEED });     /* retune */
+    a->free(a->malloc(2 * mb));
+    expect(lab_large_get_stats().dirty > 0, "decay 20 ms keeps it for now");
+    sleep_ms(100);
+    expect(lab_large_get_stats().dirty == 0, "the purger thread applies the decay");
+    lab_purger_stop();
+
+    /* pagemap: a slab whose blocks are all free is given back, and reused */
+    const lab_allocator *pm = &lab_pagemap;
+    enum { N = 10000 };
+    static void *v[N];
+    lab_decay_set(-1, MADV_DONTNEED);
+    for (int i = 0; i < N; i++)
+        memset(v[i] = pm->malloc(100), 0xbb, 100);
+    size_t full = pm->footprint();
+    for (int i = 0; i < N; i++)
+        pm->free(v[i]);
+    expect(pm->footprint() == full, "decay -1 keeps empty slabs");
+    pm->purge(0);
+    size_t purged = pm->footprint();                 /* all but the current slab */
+    expect(purged <= full - (N * 112 - pm_slab_bytes(arena_class(100))), "empty slabs purged");
+    for (int i = 0; i < N; i++) {
+        unsigned char *q = v[i] = pm->malloc(100);
+        expect(q != NULL && (q[99] == 0 || q[99] == 0xbb), "a purged slab is reused");
+        memset(q, 0xcc, 100);
+    }
+    expect(pm->footprint() == full, "reuse maps nothing new");
+    for (int i = 0; i < N; i += 2)                   /* half free: no slab empties */
+        pm->free(v[i]);
+    expect(pm->purge(0) == 0, "a slab with a live block stays");
+    lab_decay_set(0, MADV_DONTNEED);                 /* purge at free */
+    for (int i = 1; i < N; i += 2)
+        pm->free(v[i]);
+    expect(pm->footprint() == purged, "decay 0 purges a slab as it empties");
+}
+
+/* ---------- the bursty workload ---------- */
+
+static struct {
+    volatile int stop, idle;
+    double       sum, idle_sum;
+    size_t       n, idle_n, peak;
+} smp;
+
+static void *sampler(void *arg) {
+    (void)arg;
+    while (!smp.stop) {
+        size_t kb = rss_kb();
+        smp.sum += (double)kb;
+        smp.n++;
+        if (smp.idle) {
+            smp.idle_sum += (double)kb;
+            smp.idle_n++;
+        }
+        if (kb > smp.peak)
+            smp.peak = kb;
+        sleep_ms(SAMPLE_MS);
+    }
+    return NULL;
+}
+
+static int by_value(const void *x, const void *y) {
+    double a = *(const double *)x, b = *(const double *)y;
+    return (a > b) - (a < b);
+}
+
+typedef struct {
+    double ns_op, p99_us, faults, mean_mb, idle_mb, peak_mb, hit;
+} result;
+
+static result rss_result(result r, size_t base) {
+    r.mean_mb = (smp.sum / (double)smp.n - (double)base) / 1024;
+    r.idle_mb = (smp.idle_sum / (double)smp.idle_n - (double)base) / 1024;
+    r.peak_mb = (double)(smp.peak - base) / 1024;
+    return r;
+}
+
+/* ns_op: a malloc + free pair; p99 is not timed per call here */
+static result small_workload(const lab_allocator *a, int cycles) {
+    static unsigned char *obj[SMALL_BURST];
+    memset(obj, 0, sizeof obj);                  /* resident before the baseline */
+    pthread_t th;
+    size_t base = rss_kb();
+    struct rusage ru0, ru1;
+    getrusage(RUSAGE_SELF, &ru0);
+    double busy = 0;
+
+    pthread_create(&th, NULL, sampler, NULL);
+    for (int c = 0; c < cycles; c++) {
+        smp.idle = 0;
+        double t = now_sec();
+        for (int i = 0; i < SMALL_BURST; i++) {
+            size_t n = 16 + rnd() % 497;
+            obj[i] = a->malloc(n);
+            memset(obj[i], i, n < 64 ? n : 64);
+        }
+        busy += now_sec() - t;
+        for (int i = SMALL_BURST - 1; i > 0; i--) {  /* free in random order */
+            int j = (int)(rnd() % (uint64_t)(i + 1));
+            unsigned char *x = obj[i];
+            obj[i] = obj[j];
+            obj[j] = x;
+        }
+        t = now_sec();
+        for (int i = 0; i < SMALL_BURST; i++)
+            a->free(obj[i]);
+        busy += now_sec() - t;
+        smp.idle = 1;
+        sleep_ms(IDLE_MS);
+    }
+    smp.stop = 1;
+    pthread_join(th, NULL);
+    getrusage(RUSAGE_SELF, &ru1);
+
+    result r = { 0 };
+    double ops = (double)cycles * SMALL_BURST;
+    r.ns_op = busy / ops * 1e9;
+    r.faults = (double)(ru1.ru_minflt - ru0.ru_minflt) / ops;
+    return rss_result(r, base);
+}
+
+static result workload(const lab_allocator *a, int cycles) {
+    static double lat[BURST * 64];
+    static unsigned char *win[WINDOW];
+    size_t nlat = 0;
+    uint64_t hits0 = lab_large_get_stats().hits, miss0 = lab_large_get_stats().misses;
+    pthread_t th;
+    size_t base = rss_kb();
+    struct rusage ru0, ru1;
+    getrusage(RUSAGE_SELF, &ru0);
+
+    pthread_create(&th, NULL, sampler, NULL);
+    for (int c = 0; c < cycles && c < 64; c++) {
+        smp.idle = 0;
+        for (int i = 0; i < BURST; i++) {
+            size_t n = (128u << 10) + rnd() % (2u << 20);
+            double t = now_sec();
+            if (win[i % WINDOW] != NULL)
+                a->free(win[i % WINDOW]);
+            unsigned char *p = a->malloc(n);
+            for (size_t k = 0; k < n; k += 4096)
+                p[k] = (unsigned char)i;
+            win[i % WINDOW] = p;
+            lat[nlat++] = now_sec() - t;
+        }
+        for (int i = 0; i < WINDOW; i++) {
+            a->free(win[i]);
+            win[i] = NULL;
+        }
+        smp.idle = 1;
+        sleep_ms(IDLE_MS);
+    }
+    smp.stop = 1;
+    pthread_join(th, NULL);
+    getrusage(RUSAGE_SELF, &ru1);
+
+    result r = { 0 };
+    double total = 0;
+    for (size_t i = 0; i < nlat; i++)
+        total += lat[i];
+    qsort(lat, nlat, sizeof *lat, by_value);
+    r.ns_op = total / (double)nlat * 1e9;
+    r.p99_us = lat[nlat * 99 / 100] * 1e6;
+    r.faults = (double)(ru1.ru_minflt - ru0.ru_minflt) / (double)nlat;
+    r = rss_result(r, base);
+    uint64_t hits = lab_large_get_stats().hits - hits0;
+    uint64_t miss = lab_large_get_stats().misses - miss0;
+    r.hit = hits + miss ? 100.0 * (double)hits / (double)(hits + miss) : 0;
+    return r;
+}
+
+typedef struct {
+    const char          *name;
+    const lab_allocator *a;
+    lab_purge_opts       o;
+    int                  purger;
+} config;
+
+/* every row in its own child, so no row starts with another's heap */
+static int run_table(const config *cf, size_t n, int small, int cycles) {
+    printf("%-28s %8s %8s %8s %9s %9s %9s %6s\n", "", "ns/op", "p99 us", "faults",
+           "mean RSS", "idle RSS", "peak RSS", "reuse");
+    for (size_t i = 0; i < n; i++) {
+        int fd[2];
+        pid_t pid;
+        result r = { 0 };
+        if (pipe(fd) != 0)
+            return 1;
+        fflush(stdout);
+        if ((pid = fork()) == 0) {
+            if (cf[i].purger)
+                lab_purger_start(cf[i].a, cf[i].o);
+            else
+                lab_decay_set(cf[i].o.decay_ms, cf[i].o.advice);
+            r = small ? small_workload(cf[i].a, cycles) : workload(cf[i].a, cycles);
+            lab_purger_stop();
+            if (write(fd[1], &r, sizeof r) != sizeof r)
+                _exit(1);
+            _exit(0);
+        }
+        close(fd[1]);
+        if (read(fd[0], &r, sizeof r) != sizeof r)
+            return 1;
+        close(fd[0]);
+        waitpid(pid, NULL, 0);
+        printf("%-28s %8.0f", cf[i].name, r.ns_op);
+        if (small)
+            printf(" %8s", "-");
+        else
+            printf(" %8.0f", r.p99_us);
+        printf(" %8.1f %8.1fM %8.1fM %8.1fM", r.faults, r.mean_mb, r.idle_mb, r.peak_mb);
+        if (small || cf[i].a == &lab_glibc)
+            printf(" %6s\n", "-");             /* no large-block cache */
+        else
+            printf(" %5.0f%%\n", r.hit);
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int cycles = argc > 1 ? atoi(argv[1]) : 6;
+
+    pid_t pid = fork();                  /* self-test: keep its parked blocks out */
+    if (pid == 0) {
+        self_test();
+        _exit(0);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        return 1;
+    puts("self-test: ok");
+
+    const config cf[] = {
+        { "glibc",                      &lab_glibc, { -1, 0, MADV_DONTNEED }, 0 },
+        { "glibc  malloc_trim / 10 ms", &lab_glibc, { 10, 10, MADV_DONTNEED }, 1 },
+        { "arena  decay 0 (at free)",   &lab_arena, { 0, 0, MADV_DONTNEED }, 0 },
+        { "arena  decay 10 ms",         &lab_arena, { 10, 10, MADV_DONTNEED }, 1 },
+        { "arena  decay 100 ms",        &lab_arena, { 100, 10, MADV_DONTNEED }, 1 },
+        { "arena  decay 1 s",           &lab_arena, { 1000, 10, MADV_DONTNEED }, 1 },
+        { "arena  never",               &lab_arena, { -1, 0, MADV_DONTNEED }, 0 },
+        { "arena  decay 100 ms, FREE",  &lab_arena, { 100, 10, MADV_FREE }, 1 },
+    };
+    printf("\n%d bursts of %d large mallocs, %d ms idle after each\n", cycles, BURST, IDLE_MS);
+    if (run_table(cf, sizeof cf / sizeof cf[0], 0, cycles) != 0)
+        return 1;
+
+    /* arena never gives slabs back: its row is the baseline */
+    const config small[] = {
+        { "glibc",                      &lab_glibc,   { -1, 0, MADV_DONTNEED }, 0 },
+        { "glibc  malloc_trim / 10 ms", &lab_glibc,   { 10, 10, MADV_DONTNEED }, 1 },
+        { "arena  (slabs kept)",        &lab_arena,   { 10, 10, MADV_DONTNEED }, 1 },
+        { "pagemap decay 0 (at free)",  &lab_pagemap, { 0, 0, MADV_DONTNEED }, 0 },
+        { "pagemap decay 10 ms",        &lab_pagemap, { 10, 10, MADV_DONTNEED }, 1 },
+        { "pagemap decay 100 ms",       &lab_pagemap, { 100, 10, MADV_DONTNEED }, 1 },
+        { "pagemap never",              &lab_pagemap, { -1, 0, MADV_DONTNEED }, 0 },
+    };
+    printf("\n%d bursts of %d small mallocs (16 - 512 B), all freed, %d ms idle after each\n",
+           cycles, SMALL_BURST, IDLE_MS);
+    if (run_table(small, sizeof small / sizeof small[0], 1, cycles) != 0)
+        return 1;
+    return 0;
+}
@@ -0,0 +1,353 @@
+/*
+ * shm_arena.c — cross-process shared-memory arena with offset pointers.
+ *
+ * One anonymous shared file (memfd_create on Linux, shm_open elsewhere) is
+ * mapped by a producer and a consumer process. Nothing inside the arena
+ * stores a raw address: blocks, free lists and the handoff ring all use
+ * offsets from the arena base, so each process may map it anywhere.
+ *
+ * The allocator is lock-free (per-size-class Treiber stacks with an ABA tag
+ * plus an atomic bump pointer), which lets the *consumer* free blocks the
+ * producer allocated without any lock shared between processes.
+ *
+ *   ./shm_arena            # benchmark 4 KB .. 64 MB payloads
+ *   ./shm_arena 1024       # ... up to 1024 MB (needs ~2x that in RAM)
+ */
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SA_MIN_SHIFT  6u          /* smallest class: 64 bytes */
+#define SA_CLASSES    32u
+#define SA_RING       64u         /* handles in flight */
+#define SA_HDR_ALIGN  64u
+
+typedef uint64_t sa_off;          /* offset from arena base, 0 == NULL */
+
+typedef struct {
+    uint64_t cls;                 /* size class of this block */
+    sa_off   next;                /* free-list link while free */
+    uint64_t pad[6];              /* keep payload cache-line aligned */
+} sa_block;
+
+typedef struct {
+    sa_off   off;                 /* payload offset */
+    uint64_t len;
+} sa_handle;
+
+typedef struct {
+    uint64_t size;
+    _Atomic uint64_t top;                     /* bump pointer */
+    /* free-list heads: low 40 bits = offset >> 6, high 24 bits = ABA tag */
+    _Atomic uint64_t free_head[SA_CLASSES];
+    char pad0[64];
+    _Atomic uint64_t ring_head;               /* consumer position */
+    char pad1[56];
+    _Atomic uint64_t ring_tail;               /* producer position */
+    char pad2[56];
+    sa_handle ring[SA_RING];
+} sa_arena;
+
+static inline void *sa_ptr(sa_arena *a, sa_off off) {
+    return off ? (char *)a + off : NULL;
+}
+
+static inline sa_off sa_offset(sa_arena *a, const void *p) {
+    return p ? (sa_off)((uintptr_t)p - (uintptr_t)a) : 0;
+}
+
+/* ---------- tagged head helpers ---------- */
+
+#define SA_OFF_BITS 40u
+#define SA_OFF_MASK ((1ULL << SA_OFF_BITS) - 1)
+
+static inline sa_off head_off(uint64_t h) { return (h & SA_OFF_MASK) << 6; }
+static inline uint64_t head_make(sa_off off, uint64_t old) {
+    uint64_t tag = (old >> SA_OFF_BITS) + 1;
+    return (tag << SA_OFF_BITS) | (off >> 6);
+}
+
+/* ---------- lock-free allocator ---------- */
+
+static unsigned sa_class(uint64_t n) {
+    unsigned c = 0;
+    while ((1ULL << (c + SA_MIN_SHIFT)) < n)
+        c++;
+    return c;
+}
+
+static void *sa_alloc(sa_arena *a, uint64_t n) {
+    unsigned c = sa_class(n);
+    if (c >= SA_CLASSES)
+        return NULL;
+
+    uint64_t h = atomic_load_explicit(&a->free_head[c], memory_order_acquire);
+    while (head_off(h)) {
+        sa_block *b = sa_ptr(a, head_off(h));
+        uint64_t nh = head_make(b->next, h);
+        if (atomic_compare_exchange_weak_explicit(&a->free_head[c], &h, nh,
+                memory_order_acq_rel, memory_order_acquire))
+            return b + 1;
+    }
+
+    uint64_t need = sizeof(sa_block) + (1ULL << (c + SA_MIN_SHIFT));
+    uint64_t at = atomic_fetch_add_explicit(&a->top, need, memory_order_relaxed);
+    if (at + need > a->size) {
+        atomic_fetch_sub_explicit(&a->top, need, memory_order_relaxed);
+        return NULL;              /* full: caller waits for frees */
+    }
+    sa_block *b = sa_ptr(a, at);
+    b->cls = c;
+    return b + 1;
+}
+
+static void sa_free(sa_arena *a, void *p) {
+    if (!p)
+        return;
+    sa_block *b = (sa_block *)p - 1;
+    _Atomic uint64_t *head = &a->free_head[b->cls];
+    uint64_t h = atomic_load_explicit(head, memory_order_relaxed);
+    do {
+        b->next = head_off(h);
+    } while (!atomic_compare_exchange_weak_explicit(head, &h,
+                head_make(sa_offset(a, b), h),
+                memory_order_release, memory_order_relaxed));
+}
+
+/* ---------- SPSC handle ring (zero-copy exchange) ---------- */
+
+static void sa_send(sa_arena *a, sa_handle hd) {
+    uint64_t t = atomic_load_explicit(&a->ring_tail, memory_order_relaxed);
+    while (t - atomic_load_explicit(&a->ring_head, memory_order_acquire) == SA_RING)
+        sched_yield();             /* ring full */
+    a->ring[t % SA_RING] = hd;
+    atomic_store_explicit(&a->ring_tail, t + 1, memory_order_release);
+}
+
+static sa_handle sa_recv(sa_arena *a) {
+    uint64_t h = atomic_load_explicit(&a->ring_head, memory_order_relaxed);
+    while (atomic_load_explicit(&a->ring_tail, memory_order_acquire) == h)
+        sched_yield();             /* ring empty */
+    sa_handle hd = a->ring[h % SA_RING];
+    atomic_store_explicit(&a->ring_head, h + 1, memory_order_release);
+    return hd;
+}
+
+/* ---------- arena creation / mapping ---------- */
+
+static int sa_create_fd(uint64_t size) {
+    int fd;
+#ifdef __linux__
+    fd = memfd_create("shm_arena", 0);
+#else
+    char name[64];
+    snprintf(name, sizeof name, "/shm_arena.%d", (int)getpid());
+    fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd >= 0)
+        shm_unlink(name);          /* fd stays valid, name is gone */
+#endif
+    if (fd >= 0 && ftruncate(fd, (off_t)size) != 0) {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+static sa_arena *sa_map(int fd, uint64_t size) {
+    void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    return p == MAP_FAILED ? NULL : p;
+}
+
+static void sa_init(sa_arena *a, uint64_t size) {
+    memset(a, 0, sizeof *a);
+    a->size = size;
+    uint64_t top = (sizeof *a + SA_HDR_ALIGN - 1) & ~(uint64_t)(SA_HDR_ALIGN - 1);
+    atomic_store(&a->top, top);
+}
+
+/* ---------- benchmark ---------- */
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Same "work" on both sides for every transport: producer fills the
+ * payload, consumer reads one byte per cache line. */
+static uint64_t consume(const unsigned char *p, uint64_t len) {
+    uint64_t s = 0;
+    for (uint64_t i = 0; i < len; i += 64)
+        s += p[i];
+    return s;
+}
+
+/* seconds, or -1 if the arena could not be mapped or fork failed */
+static double bench_shm(int fd, uint64_t arena_size, uint64_t len, long count) {
+    sa_arena *a = sa_map(fd, arena_size);
+    if (a == NULL) {
+        perror("mmap arena");
+        return -1;
+    }
+    sa_init(a, arena_size);
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        munmap(a, arena_size);
+        return -1;
+    }
+    if (pid == 0) {
+        /* consumer maps the arena again: a different address than parent's */
+        sa_arena *c = sa_map(fd, arena_size);
+        if (c == NULL) {
+            perror("consumer: mmap arena");
+            _exit(2);
+        }
+        uint64_t sum = 0;
+        for (long i = 0; i < count; i++) {
+            sa_handle hd = sa_recv(c);
+            sum += consume(sa_ptr(c, hd.off), hd.len);
+            sa_free(c, sa_ptr(c, hd.off));
+        }
+        _exit(sum == (uint64_t)count * ((len + 63) / 64) ? 0 : 1);
+    }
+
+    double t0 = now_sec();
+    for (long i = 0; i < count; i++) {
+        void *p;
+        while ((p = sa_alloc(a, len)) == NULL)
+            sched_yield();         /* arena full: wait for consumer frees */
+        memset(p, 1, len);
+        sa_send(a, (sa_handle){ sa_offset(a, p), len });
+    }
+    int st;
+    waitpid(pid, &st, 0);
+    double dt = now_sec() - t0;
+    munmap(a, arena_size);
+    if (!WIFEXITED(st) || WEXITSTATUS(st) == 1)
+        fprintf(stderr, "shm consumer saw corrupted data\n");
+    return dt;
+}
+
+static int read_full(int fd, unsigned char *buf, uint64_t len) {
+    while (len) {
+        ssize_t r = read(fd, buf, len);
+        if (r <= 0)
+            return -1;
+        buf += r;
+        len -= (uint64_t)r;
+    }
+    return 0;
+}
+
+static int write_full(int fd, const unsigned char *buf, uint64_t len) {
+    while (len) {
+        ssize_t r = write(fd, buf, len);
+        if (r <= 0)
+            return -1;
+        buf += r;
+        len -= (uint64_t)r;
+    }
+    return 0;
+}
+
+/* pipes and sockets: the payload is copied user -> kernel -> user */
+/* seconds, or -1 on any failure, including a consumer that read short
+ * or summed wrong (it reports through its exit status) */
+static double bench_stream(int use_socket, uint64_t len, long count) {
+    const char *name = use_socket ? "socket" : "pipe";
+    int fds[2];
+    if (use_socket ? socketpair(AF_UNIX, SOCK_STREAM, 0, fds) : pipe(fds)) {
+        perror(name);
+        return -1;
+    }
+    unsigned char *buf = malloc(len);
+    pid_t pid = buf == NULL ? -1 : fork();
+    if (pid < 0) {
+        perror(buf == NULL ? "malloc" : "fork");
+        free(buf);
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        close(fds[1]);
+        uint64_t sum = 0;
+        for (long i = 0; i < count; i++) {
+            if (read_full(fds[0], buf, len) != 0)
+                _exit(2);
+            sum += consume(buf, len);
+        }
+        _exit(sum == (uint64_t)count * ((len + 63) / 64) ? 0 : 1);
+    }
+    close(fds[0]);
+
+    int err = 0;
+    double t0 = now_sec();
+    for (long i = 0; i < count && !err; i++) {
+        memset(buf, 1, len);
+        err = write_full(fds[1], buf, len);
+    }
+    close(fds[1]);              /* on error the consumer sees EOF and exits 2 */
+    int st;
+    if (waitpid(pid, &st, 0) != pid)
+        st = -1;
+    double dt = now_sec() - t0;
+    free(buf);
+    if (err)
+        fprintf(stderr, "%s: write failed\n", name);
+    if (!WIFEXITED(st) || WEXITSTATUS(st) != 0)
+        fprintf(stderr, "%s consumer %s\n", name,
+                WIFEXITED(st) && WEXITSTATUS(st) == 1 ? "saw corrupted data" : "failed");
+    return err || !WIFEXITED(st) || WEXITSTATUS(st) != 0 ? -1 : dt;
+}
+
+int main(int argc, char **argv) {
+    uint64_t max_mb = argc > 1 ? strtoull(argv[1], NULL, 10) : 64;
+    uint64_t max_len = max_mb << 20;
+    uint64_t arena_size = 2 * max_len + (8u << 20);
+
+    signal(SIGPIPE, SIG_IGN);   /* a dead consumer: write fails, no signal */
+    int fd = sa_create_fd(arena_size);
+    if (fd < 0) {
+        perror("shared memory");
+        return 1;
+    }
+
+    printf("%10s %8s %12s %12s %12s\n", "payload", "msgs", "shm GB/s",
+           "pipe GB/s", "socket GB/s");
+    for (uint64_t len = 4096; len <= max_len; len *= 4) {
+        /* ~1 GB of traffic per size, at least 8 messages */
+        long count = (long)((1ULL << 30) / len);
+        if (count < 8)
+            count = 8;
+        double gb = (double)len * count / 1e9;
+        double ts = bench_shm(fd, arena_size, len, count);
+        if (ts < 0) {
+            close(fd);
+            return 1;
+        }
+        double tp = bench_stream(0, len, count);
+        double tk = tp < 0 ? -1 : bench_stream(1, len, count);
+        if (tk < 0) {
+            close(fd);
+            return 1;
+        }
+        printf("%8lluKB %8ld %12.2f %12.2f %12.2f\n",
+               (unsigned long long)(len >> 10), count, gb / ts, gb / tp, gb / tk);
+    }
+    close(fd);
+    return 0;
+}
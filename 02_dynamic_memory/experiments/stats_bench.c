@@ -0,0 +1,272 @@
+/*
+ * stats_bench.c — what publishing heap statistics costs the allocating
+ * thread, and a workload for lab_stat to watch.
+ *
+ *   gcc -O2 -pthread stats_bench.c -o stats_bench
+ *   gcc -O2 -pthread -DHDR_ENABLE stats_bench.c -o stats_bench_hdr   (time every call)
+ *   gcc -O2 lab_stat.c -o lab_stat
+ *   ./stats_bench                      self-test + cost table
+ *   ./stats_bench --serve 10 &         publish a phased workload for 10 s
+ *   ./lab_stat -w 500 $!               ... and watch it from outside
+ *
+ * Cost: malloc + free of 64 bytes, 64 live, timed with the thread's CPU
+ * clock so a reader process sharing the CPU is not billed to the
+ * allocator. The first row is a process that never had a second thread;
+ * every other row runs after one existed, because that alone switches
+ * glibc to its threaded paths. Then the rows add one thing at a time: the
+ * sampling wrapper with the publisher thread, a reader polling every
+ * millisecond, a reader spinning.
+ */
+#define _GNU_SOURCE
+#include "lab_stats.h"
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+static double cpu_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void sleep_ms(int ms) {
+    struct timespec ts = { ms / 1000, (long)(ms % 1000) * 1000000 };
+    while (nanosleep(&ts, &ts) != 0)
+        ;
+}
+
+static void expect(int ok, const char *what) {
+    if (!ok) {
+        fprintf(stderr, "self-test: %s\n", what);
+        exit(1);
+    }
+}
+
+static uint64_t live_in(const lab_counts *k, unsigned c) {
+    return k->mallocs[c] - k->frees[c];
+}
+
+/* ---------- self-test ---------- */
+
+static void test_counts(const lab_allocator *a) {
+    enum { N = 1000 };
+    static void *v[N];
+    unsigned c = arena_class(100);
+    lab_counts k0 = a->counts();
+
+    for (int i = 0; i < N; i++)
+        v[i] = a->malloc(100);
+    void *big = a->malloc(1 << 20);
+    lab_counts k = a->counts();
+    expect(live_in(&k, c) == live_in(&k0, c) + N, "class count after malloc");
+    expect(live_in(&k, LAB_CLASSES) == live_in(&k0, LAB_CLASSES) + 1
+           && k.large_bytes >= k0.large_bytes + (1 << 20), "large count");
+    expect(k.chunks > 0, "chunks");
+    lab_free_batch(a, v, N);
+    a->free(big);
+    lab_malloc_batch(a, 100, N, v);
+    for (int i = 0; i < N; i += 2)
+        lab_free_sized(a, v[i], 100);
+    for (int i = 1; i < N; i += 2)
+        a->free(v[i]);
+    k = a->counts();
+    expect(live_in(&k, c) == live_in(&k0, c) && k.large_bytes == k0.large_bytes,
+           "every free path counts");
+}
+
+/* child: attach to the parent and check every read is consistent */
+static int reader_check(pid_t parent, int ms) {
+    const lab_stats_page *pg = lab_stats_attach(parent);
+    if (pg == NULL)
+        return 1;
+    static lab_stats_data d;
+    uint64_t last = 0;
+    unsigned retries = 0;
+    double end = cpu_sec() + ms * 1e-3;
+    for (long n = 0; cpu_sec() < end; n++) {
+        if (lab_stats_read(pg, &d, &retries) != 0)
+            return 2;
+        for (int op = 0; op < 2; op++) {
+            uint64_t sum = 0;
+            for (unsigned b = 0; b < HDR_BUCKETS; b++)
+                sum += d.lat[op].count[b];
+            if (sum != d.lat[op].n)
+                return 3;                              /* torn copy */
+        }
+        if (d.publishes < last)
+            return 4;
+        last = d.publishes;
+    }
+    lab_stats_detach(pg);
+    return last > 10 ? 0 : 5;
+}
+
+static void test_publish(void) {
+    const lab_allocator *a = lab_stats_start(&lab_arena, 1);
+    expect(a != NULL, "lab_stats_start");
+    expect(strcmp(a->name, "arena") == 0 && a->counts == lab_arena.counts, "wrapper");
+    pid_t self = getpid();
+    fflush(NULL);
+    pid_t pid = fork();
+    if (pid == 0)
+        _exit(reader_check(self, 300));
+    void *v[64] = { 0 };
+    int status;
+    for (long i = 0; waitpid(pid, &status, WNOHANG) == 0; i++) {
+        a->free(v[i & 63]);
+        v[i & 63] = a->malloc(16 + (size_t)(i % 5000));
+    }
+    expect(WIFEXITED(status) && WEXITSTATUS(status) == 0, "reader saw a torn or stale page");
+    for (int i = 0; i < 64; i++)
+        a->free(v[i]);
+    lab_stats_stop();
+    expect(lab_stats_attach(self) == NULL && errno == ENOENT, "stop unlinks the page");
+    static hdr_counts h;
+    hdr_merge(&lab_lat_g[LAB_LAT_MALLOC], &h);
+    expect(h.n > 0 && h.max > 0, "the wrapper samples latency");
+}
+
+static void self_test(void) {
+    test_counts(&lab_arena);
+    test_counts(&lab_pagemap);
+    test_publish();
+}
+
+/* ---------- cost ---------- */
+
+static double roundtrip_ns(const lab_allocator *a, long ops) {
+    void *v[64] = { 0 };
+    double best = 1e30;
+    for (int r = 0; r < 5; r++) {
+        double t = cpu_sec();
+        for (long i = 0; i < ops; i++) {
+            a->free(v[i & 63]);
+            v[i & 63] = a->malloc(64);
+        }
+        double ns = (cpu_sec() - t) / (double)ops * 1e9;
+        best = ns < best ? ns : best;
+    }
+    for (int i = 0; i < 64; i++)
+        a->free(v[i]);
+    return best;
+}
+
+/* a scraper: attach and read every poll_ms (0: as fast as it can) */
+static pid_t spawn_reader(pid_t target, int poll_ms) {
+    fflush(NULL);
+    pid_t pid = fork();
+    if (pid != 0)
+        return pid;
+    const lab_stats_page *pg = lab_stats_attach(target);
+    static lab_stats_data d;
+    for (;;) {
+        if (pg != NULL)
+            lab_stats_read(pg, &d, NULL);
+        if (poll_ms > 0)
+            sleep_ms(poll_ms);
+    }
+}
+
+static void *idle(void *arg) {
+    return arg;
+}
+
+static void cost(const lab_allocator *base, long ops) {
+    printf("%-8s %-38s", base->name, "plain, never had a 2nd thread");
+    printf(" %8.2f\n", roundtrip_ns(base, ops));
+    pthread_t th;                       /* from now on glibc's locks and */
+    pthread_create(&th, NULL, idle, NULL);   /* malloc take their threaded */
+    pthread_join(th, NULL);                  /* paths for good */
+    printf("%-8s %-38s %8.2f\n", "", "plain, after one thread came and went",
+           roundtrip_ns(base, ops));
+    const lab_allocator *a = lab_stats_start(base, 1);
+    if (a == NULL) {
+        perror("lab_stats_start");
+        exit(1);
+    }
+    printf("%-8s %-38s %8.2f\n", "",
+           LAB_STATS_SAMPLE == 1 ? "+ every call timed, publisher 1 ms"
+                                 : "+ sampler, publisher every 1 ms",
+           roundtrip_ns(a, ops));
+    pid_t r = spawn_reader(getpid(), 1);
+    printf("%-8s %-38s %8.2f\n", "", "+ reader polling every 1 ms", roundtrip_ns(a, ops));
+    kill(r, SIGKILL);
+    waitpid(r, NULL, 0);
+    r = spawn_reader(getpid(), 0);
+    printf("%-8s %-38s %8.2f\n", "", "+ reader spinning instead", roundtrip_ns(a, ops));
+    kill(r, SIGKILL);
+    waitpid(r, NULL, 0);
+    lab_stats_stop();
+}
+
+/* ---------- --serve: something for lab_stat to watch ---------- */
+
+static void serve(int seconds) {
+    const lab_allocator *a = lab_stats_start(&lab_arena, 100);
+    if (a == NULL) {
+        perror("lab_stats_start");
+        exit(1);
+    }
+    lab_purger_start(&lab_arena, (lab_purge_opts){ 200, 50, MADV_DONTNEED });
+    printf("pid %d publishing; try: ./lab_stat -w 500 %d\n", (int)getpid(), (int)getpid());
+    fflush(stdout);
+    enum { LIVE = 50000 };
+    static void *v[LIVE];
+    uint64_t x = 1;
+    double end = lab_now_ns() * 1e-9 + seconds;
+    for (int phase = 0; lab_now_ns() * 1e-9 < end; phase = (phase + 1) % 3) {
+        double until = lab_now_ns() * 1e-9 + 1.0;
+        while (lab_now_ns() * 1e-9 < until) {
+            x = x * 6364136223846793005u + 1442695040888963407u;
+            size_t i = (x >> 33) % LIVE;
+            a->free(v[i]);
+            v[i] = NULL;
+            if (phase == 0)                            /* small churn */
+                v[i] = a->malloc(8 + (x >> 50) % 300);
+            else if (phase == 1 && i % 1000 == 0)      /* large buffers */
+                v[i] = a->malloc((128u << 10) + (x >> 40) % (4u << 20));
+            else if (phase == 2)                       /* idle: let it decay */
+                sleep_ms(1);
+            if (v[i] != NULL)
+                memset(v[i], 1, 8);
+        }
+    }
+    lab_purger_stop();
+    lab_stats_stop();
+}
+
+int main(int argc, char **argv) {
+    if (argc > 2 && strcmp(argv[1], "--serve") == 0) {
+        serve(atoi(argv[2]));
+        return 0;
+    }
+    fflush(NULL);
+    pid_t pid = fork();
+    if (pid == 0) {
+        self_test();
+        _exit(0);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        return 1;
+    puts("self-test: ok");
+
+    printf("\nmalloc + free of 64 bytes, ns of the allocating thread's CPU, best of 5\n");
+    const lab_allocator *const list[] = { &lab_arena, &lab_pagemap, &lab_glibc };
+    for (int i = 0; i < 3; i++) {
+        fflush(NULL);
+        if ((pid = fork()) == 0) {                     /* own stats page each */
+            cost(list[i], 5000000);
+            fflush(NULL);
+            _exit(0);
+        }
+        waitpid(pid, NULL, 0);
+    }
+    return 0;
+}
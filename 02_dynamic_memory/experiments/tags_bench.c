@@ -0,0 +1,365 @@
+/*
+ * tags_bench.c — what a tag costs, and who owns the heap when the workflow
+ * engine, arrays and string tables share one allocator.
+ *
+ *   gcc -O2 -pthread tags_bench.c -o tags_bench
+ *   ./tags_bench [allocator]           default arena
+ *
+ * 1. cost: the counter alone (thread-local add vs one shared atomic), then
+ *    malloc + free of 32 bytes untagged vs tagged, for every allocator
+ * 2. dashboard: three threads, one per subsystem, on one allocator, with a
+ *    soft budget on strings and a hard one on arrays. The main thread takes
+ *    snapshots while they run; the table is the snapshot after they exit,
+ *    then after the main thread has freed everything they left.
+ */
+#define _GNU_SOURCE
+#include "lab_tags.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MB (1 << 20)
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void expect(int ok, const char *what) {
+    if (!ok) {
+        fprintf(stderr, "self-test: %s\n", what);
+        exit(1);
+    }
+}
+
+static int64_t tag_bytes(int tag) {
+    lab_tag_stat st[LAB_TAGS];
+    lab_tag_snapshot(st);
+    return st[tag].bytes;
+}
+
+/* ---------- self-test ---------- */
+
+typedef struct {
+    int     soft, hard;
+    int64_t at;                      /* bytes reported with the last call */
+} calls;
+
+static void count_calls(int tag, int level, int64_t bytes, void *arg) {
+    calls *c = arg;
+    (void)tag;
+    if (level == LAB_BUDGET_SOFT)
+        c->soft++;
+    else
+        c->hard++;
+    c->at = bytes;
+}
+
+enum { ST_THREADS = 4, ST_BLOCKS = 20000 };
+
+static void *st_worker(void *arg) {
+    void **v = arg;
+    for (size_t i = 0; i < ST_BLOCKS; i++) {
+        size_t n = 8 + i % 300;
+        v[i] = lab_malloc_tagged(&lab_arena, (int)(i % TAG_USER), n);
+        memset(v[i], 1, n);
+    }
+    for (size_t i = 0; i < ST_BLOCKS; i += 2) {      /* half freed here */
+        lab_free_tagged(&lab_arena, (int)(i % TAG_USER), v[i], 8 + i % 300);
+        v[i] = NULL;
+    }
+    return NULL;
+}
+
+static void self_test(void) {
+    const lab_allocator *a = &lab_arena;
+    static void *v[ST_THREADS][ST_BLOCKS];
+    pthread_t th[ST_THREADS];
+
+    /* per-thread counters fold into the right totals, after exit too */
+    for (int i = 0; i < ST_THREADS; i++)
+        pthread_create(&th[i], NULL, st_worker, v[i]);
+    for (int i = 0; i < ST_THREADS; i++)
+        pthread_join(th[i], NULL);
+    int64_t want[TAG_USER] = { 0 };
+    for (size_t i = 1; i < ST_BLOCKS; i += 2)
+        want[i % TAG_USER] += ST_THREADS * (int64_t)(8 + i % 300);
+    for (int tag = 0; tag < TAG_USER; tag++)
+        expect(tag_bytes(tag) == want[tag], "exited threads are folded in");
+    for (int i = 0; i < ST_THREADS; i++)             /* freed on another thread */
+        for (size_t k = 1; k < ST_BLOCKS; k += 2)
+            lab_free_tagged(a, (int)(k % TAG_USER), v[i][k], 8 + k % 300);
+    for (int tag = 0; tag < TAG_USER; tag++)
+        expect(tag_bytes(tag) == 0, "cross-thread frees");
+
+    /* realloc charges the difference */
+    char *s = lab_malloc_tagged(a, TAG_STRINGS, 100);
+    s = lab_realloc_tagged(a, TAG_STRINGS, s, 100, 5000);
+    expect(tag_bytes(TAG_STRINGS) == 5000, "realloc up");
+    s = lab_realloc_tagged(a, TAG_STRINGS, s, 5000, 10);
+    expect(tag_bytes(TAG_STRINGS) == 10, "realloc down");
+    lab_free_tagged(a, TAG_STRINGS, s, 10);
+
+    /* soft fires once on the way up; hard refuses, single thread: exactly */
+    calls c = { 0 };
+    static void *row[4096];
+    int n = 0;
+    lab_tag_config(TAG_ARRAYS, NULL, 1 * MB, 2 * MB, count_calls, &c);
+    while ((row[n] = lab_malloc_tagged(a, TAG_ARRAYS, 3000)) != NULL)
+        n++;
+    expect(c.soft == 1 && c.hard == 1, "one soft call, one refusal");
+    expect(tag_bytes(TAG_ARRAYS) == n * 3000 && n * 3000 <= 2 * MB
+           && n * 3000 > 2 * MB - 3000, "hard budget is exact on one thread");
+    expect(lab_malloc_tagged(a, TAG_ARRAYS, 3000) == NULL && c.hard == 2, "still refused");
+    lab_free_tagged(a, TAG_ARRAYS, row[--n], 3000);
+    row[n] = lab_malloc_tagged(a, TAG_ARRAYS, 3000);
+    expect(row[n++] != NULL, "room again after a free");
+    for (int i = 0; i < n; i++)
+        lab_free_tagged(a, TAG_ARRAYS, row[i], 3000);
+    lab_tag_stat st[LAB_TAGS];
+    lab_tag_snapshot(st);
+    expect(st[TAG_ARRAYS].bytes == 0 && st[TAG_ARRAYS].soft_events == 1
+           && st[TAG_ARRAYS].denied == 2, "snapshot counters");
+    expect(strcmp(st[TAG_WORKFLOW].name, "workflow") == 0, "names");
+}
+
+/* ---------- 1. cost ---------- */
+
+static _Atomic int64_t shared_bytes;
+
+static double counter_ns(int atomic_rmw, long ops) {
+    double t = now_sec();
+    for (long i = 0; i < ops; i++) {
+        int64_t n = 32 + (i & 7);
+        if (atomic_rmw) {
+            atomic_fetch_add_explicit(&shared_bytes, n, memory_order_relaxed);
+            atomic_fetch_sub_explicit(&shared_bytes, n, memory_order_relaxed);
+        } else {
+            lab_tag_charge(TAG_OTHER, n);
+            lab_tag_credit(TAG_OTHER, n);
+        }
+    }
+    return (now_sec() - t) / (double)ops * 1e9;
+}
+
+static double roundtrip_ns(const lab_allocator *a, int tagged, long ops) {
+    enum { LIVE = 64 };
+    void *v[LIVE] = { 0 };
+    double t = now_sec();
+    for (long i = 0; i < ops; i++) {
+        void **slot = &v[i % LIVE];
+        if (tagged) {
+            lab_free_tagged(a, TAG_OTHER, *slot, 32);
+            *slot = lab_malloc_tagged(a, TAG_OTHER, 32);
+        } else {
+            lab_free_sized(a, *slot, 32);
+            *slot = a->malloc(32);
+        }
+    }
+    double ns = (now_sec() - t) / (double)ops * 1e9;
+    for (int i = 0; i < LIVE; i++)
+        if (tagged)
+            lab_free_tagged(a, TAG_OTHER, v[i], 32);
+        else
+            lab_free_sized(a, v[i], 32);
+    return ns;
+}
+
+static double best_of(double (*f)(const lab_allocator *, int, long),
+                      const lab_allocator *a, int tagged, long ops) {
+    double best = 1e30;
+    for (int r = 0; r < 5; r++) {
+        double ns = f(a, tagged, ops);
+        best = ns < best ? ns : best;
+    }
+    return best;
+}
+
+static double counter_run(const lab_allocator *a, int atomic_rmw, long ops) {
+    (void)a;
+    return counter_ns(atomic_rmw, ops);
+}
+
+/* ---------- 2. dashboard ---------- */
+
+static const lab_allocator *dash;
+
+static void on_budget(int tag, int level, int64_t bytes, void *arg) {
+    atomic_int *once = arg;
+    if (atomic_fetch_add(&once[level], 1) == 0)       /* first call per level */
+        printf("  budget: %s %s at %.1f MB%s\n", lab_tags_g.name[tag],
+               level == LAB_BUDGET_SOFT ? "soft" : "hard", (double)bytes / MB,
+               level == LAB_BUDGET_SOFT ? ": asking the string table to shrink"
+                                        : ": allocation refused");
+}
+
+typedef struct {
+    void  **v;
+    size_t *len;
+    size_t  n, cap;
+} keep;
+
+static void keep_add(keep *k, void *p, size_t n) {
+    k->v[k->n] = p;
+    k->len[k->n++] = n;
+}
+
+/* workflow engine: contexts of 256 B - 4 KB, 2048 in flight, mostly churn */
+static void *workflow(void *arg) {
+    keep *k = arg;
+    uint64_t x = 1;
+    for (size_t i = 0; i < 400000; i++) {
+        x = x * 6364136223846793005u + 1442695040888963407u;
+        size_t slot = (x >> 33) % 2048, n = 256 + (x >> 45) % 3841;
+        void *p = lab_malloc_tagged(dash, TAG_WORKFLOW, n);
+        memset(p, 0, 16);
+        if (slot < k->n) {
+            lab_free_tagged(dash, TAG_WORKFLOW, k->v[slot], k->len[slot]);
+            k->v[slot] = p;
+            k->len[slot] = n;
+        } else {
+            keep_add(k, p, n);
+        }
+    }
+    return NULL;
+}
+
+/* arrays: rows of 1 - 64 KB until the hard budget says no */
+static void *arrays(void *arg) {
+    keep *k = arg;
+    uint64_t x = 7;
+    while (k->n < k->cap) {
+        x = x * 6364136223846793005u + 1442695040888963407u;
+        size_t n = 1024 + (x >> 33) % (63 << 10);
+        void *p = lab_malloc_tagged(dash, TAG_ARRAYS, n);
+        if (p == NULL)
+            break;
+        memset(p, 0, n);
+        keep_add(k, p, n);
+    }
+    return NULL;
+}
+
+/* string table: 300k strings of 8 - 100 bytes, a third replaced */
+static void *strings(void *arg) {
+    keep *k = arg;
+    for (size_t i = 0; i < 400000; i++) {
+        size_t n = 8 + (i * 2654435761u >> 9) % 93;
+        if (i % 4 == 3) {
+            size_t j = (i * 40503u) % k->n;
+            lab_free_tagged(dash, TAG_STRINGS, k->v[j], k->len[j]);
+            k->v[j] = lab_malloc_tagged(dash, TAG_STRINGS, n);
+            k->len[j] = n;
+            memset(k->v[j], 'x', n);
+        } else {
+            char *s = lab_malloc_tagged(dash, TAG_STRINGS, n);
+            memset(s, 'x', n);
+            keep_add(k, s, n);
+        }
+    }
+    return NULL;
+}
+
+static void print_table(const char *title) {
+    lab_tag_stat st[LAB_TAGS];
+    lab_tag_snapshot(st);
+    int64_t sum = 0;
+    printf("%s\n%-10s %9s %8s %8s %6s %7s\n", title, "tag", "live MB", "soft", "hard",
+           "soft!", "denied");
+    for (int tag = 0; tag < TAG_USER; tag++) {
+        sum += st[tag].bytes;
+        printf("%-10s %9.2f %8.0f %8.0f %6llu %7llu\n", st[tag].name,
+               (double)st[tag].bytes / MB, (double)st[tag].soft / MB,
+               (double)st[tag].hard / MB, (unsigned long long)st[tag].soft_events,
+               (unsigned long long)st[tag].denied);
+    }
+    size_t fp = dash->footprint();
+    printf("%-10s %9.2f\n%-10s %9.2f   (%s footprint - tagged)\n\n", "tagged",
+           (double)sum / MB, "not tagged", ((double)fp - (double)sum) / MB, dash->name);
+}
+
+static void dashboard(const lab_allocator *a) {
+    enum { CAP = 400000 };
+    static atomic_int once[2][2];
+    static keep k[3];
+    void *(*fn[3])(void *) = { workflow, arrays, strings };
+    pthread_t th[3];
+
+    dash = a;
+    lab_tag_config(TAG_STRINGS, NULL, 12 * MB, 0, on_budget, once[0]);
+    lab_tag_config(TAG_ARRAYS, NULL, 0, 32 * MB, on_budget, once[1]);
+    for (int i = 0; i < 3; i++) {
+        k[i].cap = CAP;
+        k[i].v = calloc(CAP, sizeof *k[i].v);
+        k[i].len = calloc(CAP, sizeof *k[i].len);
+        pthread_create(&th[i], NULL, fn[i], &k[i]);
+    }
+
+    /* a dashboard polling while the subsystems run */
+    int snaps = 0;
+    double spent = 0;
+    lab_tag_stat st[LAB_TAGS];
+    for (int i = 0; i < 3; i++) {
+        while (pthread_tryjoin_np(th[i], NULL) != 0) {
+            double t = now_sec();
+            lab_tag_snapshot(st);
+            spent += now_sec() - t;
+            snaps++;
+            struct timespec ms = { 0, 1000000 };
+            nanosleep(&ms, NULL);
+        }
+    }
+    printf("  %d snapshots while running, %.2f us each\n\n", snaps,
+           snaps ? spent / snaps * 1e6 : 0.0);
+    print_table("after the three threads exit:");
+
+    for (int i = 0; i < 3; i++) {
+        static const int tag[3] = { TAG_WORKFLOW, TAG_ARRAYS, TAG_STRINGS };
+        for (size_t j = 0; j < k[i].n; j++)
+            lab_free_tagged(a, tag[i], k[i].v[j], k[i].len[j]);
+        free(k[i].v);
+        free(k[i].len);
+    }
+    print_table("after main frees what they left:");
+}
+
+int main(int argc, char **argv) {
+    const lab_allocator *a = lab_find(argc > 1 ? argv[1] : "arena");
+    if (a == NULL) {
+        fprintf(stderr, "unknown allocator %s\n", argv[1]);
+        return 1;
+    }
+    fflush(NULL);
+    pid_t pid = fork();                  /* self-test: keep its budgets out */
+    if (pid == 0) {
+        self_test();
+        _exit(0);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        return 1;
+    puts("self-test: ok");
+
+    long ops = 20000000;
+    printf("\nns per op, best of 5\n");
+    printf("%-34s %7.2f\n", "counter: thread-local (lab_tags)",
+           best_of(counter_run, NULL, 0, ops));
+    printf("%-34s %7.2f\n", "counter: one shared atomic",
+           best_of(counter_run, NULL, 1, ops));
+    printf("%-34s %9s %9s\n", "malloc + free 32 B", "untagged", "tagged");
+    for (const lab_allocator *const *p = lab_allocators; *p != NULL; p++)
+        printf("  %-32s %9.2f %9.2f\n", (*p)->name, best_of(roundtrip_ns, *p, 0, ops / 4),
+               best_of(roundtrip_ns, *p, 1, ops / 4));
+
+    printf("\n%s: workflow, arrays and strings threads on one heap\n", a->name);
+    dashboard(a);
+    return 0;
+}
@@ -0,0 +1,203 @@
+/*
+ * teardown_bench.c — how long a process takes to die with a big heap,
+ * freeing every object first or not.
+ *
+ *   gcc -O2 -pthread teardown_bench.c -o teardown_bench
+ *   gcc -O2 -pthread -DLAB_LEAK_CHECK teardown_bench.c -o teardown_bench_dbg
+ *   ./teardown_bench [records]         default 3M records = 9M blocks
+ *
+ * Each child builds a hash table of records (node + key + value, spread
+ * over the buckets at random, as a long-running server's heap ends up),
+ * stamps the clock and shuts down:
+ *   free each   walk the table, free every block, exit()
+ *   free_batch  the same walk, 4096 blocks per lab_free_batch()
+ *   teardown    if (!LAB_FAST_TEARDOWN) free each; lab_exit()
+ * The parent stops the clock when waitpid() returns, so the kernel's
+ * unmapping of the address space is included.
+ */
+#define _GNU_SOURCE
+#include "lab_alloc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static uint64_t rng = 88172645463325252ULL;
+static uint64_t rnd(void) {
+    rng ^= rng << 13, rng ^= rng >> 7, rng ^= rng << 17;
+    return rng;
+}
+
+typedef struct rec {
+    struct rec    *next;
+    char          *key;
+    unsigned char *val;
+    size_t         vlen;
+} rec;
+
+typedef struct {
+    rec   **bucket;
+    size_t  nbuckets;
+} table;
+
+static table build(const lab_allocator *a, size_t n) {
+    table t = { NULL, n / 2 + 1 };
+    t.bucket = a->calloc(t.nbuckets, sizeof *t.bucket);
+    for (size_t i = 0; i < n; i++) {
+        rec *r = a->malloc(sizeof *r);
+        size_t klen = 8 + rnd() % 57, b = rnd() % t.nbuckets;
+        r->key = a->malloc(klen);
+        snprintf(r->key, klen, "key-%zu", i);
+        r->vlen = 16 + rnd() % 241;
+        r->val = a->malloc(r->vlen);
+        memset(r->val, (int)i, r->vlen);
+        r->next = t.bucket[b];
+        t.bucket[b] = r;
+    }
+    return t;
+}
+
+/* the cleanup a careful program runs before exit; keep_last leaks that many */
+static void free_each(const lab_allocator *a, table *t, size_t keep_last) {
+    for (size_t b = 0; b + keep_last < t->nbuckets; b++)
+        for (rec *r = t->bucket[b], *next; r != NULL; r = next) {
+            next = r->next;
+            a->free(r->key);
+            a->free(r->val);
+            a->free(r);
+        }
+    if (keep_last == 0)
+        a->free(t->bucket);
+}
+
+static void free_batched(const lab_allocator *a, table *t) {
+    static void *v[4096];
+    size_t n = 0;
+    for (size_t b = 0; b < t->nbuckets; b++)
+        for (rec *r = t->bucket[b]; r != NULL; r = r->next) {
+            if (n + 3 > 4096) {
+                lab_free_batch(a, v, n);
+                n = 0;
+            }
+            v[n++] = r->key;
+            v[n++] = r->val;
+            v[n++] = r;                  /* r->next was read before this batch */
+        }
+    v[n++] = t->bucket;
+    lab_free_batch(a, v, n);
+}
+
+static size_t rss_kb(void) {
+    char line[256];
+    size_t kb = 0;
+    FILE *f = fopen("/proc/self/status", "r");
+    while (f != NULL && fgets(line, sizeof line, f))
+        if (sscanf(line, "VmRSS: %zu", &kb) == 1)
+            break;
+    if (f != NULL)
+        fclose(f);
+    return kb;
+}
+
+/* ---------- self-test: lab_exit() flushes, keeps the status, reports leaks ---------- */
+
+static void self_test(void) {
+    int fd[2];
+    char out[512] = "";
+    if (pipe(fd) != 0)
+        exit(1);
+    fflush(NULL);
+    pid_t pid = fork();
+    if (pid == 0) {
+        dup2(fd[1], 1);
+        dup2(fd[1], 2);
+        printf("bye");                   /* sits in the stdio buffer: a pipe */
+        table t = build(&lab_arena, 1000);
+        free_each(&lab_arena, &t, 1);    /* the last bucket leaks */
+        lab_exit(&lab_arena, 7);
+    }
+    close(fd[1]);
+    ssize_t got, len = 0;
+    while ((got = read(fd[0], out + len, sizeof out - 1 - (size_t)len)) > 0)
+        len += got;
+    close(fd[0]);
+    int status;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 7 || strstr(out, "bye") == NULL) {
+        fprintf(stderr, "self-test: lab_exit lost the status or stdout: \"%s\"\n", out);
+        exit(1);
+    }
+    int reported = strstr(out, "lab_exit: arena:") != NULL;
+    if (reported != !LAB_FAST_TEARDOWN) {
+        fprintf(stderr, "self-test: leak report %s\n", reported ? "in a release build" : "missing");
+        exit(1);
+    }
+    puts("self-test: ok");
+}
+
+/* ---------- benchmark ---------- */
+
+enum { FREE_EACH, FREE_BATCH, TEARDOWN };
+
+static double shutdown_time(const lab_allocator *a, size_t n, int how, size_t *rss) {
+    int fd[2];
+    double msg[2] = { 0, 0 };
+    if (pipe(fd) != 0)
+        return 0;
+    fflush(NULL);                        /* or every child prints it again */
+    pid_t pid = fork();
+    if (pid == 0) {
+        table t = build(a, n);
+        msg[1] = (double)rss_kb();
+        msg[0] = now_sec();
+        if (write(fd[1], msg, sizeof msg) != sizeof msg)
+            _exit(1);
+        if (how == FREE_EACH) {
+            free_each(a, &t, 0);
+            exit(0);
+        }
+        if (how == FREE_BATCH) {
+            free_batched(a, &t);
+            exit(0);
+        }
+        if (!LAB_FAST_TEARDOWN)
+            free_each(a, &t, 0);
+        lab_exit(a, 0);
+    }
+    close(fd[1]);
+    if (read(fd[0], msg, sizeof msg) != sizeof msg)
+        msg[0] = now_sec();
+    close(fd[0]);
+    waitpid(pid, NULL, 0);
+    *rss = (size_t)msg[1];
+    return now_sec() - msg[0];
+}
+
+int main(int argc, char **argv) {
+    size_t n = argc > 1 ? strtoul(argv[1], NULL, 10) : 3000000;
+    self_test();
+
+    static const char *const how[3] = { "free each", "free_batch", "teardown" };
+    printf("\n%zu records, %zu blocks; shutdown in ms (LAB_FAST_TEARDOWN=%d)\n",
+           n, 3 * n + 1, LAB_FAST_TEARDOWN);
+    printf("%-8s %8s %11s %11s %11s\n", "alloc", "heap MB", how[0], how[1], how[2]);
+    for (int k = 0; lab_allocators[k]; k++) {
+        const lab_allocator *a = lab_allocators[k];
+        size_t rss = 0;
+        double t[3];
+        for (int h = 0; h < 3; h++)
+            t[h] = shutdown_time(a, n, h, &rss);
+        printf("%-8s %8zu %11.1f %11.1f %11.1f\n", a->name, rss >> 10,
+               t[0] * 1e3, t[1] * 1e3, t[2] * 1e3);
+    }
+    return 0;
+}
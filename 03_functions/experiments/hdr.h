@@ -0,0 +1,324 @@
+/* hdr.h — HDR latency histograms: log-linear buckets, recorded per thread
+ * without locks, merged when someone reads them.
+ *
+ *   static hdr_hist step_lat = HDR_HIST("step");
+ *
+ *   HDR_TIME(&step_lat, run_step(ctx));     -DHDR_ENABLE: time the statement
+ *                                           otherwise: just run it
+ *   hdr_record(&step_lat, value);           any unit; HDR_TIME records ticks
+ *
+ *   hdr_counts c;                           (18 KB: static or heap, usually)
+ *   hdr_merge(&step_lat, &c);               all threads, any time
+ *   hdr_value_at(&c, 0.999);                p99.9, in the recorded unit
+ *   hdr_diff(&win, &c, &before);            what was recorded between two merges
+ *   hdr_print(stdout, "step", &c, hdr_ns_per_tick());
+ *                                           count, mean, p50, p99, p99.9, max
+ *
+ * Buckets: values below 2^HDR_SUB_BITS are exact; above, every power of
+ * two is split into 2^HDR_SUB_BITS equal sub-buckets, so a bucket is never
+ * wider than 1/64 of its values (1.6%). Values up to 2^HDR_MAX_BITS ticks
+ * (~6 min at 3 GHz) fit; larger ones land in the top bucket, and max keeps
+ * the true value.
+ *
+ * Each thread records into its own shard of the histogram: a plain load
+ * and store of one counter (relaxed atomics, no lock prefix), plus the sum
+ * and max. A shard is made on the thread's first record and pushed onto
+ * the histogram's list with one CAS. Readers walk the list and add up the
+ * counters as they find them. Shards are never freed: when a thread exits
+ * its shards keep their counts and the next new thread takes them over.
+ *
+ * A thread finds its shard through a pthread key held by the histogram
+ * itself, so one hdr_hist may be recorded from any number of translation
+ * units. Each unit keeps a small per-thread cache of (hist, shard) pairs
+ * in front of the key; the cache is only a shortcut.
+ *
+ * Header-only. HDR_TIME reads the same tick counter as trace.h (note 11).
+ */
+#ifndef HDR_H
+#define HDR_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>      /* __rdtsc */
+#endif
+
+#define HDR_SUB_BITS  6u
+#define HDR_SUB       (1u << HDR_SUB_BITS)
+#define HDR_MAX_BITS  40u
+#define HDR_BUCKETS   ((HDR_MAX_BITS - HDR_SUB_BITS + 1) * HDR_SUB)   /* 2240 */
+#define HDR_CACHE     16                  /* per-thread (hist, shard) pairs, per unit */
+
+/* a -finstrument-functions build (trace.h) must not trace the timing itself */
+#define HDR_NOINSTR __attribute__((no_instrument_function))
+
+typedef struct hdr_shard {
+    _Atomic uint64_t  count[HDR_BUCKETS];
+    _Atomic uint64_t  sum, max;
+    _Atomic int       owned;              /* 0: its thread exited */
+    struct hdr_shard *next;
+} hdr_shard;
+
+typedef struct {
+    const char           *name;
+    _Atomic int           ready;          /* 0: no key yet, 1: making it, 2: key valid */
+    pthread_key_t         key;            /* this thread's shard; released at exit */
+    _Atomic(hdr_shard *)  shards;         /* one per recording thread */
+} hdr_hist;
+
+#define HDR_HIST(name) { (name), 0, 0, NULL }
+
+/* a merged copy; n is the sum of count[], so it always matches it */
+typedef struct {
+    uint64_t n, sum, max;
+    uint64_t count[HDR_BUCKETS];
+} hdr_counts;
+
+/* per translation unit, per thread: a shortcut to pthread_getspecific */
+static __thread struct {
+    hdr_hist  *h;
+    hdr_shard *s;
+} hdr_cache[HDR_CACHE];
+
+/* ---------- buckets ---------- */
+
+static inline HDR_NOINSTR unsigned hdr_index(uint64_t v) {
+    if (v >> HDR_MAX_BITS)
+        return HDR_BUCKETS - 1;
+    if (v < HDR_SUB)
+        return (unsigned)v;
+    unsigned lg = 63u - (unsigned)__builtin_clzll(v);
+    return ((lg - HDR_SUB_BITS + 1) << HDR_SUB_BITS)
+           + (unsigned)(v >> (lg - HDR_SUB_BITS)) - HDR_SUB;
+}
+
+static inline HDR_NOINSTR uint64_t hdr_lowest(unsigned i) {
+    if (i < HDR_SUB)
+        return i;
+    unsigned k = i >> HDR_SUB_BITS;
+    return (uint64_t)(HDR_SUB + (i & (HDR_SUB - 1))) << (k - 1);
+}
+
+static inline HDR_NOINSTR uint64_t hdr_highest(unsigned i) {
+    return i < HDR_SUB ? i : hdr_lowest(i) + ((uint64_t)1 << ((i >> HDR_SUB_BITS) - 1)) - 1;
+}
+
+/* ---------- recording ---------- */
+
+static inline HDR_NOINSTR unsigned hdr_slot(const hdr_hist *h) {
+    return (unsigned)((uintptr_t)h >> 3) % HDR_CACHE;
+}
+
+/* the key's destructor: the exiting thread's shard is free to take over */
+static HDR_NOINSTR void hdr_release(void *arg) {
+    atomic_store_explicit(&((hdr_shard *)arg)->owned, 0, memory_order_release);
+}
+
+static HDR_NOINSTR void hdr_key_make(hdr_hist *h) {
+    int st = 0;
+    if (atomic_compare_exchange_strong(&h->ready, &st, 1)) {
+        if (pthread_key_create(&h->key, hdr_release) != 0) {
+            fprintf(stderr, "hdr: out of pthread keys for \"%s\"\n", h->name);
+            abort();
+        }
+        atomic_store_explicit(&h->ready, 2, memory_order_release);
+    }
+    while (atomic_load_explicit(&h->ready, memory_order_acquire) != 2)
+        ;                                /* another thread is making it */
+}
+
+/* mmap, not malloc: the histograms may be timing the allocator */
+static HDR_NOINSTR hdr_shard *hdr_shard_take(hdr_hist *h) {
+    hdr_shard *s;
+    for (s = atomic_load_explicit(&h->shards, memory_order_acquire); s; s = s->next) {
+        int free_ = 0;
+        if (atomic_compare_exchange_strong_explicit(&s->owned, &free_, 1,
+                                                    memory_order_acquire,
+                                                    memory_order_relaxed))
+            return s;                        /* an exited thread's shard */
+    }
+    s = mmap(NULL, sizeof *s, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (s == MAP_FAILED)
+        return NULL;
+    s->owned = 1;
+    s->next = atomic_load_explicit(&h->shards, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(&h->shards, &s->next, s,
+                                                  memory_order_release,
+                                                  memory_order_relaxed))
+        ;
+    return s;
+}
+
+/* a cache miss: the thread's shard from the key (maybe set by another
+ * unit), or a new one */
+__attribute__((noinline, cold)) static HDR_NOINSTR hdr_shard *hdr_shard_new(hdr_hist *h) {
+    hdr_key_make(h);
+    hdr_shard *s = pthread_getspecific(h->key);
+    if (s == NULL) {
+        if ((s = hdr_shard_take(h)) == NULL)
+            return NULL;
+        pthread_setspecific(h->key, s);
+    }
+    hdr_cache[hdr_slot(h)].h = h;
+    hdr_cache[hdr_slot(h)].s = s;
+    return s;
+}
+
+static inline HDR_NOINSTR void hdr_bump(_Atomic uint64_t *c, uint64_t by) {
+    atomic_store_explicit(c, atomic_load_explicit(c, memory_order_relaxed) + by,
+                          memory_order_relaxed);
+}
+
+static inline HDR_NOINSTR void hdr_record(hdr_hist *h, uint64_t v) {
+    unsigned i = hdr_slot(h);
+    hdr_shard *s = hdr_cache[i].s;
+    if (__builtin_expect(hdr_cache[i].h != h, 0) && (s = hdr_shard_new(h)) == NULL)
+        return;
+    hdr_bump(&s->count[hdr_index(v)], 1);
+    hdr_bump(&s->sum, v);
+    if (v > atomic_load_explicit(&s->max, memory_order_relaxed))
+        atomic_store_explicit(&s->max, v, memory_order_relaxed);
+}
+
+/* ---------- reading ---------- */
+
+/* Adds up every thread's shard. Threads still recording may be counted
+ * up to the moment each counter is read. */
+static inline HDR_NOINSTR void hdr_merge(hdr_hist *h, hdr_counts *out) {
+    memset(out, 0, sizeof *out);
+    for (hdr_shard *s = atomic_load_explicit(&h->shards, memory_order_acquire); s; s = s->next) {
+        for (unsigned i = 0; i < HDR_BUCKETS; i++) {
+            uint64_t c = atomic_load_explicit(&s->count[i], memory_order_relaxed);
+            out->count[i] += c;
+            out->n += c;
+        }
+        out->sum += atomic_load_explicit(&s->sum, memory_order_relaxed);
+        uint64_t m = atomic_load_explicit(&s->max, memory_order_relaxed);
+        out->max = m > out->max ? m : out->max;
+    }
+}
+
+/* the value at quantile q (0..1): the top of its bucket, never above max */
+static inline HDR_NOINSTR uint64_t hdr_value_at(const hdr_counts *c, double q) {
+    if (c->n == 0)
+        return 0;
+    uint64_t rank = (uint64_t)(q * (double)c->n + 0.5), seen = 0;
+    rank = rank < 1 ? 1 : rank > c->n ? c->n : rank;
+    for (unsigned i = 0; i < HDR_BUCKETS; i++)
+        if ((seen += c->count[i]) >= rank) {
+            uint64_t v = hdr_highest(i);
+            return v < c->max || c->max == 0 ? v : c->max;
+        }
+    return c->max;
+}
+
+/* now - before, for two merges of one histogram; max becomes the top of
+ * the highest bucket that moved */
+static inline HDR_NOINSTR void hdr_diff(hdr_counts *out, const hdr_counts *now,
+                                        const hdr_counts *before) {
+    out->n = out->max = 0;
+    out->sum = now->sum - before->sum;
+    for (unsigned i = 0; i < HDR_BUCKETS; i++) {
+        out->count[i] = now->count[i] - before->count[i];
+        out->n += out->count[i];
+        if (out->count[i])
+            out->max = hdr_highest(i);
+    }
+    out->max = out->max < now->max ? out->max : now->max;
+}
+
+static inline HDR_NOINSTR double hdr_mean(const hdr_counts *c) {
+    return c->n ? (double)c->sum / (double)c->n : 0.0;
+}
+
+/* ---------- ticks ---------- */
+
+static inline HDR_NOINSTR uint64_t hdr_ticks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t v;
+    __asm__ volatile("mrs %0, cntvct_el0" : "=r"(v));
+    return v;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static double hdr_scale = 1.0;
+static pthread_once_t hdr_scale_once = PTHREAD_ONCE_INIT;
+
+static inline HDR_NOINSTR uint64_t hdr_mono_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static inline HDR_NOINSTR void hdr_calibrate(void) {
+#if defined(__x86_64__) || defined(__i386__) || defined(__aarch64__)
+    uint64_t n0 = hdr_mono_ns(), t0 = hdr_ticks(), n1;
+    while ((n1 = hdr_mono_ns()) - n0 < 10000000u)   /* 10 ms, once */
+        ;
+    hdr_scale = (double)(n1 - n0) / (double)(hdr_ticks() - t0);
+#endif
+}
+
+/* ns per hdr_ticks() unit; the first call spins 10 ms to measure it */
+static inline HDR_NOINSTR double hdr_ns_per_tick(void) {
+    pthread_once(&hdr_scale_once, hdr_calibrate);
+    return hdr_scale;
+}
+
+/* ---------- the compile-time switch ---------- */
+
+#ifdef HDR_ENABLE
+#define HDR_TIME(h, ...)                                   \
+    do {                                                   \
+        uint64_t hdr_t0_ = hdr_ticks();                    \
+        __VA_ARGS__;                                       \
+        hdr_record((h), hdr_ticks() - hdr_t0_);            \
+    } while (0)
+#else
+#define HDR_TIME(h, ...) do { (void)(h); __VA_ARGS__; } while (0)
+#endif
+
+/* ---------- printing ---------- */
+
+static inline HDR_NOINSTR const char *hdr_fmt(char buf[16], double ns) {
+    if (ns < 10000)
+        snprintf(buf, 16, "%.0f ns", ns);
+    else if (ns < 1e6)
+        snprintf(buf, 16, "%.1f us", ns / 1e3);
+    else if (ns < 1e9)
+        snprintf(buf, 16, "%.1f ms", ns / 1e6);
+    else
+        snprintf(buf, 16, "%.1f s", ns / 1e9);
+    return buf;
+}
+
+static inline HDR_NOINSTR void hdr_print_header(FILE *f) {
+    fprintf(f, "%-16s %10s %10s %10s %10s %10s %10s\n", "", "count", "mean", "p50",
+            "p99", "p99.9", "max");
+}
+
+/* one row; k converts the recorded unit to ns (hdr_ns_per_tick() for ticks) */
+static inline HDR_NOINSTR void hdr_print(FILE *f, const char *label, const hdr_counts *c,
+                                         double k) {
+    char b[5][16];
+    fprintf(f, "%-16s %10llu %10s %10s %10s %10s %10s\n", label, (unsigned long long)c->n,
+            hdr_fmt(b[0], hdr_mean(c) * k), hdr_fmt(b[1], (double)hdr_value_at(c, 0.50) * k),
+            hdr_fmt(b[2], (double)hdr_value_at(c, 0.99) * k),
+            hdr_fmt(b[3], (double)hdr_value_at(c, 0.999) * k),
+            hdr_fmt(b[4], (double)c->max * k));
+}
+
+#endif /* HDR_H */
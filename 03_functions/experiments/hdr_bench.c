@@ -0,0 +1,304 @@
+/*
+ * hdr_bench.c — hdr.h checked and measured: bucket accuracy against exact
+ * sorted quantiles, merging shards from several threads, what a record
+ * costs next to a shared atomic or locked histogram, and a workload whose
+ * average hides its tail.
+ *
+ *   gcc -O2 -pthread hdr_bench.c -o hdr_bench
+ *   ./hdr_bench                  self-test + cost + tail demo
+ *   ./hdr_bench 4                cost with 4 recording threads (default 1, 2, 4)
+ */
+#include "hdr.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NOINLINE __attribute__((noipa))
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static double cpu_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void expect(int ok, const char *what) {
+    if (!ok) {
+        fprintf(stderr, "self-test: %s\n", what);
+        exit(1);
+    }
+}
+
+static uint64_t rng = 0x9E3779B97F4A7C15ULL;
+static uint64_t rnd(void) {
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    return rng;
+}
+
+/* latency-shaped: mostly tens to hundreds, a long tail up to ~2^30 */
+static uint64_t sample(void) {
+    uint64_t r = rnd();
+    unsigned lg = (r & 0xff) < 250 ? 4 + (unsigned)(r >> 8) % 6 : 10 + (unsigned)(r >> 8) % 20;
+    return (r >> 32) & (((uint64_t)2 << lg) - 1);
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/* ---------- self-test ---------- */
+
+static void test_buckets(void) {
+    for (uint64_t v = 0; v < 1000000; v++) {
+        unsigned i = hdr_index(v);
+        expect(hdr_lowest(i) <= v && v <= hdr_highest(i), "value outside its bucket");
+    }
+    for (int k = 0; k < 1000000; k++) {
+        uint64_t v = rnd() >> (24 + k % 40);
+        unsigned i = hdr_index(v);
+        uint64_t width = hdr_highest(i) - hdr_lowest(i) + 1;
+        expect(hdr_lowest(i) <= v && v <= hdr_highest(i), "large value outside its bucket");
+        expect(width == 1 || width <= hdr_lowest(i) / HDR_SUB, "bucket wider than 1/64");
+    }
+    expect(hdr_index((uint64_t)1 << HDR_MAX_BITS) == HDR_BUCKETS - 1
+           && hdr_index(~(uint64_t)0) == HDR_BUCKETS - 1, "overflow bucket");
+    expect(hdr_index(((uint64_t)1 << HDR_MAX_BITS) - 1) == HDR_BUCKETS - 1, "top of the range");
+}
+
+static void test_quantiles(void) {
+    enum { N = 1000000 };
+    static hdr_hist h = HDR_HIST("q");
+    static hdr_counts c;
+    uint64_t *v = malloc(N * sizeof *v), sum = 0;
+    for (int i = 0; i < N; i++) {
+        v[i] = sample();
+        sum += v[i];
+        hdr_record(&h, v[i]);
+    }
+    qsort(v, N, sizeof *v, cmp_u64);
+    hdr_merge(&h, &c);
+    expect(c.n == N && c.sum == sum && c.max == v[N - 1], "count, sum, max");
+    static const double q[] = { 0.0, 0.25, 0.5, 0.9, 0.99, 0.999, 0.9999, 1.0 };
+    for (size_t k = 0; k < sizeof q / sizeof *q; k++) {
+        uint64_t rank = (uint64_t)(q[k] * N + 0.5);
+        uint64_t exact = v[rank < 1 ? 0 : rank - 1], got = hdr_value_at(&c, q[k]);
+        /* same bucket: never below, at most one bucket width above */
+        expect(got >= exact && (double)got <= (double)exact * (1.0 + 1.0 / HDR_SUB) + 1,
+               "quantile more than 1/64 off");
+    }
+    free(v);
+}
+
+enum { THREADS = 4, PER_THREAD = 250000 };
+static hdr_hist mt = HDR_HIST("mt");
+
+static void *record_some(void *arg) {
+    uint64_t base = (uint64_t)(uintptr_t)arg;
+    for (uint64_t i = 0; i < PER_THREAD; i++)
+        hdr_record(&mt, base + i % 1000);
+    return NULL;
+}
+
+static void test_threads(void) {
+    static hdr_counts c, before, d;
+    pthread_t th[THREADS];
+    for (uintptr_t t = 0; t < THREADS; t++)
+        pthread_create(&th[t], NULL, record_some, (void *)(t * 1000));
+    /* merging while they record: counts only ever grow */
+    for (int k = 0; k < 50; k++) {
+        hdr_merge(&mt, &c);
+        expect(c.n >= before.n, "merge went backwards");
+        before = c;
+    }
+    for (int t = 0; t < THREADS; t++)
+        pthread_join(th[t], NULL);
+    hdr_merge(&mt, &c);
+    uint64_t sum = 0;
+    for (uint64_t t = 0; t < THREADS; t++)
+        sum += (t * 1000 * 1000 + 999 * 1000 / 2) * (PER_THREAD / 1000);
+    expect(c.n == THREADS * PER_THREAD && c.sum == sum, "merged totals");
+    expect(c.max == THREADS * 1000 - 1 && hdr_value_at(&c, 0.0) == 0, "merged range");
+    int shards = 0;
+    for (hdr_shard *s = atomic_load(&mt.shards); s; s = s->next)
+        shards++;
+    expect(shards >= 1 && shards <= THREADS, "at most one shard per thread");
+    for (uintptr_t t = 0; t < THREADS; t++)        /* exited threads' shards */
+        pthread_create(&th[t], NULL, record_some, (void *)0);   /* are reused */
+    for (int t = 0; t < THREADS; t++)
+        pthread_join(th[t], NULL);
+    shards = 0;
+    for (hdr_shard *s = atomic_load(&mt.shards); s; s = s->next)
+        shards++;
+    hdr_merge(&mt, &c);
+    expect(shards <= THREADS && c.n == 2 * THREADS * PER_THREAD, "shard reuse");
+
+    hdr_diff(&d, &c, &before);
+    expect(d.n == 2 * THREADS * PER_THREAD - before.n && d.max <= c.max, "diff");
+}
+
+static void self_test(void) {
+    test_buckets();
+    test_quantiles();
+    test_threads();
+}
+
+/* ---------- cost ---------- */
+
+/* the same buckets, shared: one array for all threads */
+static _Atomic uint64_t shared_counts[HDR_BUCKETS];
+static uint64_t locked_counts[HDR_BUCKETS];
+static pthread_mutex_t locked_mu = PTHREAD_MUTEX_INITIALIZER;
+static hdr_hist cost_h = HDR_HIST("cost");
+
+enum { KIND_HDR, KIND_ATOMIC, KIND_MUTEX, KIND_TIME };
+
+typedef struct {
+    int kind;
+    long n;
+    double sec;
+} cost_job;
+
+static pthread_barrier_t start;
+
+NOINLINE static void *cost_worker(void *arg) {
+    cost_job *j = arg;
+    uint64_t v = 100 + (uint64_t)(uintptr_t)j % 64, sink = 0;
+    pthread_barrier_wait(&start);
+    double t = cpu_sec();
+    for (long i = 0; i < j->n; i++) {
+        uint64_t x = v + (uint64_t)(i & 255);
+        switch (j->kind) {
+        case KIND_HDR:
+            hdr_record(&cost_h, x);
+            break;
+        case KIND_ATOMIC:
+            atomic_fetch_add_explicit(&shared_counts[hdr_index(x)], 1, memory_order_relaxed);
+            break;
+        case KIND_MUTEX:
+            pthread_mutex_lock(&locked_mu);
+            locked_counts[hdr_index(x)]++;
+            pthread_mutex_unlock(&locked_mu);
+            break;
+        case KIND_TIME: {
+            uint64_t t0 = hdr_ticks();
+            sink += x;
+            hdr_record(&cost_h, hdr_ticks() - t0);
+            break;
+        }
+        }
+    }
+    j->sec = cpu_sec() - t;
+    __asm__ volatile("" :: "r"(sink));
+    return NULL;
+}
+
+/* ns per record, as seen by one thread, with nthreads recording at once */
+static double cost(int kind, int nthreads, long n) {
+    pthread_t th[16];
+    cost_job jobs[16];
+    pthread_barrier_init(&start, NULL, (unsigned)nthreads);
+    for (int t = 0; t < nthreads; t++) {
+        jobs[t] = (cost_job){ kind, n, 0 };
+        pthread_create(&th[t], NULL, cost_worker, &jobs[t]);
+    }
+    double sum = 0;
+    for (int t = 0; t < nthreads; t++) {
+        pthread_join(th[t], NULL);
+        sum += jobs[t].sec;
+    }
+    pthread_barrier_destroy(&start);
+    return sum / nthreads / (double)n * 1e9;
+}
+
+static void cost_table(const int *threads, int nt) {
+    static const char *const name[] = { "hdr_record (per-thread shard)",
+                                        "shared array, atomic add",
+                                        "shared array, mutex",
+                                        "HDR_TIME: 2 ticks + record" };
+    printf("\nns per record, CPU time of the recording thread, best of 3\n%-32s", "");
+    for (int i = 0; i < nt; i++)
+        printf(" %6d thr", threads[i]);
+    putchar('\n');
+    for (int kind = 0; kind < 4; kind++) {
+        printf("%-32s", name[kind]);
+        for (int i = 0; i < nt; i++) {
+            double best = 1e30;
+            for (int r = 0; r < 3; r++) {
+                double ns = cost(kind, threads[i], 4000000 / threads[i]);
+                best = ns < best ? ns : best;
+            }
+            printf(" %10.2f", best);
+        }
+        putchar('\n');
+    }
+    static hdr_counts c;
+    double t = now_sec();
+    for (int r = 0; r < 100; r++)
+        hdr_merge(&cost_h, &c);
+    int shards = 0;
+    for (hdr_shard *s = atomic_load(&cost_h.shards); s; s = s->next)
+        shards++;
+    printf("hdr_merge, %d shards: %.1f us\n", shards, (now_sec() - t) / 100 * 1e6);
+}
+
+/* ---------- what an average hides ---------- */
+
+/* a step that usually does a little work and once in 200 calls a lot: a
+ * cache refill, a rehash, a page fault storm */
+NOINLINE static uint64_t step(uint64_t i) {
+    uint64_t h = i, work = i % 200 == 0 ? 200000 : 200;
+    for (uint64_t k = 0; k < work; k++)
+        h = h * 6364136223846793005u + 1442695040888963407u;
+    return h;
+}
+
+static void tail_demo(void) {
+    static hdr_hist h = HDR_HIST("step");
+    static hdr_counts c;
+    uint64_t sink = 0;
+    for (uint64_t i = 0; i < 20000; i++) {
+        uint64_t t0 = hdr_ticks();
+        sink += step(i);
+        hdr_record(&h, hdr_ticks() - t0);
+    }
+    __asm__ volatile("" :: "r"(sink));
+    hdr_merge(&h, &c);
+    printf("\n20000 calls of a step that is slow 1 time in 200\n");
+    hdr_print_header(stdout);
+    hdr_print(stdout, "step", &c, hdr_ns_per_tick());
+    printf("mean / p50 = %.1f: the mean is a latency almost no call had\n",
+           hdr_mean(&c) / (double)hdr_value_at(&c, 0.5));
+    printf("p99.9 / p99 = %.0f: the slow calls only show above p99.5\n",
+           (double)hdr_value_at(&c, 0.999) / (double)hdr_value_at(&c, 0.99));
+}
+
+int main(int argc, char **argv) {
+    int threads[3] = { 1, 2, 4 }, nt = 3;
+    if (argc > 1) {
+        threads[0] = atoi(argv[1]);
+        nt = 1;
+        if (threads[0] < 1 || threads[0] > 16) {
+            fprintf(stderr, "usage: %s [threads 1..16]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    self_test();
+    puts("self-test: ok");
+    printf("%.4f ns/tick, %u buckets, %zu KB per thread per histogram\n",
+           hdr_ns_per_tick(), HDR_BUCKETS, sizeof(hdr_shard) / 1024);
+    cost_table(threads, nt);
+    tail_demo();
+    return 0;
+}
@@ -0,0 +1,121 @@
+/*
+ * profile_demo.c — a small workload with known hot spots, to profile with
+ * sprof (or anything else). It knows nothing about the profiler.
+ *
+ *   main ─► runWorkflow ─► evaluate ─► average        (note 01's function)
+ *                       └► sortScores ─► insertionSort
+ *   worker thread ─► checksum
+ *
+ * Functions are non-static and noinline so each keeps its own frame and
+ * dladdr() can name it (with -rdynamic).
+ *
+ *   make profile SRC=03_functions/experiments/profile_demo.c
+ *   # or by hand:
+ *   gcc -O2 -g -fno-omit-frame-pointer -rdynamic -pthread \
+ *       profile_demo.c sprof.c -o profile_demo
+ *   SPROF_OUT=demo.folded SPROF_PPROF=demo.prof ./profile_demo
+ *   flamegraph.pl demo.folded > demo.svg
+ *
+ * The steps of runWorkflow as latency histograms (hdr.h) instead:
+ *   make latency SRC=03_functions/experiments/profile_demo.c   (-DHDR_ENABLE, 10 runs)
+ *   ./profile_demo_hdr 50
+ */
+#include "hdr.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NOINLINE __attribute__((noipa))   /* no inlining, no pure-call hoisting */
+
+NOINLINE float average(const int *arr, int size) {
+    float sum = 0;                     /* float: a serial add chain, not vectorized */
+    for (int i = 0; i < size; i++)
+        sum += (float)arr[i];
+    return sum / (float)size;
+}
+
+NOINLINE void insertionSort(int *arr, int size) {
+    for (int i = 1; i < size; i++) {
+        int v = arr[i], j = i - 1;
+        while (j >= 0 && arr[j] > v) {
+            arr[j + 1] = arr[j];
+            j--;
+        }
+        arr[j + 1] = v;
+    }
+}
+
+NOINLINE void sortScores(int *scores, int size) {
+    for (int i = 0; i < size; i++)
+        scores[i] = (int)((unsigned)(i * 2654435761u) >> 16);
+    insertionSort(scores, size);
+}
+
+NOINLINE double evaluate(const int *scores, int size, int rounds) {
+    double acc = 0;
+    for (int r = 0; r < rounds; r++)
+        acc += average(scores, size);
+    return acc;
+}
+
+static hdr_hist sort_lat = HDR_HIST("sortScores");
+static hdr_hist evaluate_lat = HDR_HIST("evaluate");
+
+NOINLINE double runWorkflow(int *scores, int size, int rounds) {
+    double r;
+    HDR_TIME(&sort_lat, sortScores(scores, size));
+    HDR_TIME(&evaluate_lat, r = evaluate(scores, size, rounds));
+    return r;
+}
+
+NOINLINE uint64_t checksum(const int *arr, int size, int rounds) {
+    uint64_t h = 1469598103934665603ull;
+    for (int r = 0; r < rounds; r++)
+        for (int i = 0; i < size; i++)
+            h = (h ^ (uint64_t)arr[i]) * 1099511628211ull;
+    return h;
+}
+
+typedef struct {
+    const int *arr;
+    int size, rounds;
+    uint64_t result;
+} job;
+
+NOINLINE void *worker(void *arg) {
+    job *j = arg;
+    j->result = checksum(j->arr, j->size, j->rounds);
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    int scale = argc > 1 ? atoi(argv[1]) : 1;
+    enum { N = 30000 };
+    int *scores = malloc(N * sizeof *scores);
+    int *noise = malloc(N * sizeof *noise);
+    for (int i = 0; i < N; i++)
+        noise[i] = i * 7;
+
+    job j = { noise, N, 20000 * scale, 0 };
+    pthread_t t;
+    pthread_create(&t, NULL, worker, &j);
+    double r = 0;
+    for (int k = 0; k < scale; k++)
+        r += runWorkflow(scores, N, 20000);
+    pthread_join(t, NULL);
+
+    printf("workflow %.1f, checksum %016llx\n", r, (unsigned long long)j.result);
+#ifdef HDR_ENABLE
+    static hdr_counts c;
+    hdr_print_header(stdout);
+    hdr_merge(&sort_lat, &c);
+    hdr_print(stdout, sort_lat.name, &c, hdr_ns_per_tick());
+    hdr_merge(&evaluate_lat, &c);
+    hdr_print(stdout, evaluate_lat.name, &c, hdr_ns_per_tick());
+#endif
+    free(scores);
+    free(noise);
+    return 0;
+}
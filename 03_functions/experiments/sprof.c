@@ -0,0 +1,437 @@
+/*
+ * sprof.c — implementation of sprof.h.
+ *
+ * Signal-handler side (async-signal-safe: no locks, no malloc, no stdio):
+ *   - SIGPROF from setitimer(ITIMER_PROF) lands on the thread that used
+ *     the CPU time;
+ *   - the handler reads pc / frame pointer / sp out of the ucontext and
+ *     follows the saved-BP chain while it stays inside [sp, sp + 8 MB) and
+ *     keeps going up the stack;
+ *   - the stack is counted in an open-addressing table that belongs to the
+ *     current thread (claimed on its first sample with one atomic
+ *     fetch_add, memory from mmap), so threads never share a cache line.
+ *
+ * Everything else (merging, dladdr, file output) runs after sprof_stop().
+ *
+ *   gcc -O2 -g -fno-omit-frame-pointer -rdynamic -pthread prog.c sprof.c
+ *   SPROF_OUT=prog.folded SPROF_PPROF=prog.prof ./a.out
+ */
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <link.h>       /* dl_iterate_phdr */
+#include <sched.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include "sprof.h"
+
+#define SPROF_STACK_SPAN (8u << 20)  /* how far above sp a frame may be */
+#define SPROF_PROBES     64
+#define SPROF_MAX_TEXT   64          /* executable segments remembered */
+#define SPROF_LEAF_MAX   (64u << 10) /* largest function the leaf check accepts */
+
+typedef struct {
+    uint64_t  hash;                  /* 0 = empty slot */
+    uint32_t  count;
+    uint32_t  depth;
+    uintptr_t pc[SPROF_DEPTH];       /* [0] = interrupted pc, then return addresses */
+} sprof_entry;
+
+typedef struct {
+    size_t      samples, lost;
+    sprof_entry e[SPROF_TABLE];
+} sprof_table;
+
+static sprof_table *_Atomic tables[SPROF_MAX_THREADS];
+static atomic_int    ntables;
+static atomic_size_t lost_no_table;
+static atomic_int    running;
+static atomic_int    in_handler;
+static int           period_us;
+
+/* Executable segments, collected by sprof_start(); the handler only reads
+ * code bytes inside these. */
+static struct { uintptr_t lo, hi; } text[SPROF_MAX_TEXT];
+static int ntext;
+
+static __thread sprof_table *my_table;
+static __thread int          my_table_failed;
+
+/* ---------- signal handler side ---------- */
+
+static sprof_table *claim_table(void) {
+    if (my_table_failed)
+        return NULL;
+    int idx = atomic_fetch_add(&ntables, 1);
+    void *p = MAP_FAILED;
+    if (idx < SPROF_MAX_THREADS)
+        p = mmap(NULL, sizeof(sprof_table), PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (p == MAP_FAILED) {
+        my_table_failed = 1;
+        return NULL;
+    }
+    my_table = p;                    /* mmap memory is already zero */
+    atomic_store_explicit(&tables[idx], my_table, memory_order_release);
+    return my_table;
+}
+
+static int in_text(uintptr_t lo, uintptr_t hi) {
+    for (int i = 0; i < ntext; i++)
+        if (lo >= text[i].lo && hi <= text[i].hi)
+            return 1;
+    return 0;
+}
+
+#if defined(__x86_64__)
+/* GCC omits the frame in leaf functions that need no stack, even with
+ * -fno-omit-frame-pointer. There (and in any prologue before `push rbp`)
+ * the return address is still at [sp] and rbp is the *caller's* frame, so
+ * the caller would be skipped. Accept [sp] as a return address only if it
+ * follows a direct call (e8 rel32) whose target is at or just before pc. */
+static uintptr_t leaf_return(uintptr_t ip, uintptr_t sp) {
+    uintptr_t ret = *(const uintptr_t *)sp;
+    if (ret < 5 || !in_text(ret - 5, ret))
+        return 0;
+    const unsigned char *call = (const unsigned char *)(ret - 5);
+    if (call[0] != 0xe8)
+        return 0;
+    uint32_t rel = (uint32_t)call[1] | (uint32_t)call[2] << 8 |
+                   (uint32_t)call[3] << 16 | (uint32_t)call[4] << 24;
+    uintptr_t target = ret + (uintptr_t)(intptr_t)(int32_t)rel;
+    return target <= ip && ip - target < SPROF_LEAF_MAX ? ret : 0;
+}
+#endif
+
+/* Fills pc[] innermost first; returns the depth. */
+static int unwind(const ucontext_t *uc, uintptr_t *pc, int max) {
+#if defined(__x86_64__)
+    uintptr_t ip = (uintptr_t)uc->uc_mcontext.gregs[REG_RIP];
+    uintptr_t fp = (uintptr_t)uc->uc_mcontext.gregs[REG_RBP];
+    uintptr_t sp = (uintptr_t)uc->uc_mcontext.gregs[REG_RSP];
+#elif defined(__aarch64__)
+    uintptr_t ip = (uintptr_t)uc->uc_mcontext.pc;
+    uintptr_t fp = (uintptr_t)uc->uc_mcontext.regs[29];
+    uintptr_t sp = (uintptr_t)uc->uc_mcontext.sp;
+#else
+    uintptr_t ip = 0, fp = 0, sp = 0;   /* unknown ABI: one "[unknown]" frame */
+    (void)uc;
+#endif
+    int n = 0;
+    pc[n++] = ip;
+#if defined(__x86_64__)
+    uintptr_t leaf = leaf_return(ip, sp);
+    if (leaf)
+        pc[n++] = leaf;
+#endif
+    /* A frame record is { saved fp, return address } at fp. Code built
+     * without frame pointers (libc, mostly) uses fp as a plain register,
+     * so every step must stay on this stack and move towards its base. */
+    while (n < max && fp >= sp && fp < sp + SPROF_STACK_SPAN &&
+           (fp & (sizeof(uintptr_t) - 1)) == 0) {
+        const uintptr_t *rec = (const uintptr_t *)fp;
+        uintptr_t next = rec[0], ret = rec[1];
+        if (ret == 0)
+            break;
+        pc[n++] = ret;
+        if (next <= fp)
+            break;
+        fp = next;
+    }
+    return n;
+}
+
+static void record(sprof_table *t, const uintptr_t *pc, int n) {
+    uint64_t h = 0xcbf29ce484222325ull ^ (uint64_t)n;
+    for (int i = 0; i < n; i++) {
+        h ^= pc[i];
+        h *= 0x100000001b3ull;
+    }
+    h |= 1;                                      /* never 0 (= empty) */
+    for (size_t probe = 0, i = h; probe < SPROF_PROBES; probe++, i++) {
+        sprof_entry *e = &t->e[i & (SPROF_TABLE - 1)];
+        if (e->hash == 0) {
+            for (int k = 0; k < n; k++)
+                e->pc[k] = pc[k];
+            e->depth = (uint32_t)n;
+            e->count = 1;
+            e->hash = h;
+            t->samples++;
+            return;
+        }
+        if (e->hash == h && e->depth == (uint32_t)n) {
+            int k = 0;
+            while (k < n && e->pc[k] == pc[k])
+                k++;
+            if (k == n) {
+                e->count++;
+                t->samples++;
+                return;
+            }
+        }
+    }
+    t->lost++;
+}
+
+static void on_sigprof(int sig, siginfo_t *si, void *ctx) {
+    (void)sig;
+    (void)si;
+    int saved_errno = errno;
+    atomic_fetch_add(&in_handler, 1);            /* seq_cst: pairs with sprof_stop */
+    if (atomic_load(&running)) {
+        sprof_table *t = my_table ? my_table : claim_table();
+        if (t) {
+            uintptr_t pc[SPROF_DEPTH];
+            record(t, pc, unwind(ctx, pc, SPROF_DEPTH));
+        } else {
+            atomic_fetch_add_explicit(&lost_no_table, 1, memory_order_relaxed);
+        }
+    }
+    atomic_fetch_sub(&in_handler, 1);
+    errno = saved_errno;
+}
+
+/* ---------- control ---------- */
+
+static int add_text(struct dl_phdr_info *info, size_t size, void *arg) {
+    (void)size;
+    (void)arg;
+    for (int i = 0; i < info->dlpi_phnum && ntext < SPROF_MAX_TEXT; i++) {
+        const ElfW(Phdr) *ph = &info->dlpi_phdr[i];
+        if (ph->p_type == PT_LOAD && (ph->p_flags & PF_X)) {
+            text[ntext].lo = info->dlpi_addr + ph->p_vaddr;
+            text[ntext].hi = text[ntext].lo + ph->p_memsz;
+            ntext++;
+        }
+    }
+    return 0;
+}
+
+int sprof_start(int hz) {
+    if (hz <= 0)
+        hz = 997;
+    ntext = 0;
+    dl_iterate_phdr(add_text, NULL);
+    struct sigaction sa;
+    memset(&sa, 0, sizeof sa);
+    sa.sa_sigaction = on_sigprof;
+    sa.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    if (sigaction(SIGPROF, &sa, NULL) != 0)
+        return -1;
+    period_us = 1000000 / hz > 0 ? 1000000 / hz : 1;
+    struct itimerval it = { { 0, period_us }, { 0, period_us } };
+    atomic_store(&running, 1);
+    if (setitimer(ITIMER_PROF, &it, NULL) != 0) {
+        atomic_store(&running, 0);
+        return -1;
+    }
+    return 0;
+}
+
+void sprof_stop(void) {
+    struct itimerval off = { { 0, 0 }, { 0, 0 } };
+    setitimer(ITIMER_PROF, &off, NULL);
+    atomic_store(&running, 0);
+    /* a SIGPROF already queued must not kill the process */
+    signal(SIGPROF, SIG_IGN);
+    while (atomic_load(&in_handler) != 0)
+        sched_yield();
+}
+
+static int table_count(void) {
+    int n = atomic_load(&ntables);
+    return n < SPROF_MAX_THREADS ? n : SPROF_MAX_THREADS;
+}
+
+sprof_stats sprof_get_stats(void) {
+    sprof_stats st = { 0, atomic_load(&lost_no_table), 0, 0 };
+    for (int i = 0; i < table_count(); i++) {
+        const sprof_table *t = atomic_load_explicit(&tables[i], memory_order_acquire);
+        if (!t)
+            continue;
+        st.threads++;
+        st.samples += t->samples;
+        st.lost += t->lost;
+        for (size_t k = 0; k < SPROF_TABLE; k++)
+            st.stacks += t->e[k].hash != 0;
+    }
+    return st;
+}
+
+/* ---------- output ---------- */
+
+/* Name for a pc; return addresses are moved back into the call. */
+static void symbolize(uintptr_t pc, int is_return, char *buf, size_t cap) {
+    uintptr_t at = is_return ? pc - 1 : pc;
+    Dl_info info;
+    int found = dladdr((void *)at, &info);
+    if (found && info.dli_sname) {
+        snprintf(buf, cap, "%s", info.dli_sname);
+    } else if (found && info.dli_fname && info.dli_fbase) {
+        const char *base = strrchr(info.dli_fname, '/');
+        snprintf(buf, cap, "%s+0x%lx", base ? base + 1 : info.dli_fname,
+                 (unsigned long)(at - (uintptr_t)info.dli_fbase));
+    } else {
+        snprintf(buf, cap, "0x%lx", (unsigned long)at);
+    }
+}
+
+typedef struct {
+    char  *text;
+    size_t count;
+} named;
+
+static int by_text(const void *a, const void *b) {
+    return strcmp(((const named *)a)->text, ((const named *)b)->text);
+}
+
+static int by_count_desc(const void *a, const void *b) {
+    size_t x = ((const named *)a)->count, y = ((const named *)b)->count;
+    return x < y ? 1 : x > y ? -1 : 0;
+}
+
+/* One entry per recorded stack over all threads; leaf_only names just
+ * the innermost frame. Sorted and merged by text. Returns the count. */
+static size_t collect(named **out, int leaf_only) {
+    sprof_stats st = sprof_get_stats();
+    named *v = calloc(st.stacks ? st.stacks : 1, sizeof *v);
+    size_t n = 0;
+    char sym[256];
+    if (!v)
+        return 0;
+    for (int i = 0; i < table_count(); i++) {
+        const sprof_table *t = atomic_load_explicit(&tables[i], memory_order_acquire);
+        for (size_t k = 0; t && k < SPROF_TABLE; k++) {
+            const sprof_entry *e = &t->e[k];
+            if (!e->hash)
+                continue;
+            size_t cap = leaf_only ? sizeof sym : (size_t)e->depth * sizeof sym;
+            char *s = malloc(cap), *p = s;
+            if (!s)
+                continue;
+            *s = '\0';
+            for (int d = leaf_only ? 0 : (int)e->depth - 1; d >= 0; d--) {   /* root first */
+                symbolize(e->pc[d], d > 0, sym, sizeof sym);
+                p += snprintf(p, cap - (size_t)(p - s), "%s%s", p == s ? "" : ";", sym);
+            }
+            v[n++] = (named){ s, e->count };
+        }
+    }
+    qsort(v, n, sizeof *v, by_text);
+    size_t m = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (m && strcmp(v[m - 1].text, v[i].text) == 0) {
+            v[m - 1].count += v[i].count;
+            free(v[i].text);
+        } else {
+            v[m++] = v[i];
+        }
+    }
+    *out = v;
+    return m;
+}
+
+static void free_named(named *v, size_t n) {
+    for (size_t i = 0; i < n; i++)
+        free(v[i].text);
+    free(v);
+}
+
+int sprof_write_folded(const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f)
+        return -1;
+    named *v;
+    size_t n = collect(&v, 0);
+    for (size_t i = 0; i < n; i++)
+        fprintf(f, "%s %zu\n", v[i].text, v[i].count);
+    free_named(v, n);
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+/* gperftools' legacy format, all words native uintptr_t:
+ *   header   0, 3, 0, period_us, 0
+ *   sample   count, depth, pc[0] .. pc[depth-1]
+ *   trailer  0, 1, 0
+ * followed by the text of /proc/self/maps so pprof can map the pcs. */
+int sprof_write_pprof(const char *path) {
+    FILE *f = fopen(path, "wb");
+    if (!f)
+        return -1;
+    uintptr_t hdr[5] = { 0, 3, 0, (uintptr_t)period_us, 0 };
+    fwrite(hdr, sizeof hdr, 1, f);
+    for (int i = 0; i < table_count(); i++) {
+        const sprof_table *t = atomic_load_explicit(&tables[i], memory_order_acquire);
+        for (size_t k = 0; t && k < SPROF_TABLE; k++) {
+            const sprof_entry *e = &t->e[k];
+            if (!e->hash)
+                continue;
+            uintptr_t rec[2] = { e->count, e->depth };
+            fwrite(rec, sizeof rec, 1, f);
+            fwrite(e->pc, sizeof e->pc[0], e->depth, f);
+        }
+    }
+    uintptr_t trailer[3] = { 0, 1, 0 };
+    fwrite(trailer, sizeof trailer, 1, f);
+    int maps = open("/proc/self/maps", O_RDONLY);
+    if (maps >= 0) {
+        char buf[4096];
+        ssize_t r;
+        while ((r = read(maps, buf, sizeof buf)) > 0)
+            fwrite(buf, 1, (size_t)r, f);
+        close(maps);
+    }
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+void sprof_report_top(int top) {
+    sprof_stats st = sprof_get_stats();
+    named *v;
+    size_t n = collect(&v, 1);
+    qsort(v, n, sizeof *v, by_count_desc);
+    fprintf(stderr, "sprof: %zu samples (%zu lost), %zu stacks, %zu threads\n",
+            st.samples, st.lost, st.stacks, st.threads);
+    fprintf(stderr, "  self%%  samples  function\n");
+    for (size_t i = 0; i < n && i < (size_t)top; i++)
+        fprintf(stderr, "%6.1f%% %8zu  %s\n",
+                st.samples ? 100.0 * (double)v[i].count / (double)st.samples : 0.0,
+                v[i].count, v[i].text);
+    free_named(v, n);
+}
+
+/* ---------- SPROF_OUT / SPROF_PPROF ---------- */
+
+static const char *auto_folded, *auto_pprof;
+
+static void sprof_auto_finish(void) {
+    sprof_stop();
+    if (auto_folded && sprof_write_folded(auto_folded) != 0)
+        perror(auto_folded);
+    if (auto_pprof && sprof_write_pprof(auto_pprof) != 0)
+        perror(auto_pprof);
+    sprof_report_top(10);
+}
+
+__attribute__((constructor))
+static void sprof_auto_start(void) {
+    auto_folded = getenv("SPROF_OUT");
+    auto_pprof = getenv("SPROF_PPROF");
+    if (!auto_folded && !auto_pprof)
+        return;
+    const char *hz = getenv("SPROF_HZ");
+    if (sprof_start(hz ? atoi(hz) : 0) != 0)
+        perror("sprof_start");
+    else
+        atexit(sprof_auto_finish);
+}
@@ -0,0 +1,56 @@
+/* sprof.h — in-process sampling profiler that walks frame pointers.
+ *
+ * Note 01 draws each stack frame as [locals | saved BP | return address].
+ * With -fno-omit-frame-pointer every function keeps that layout, so the
+ * saved BPs form a linked list from the innermost frame up to main():
+ *
+ *   rbp ──► [ saved rbp ] ──► [ saved rbp ] ──► ... ──► 0
+ *           [ ret addr  ]     [ ret addr  ]
+ *
+ * A SIGPROF timer interrupts the program every 1/hz of CPU time; the
+ * handler walks that list and counts the stack in a table owned by the
+ * interrupted thread (no locks, no malloc in the handler). At the end the
+ * stacks are symbolized and written as
+ *
+ *   folded   "main;run;average 123"  — input for flamegraph.pl / speedscope
+ *   pprof    legacy CPU-profile format: `pprof --text ./prog file`
+ *
+ * Link sprof.c into the program (see `make profile`). Setting SPROF_OUT
+ * and/or SPROF_PPROF in the environment starts it before main() and
+ * writes the files at exit; SPROF_HZ overrides the rate (default 997).
+ * Build with -fno-omit-frame-pointer, and -rdynamic so dladdr() can name
+ * the executable's own (non-static) functions.
+ */
+#ifndef SPROF_H
+#define SPROF_H
+
+#include <stddef.h>
+
+#define SPROF_DEPTH       48     /* frames kept per sample              */
+#define SPROF_MAX_THREADS 64     /* threads that can own a sample table */
+#define SPROF_TABLE       4096   /* distinct stacks per thread (pow2)   */
+
+typedef struct {
+    size_t samples;              /* recorded */
+    size_t lost;                 /* table full or too many threads */
+    size_t stacks;               /* distinct stacks over all threads */
+    size_t threads;
+} sprof_stats;
+
+/* Starts sampling at hz samples per CPU-second. Returns 0, or -1 with
+ * errno set. */
+int  sprof_start(int hz);
+
+/* Stops the timer and waits for handlers still running on other threads. */
+void sprof_stop(void);
+
+/* Both return 0, or -1 with errno set. Call after sprof_stop(). */
+int  sprof_write_folded(const char *path);
+int  sprof_write_pprof(const char *path);
+
+sprof_stats sprof_get_stats(void);
+
+/* Prints the n functions with the most self samples to stderr. */
+void sprof_report_top(int n);
+
+#endif /* SPROF_H */
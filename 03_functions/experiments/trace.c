@@ -0,0 +1,194 @@
+/* trace.c — ring registry, -finstrument-functions hooks and the Chrome
+ * trace JSON writer for trace.h.
+ *
+ * Every function here is TRACE_NOINSTR: this file may be compiled with
+ * -finstrument-functions together with the program, and a hooked hook
+ * would recurse.
+ */
+#define _GNU_SOURCE
+#include "trace.h"
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+__thread trace_ring *trace_tls;
+
+static trace_ring *_Atomic rings[TRACE_MAX_THREADS];
+static atomic_uint ring_count;          /* claims; may exceed the array */
+
+/* ticks -> ns: calibrated between the constructor and the dump */
+static uint64_t tick0, ns0;
+
+static TRACE_NOINSTR uint64_t mono_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+TRACE_NOINSTR trace_ring *trace_ring_new(void) {
+    static __thread int refused;        /* no slot: don't retry every event */
+    if (refused)
+        return NULL;
+    unsigned slot = atomic_fetch_add(&ring_count, 1);
+    trace_ring *r = slot < TRACE_MAX_THREADS ? calloc(1, sizeof *r) : NULL;
+    if (r == NULL) {
+        refused = 1;
+        return NULL;
+    }
+    r->tid = (uint32_t)syscall(SYS_gettid);
+    atomic_store_explicit(&rings[slot], r, memory_order_release);
+    trace_tls = r;
+    return r;
+}
+
+/* gcc -finstrument-functions calls these around every function body */
+TRACE_NOINSTR void __cyg_profile_func_enter(void *fn, void *call_site) {
+    (void)call_site;
+    trace_emit(TRACE_BEGIN_FN, fn);
+}
+
+TRACE_NOINSTR void __cyg_profile_func_exit(void *fn, void *call_site) {
+    (void)call_site;
+    trace_emit(TRACE_END_FN, fn);
+}
+
+static TRACE_NOINSTR double ns_per_tick(void) {
+#if defined(__x86_64__) || defined(__i386__) || defined(__aarch64__)
+    uint64_t t = trace_ticks(), n = mono_ns();
+    return t > tick0 ? (double)(n - ns0) / (double)(t - tick0) : 1.0;
+#else
+    return 1.0;                          /* trace_ticks() already is ns */
+#endif
+}
+
+TRACE_NOINSTR trace_stats trace_get_stats(void) {
+    trace_stats s = { 0 };
+    unsigned n = atomic_load(&ring_count);
+    for (unsigned i = 0; i < n && i < TRACE_MAX_THREADS; i++) {
+        trace_ring *r = atomic_load_explicit(&rings[i], memory_order_acquire);
+        if (r == NULL)
+            continue;
+        uint64_t h = atomic_load_explicit(&r->head, memory_order_acquire);
+        s.threads++;
+        s.events += h;
+        s.dropped += h > TRACE_RING ? h - TRACE_RING : 0;
+    }
+    s.ns_per_tick = ns_per_tick();
+    return s;
+}
+
+/* JSON string body: names are C identifiers or literals, but be safe */
+static TRACE_NOINSTR void put_json_str(FILE *f, const char *s) {
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\')
+            fprintf(f, "\\%c", c);
+        else if (c < 0x20)
+            fprintf(f, "\\u%04x", c);
+        else
+            fputc(c, f);
+    }
+}
+
+static TRACE_NOINSTR void put_name(FILE *f, unsigned kind, const void *what) {
+    if (kind == TRACE_BEGIN) {
+        put_json_str(f, what);
+        return;
+    }
+    Dl_info info;
+    if (dladdr(what, &info) && info.dli_sname)
+        put_json_str(f, info.dli_sname);
+    else
+        fprintf(f, "%p", what);
+}
+
+/*
+ * One ring as B/E events. A wrapped ring starts mid-stack: ends whose
+ * begin was overwritten are skipped, and scopes still open at the end are
+ * closed at the ring's last timestamp so the viewer draws them.
+ */
+static TRACE_NOINSTR void write_ring(FILE *f, const trace_ring *r,
+                                     double scale, int *first) {
+    uint64_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+    uint64_t start = head > TRACE_RING ? head - TRACE_RING : 0;
+    long depth = 0;
+    double last_us = 0;
+
+    fprintf(f, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+               "\"args\":{\"name\":\"tid %u\"}}",
+            *first ? "" : ",", r->tid, r->tid);
+    *first = 0;
+
+    for (uint64_t i = start; i < head; i++) {
+        const trace_rec *e = &r->rec[i & (TRACE_RING - 1)];
+        unsigned kind = (unsigned)(e->stamp & 3);
+        uint64_t t = e->stamp >> 2;
+        double us = t > tick0 ? (double)(t - tick0) * scale / 1000.0 : 0;
+        int begin = kind == TRACE_BEGIN || kind == TRACE_BEGIN_FN;
+
+        last_us = us;
+        if (!begin && depth == 0)
+            continue;
+        depth += begin ? 1 : -1;
+        fprintf(f, ",\n{\"ph\":\"%c\",\"pid\":1,\"tid\":%u,\"ts\":%.3f",
+                begin ? 'B' : 'E', r->tid, us);
+        if (begin) {
+            fputs(",\"name\":\"", f);
+            put_name(f, kind, e->what);
+            fputc('"', f);
+        }
+        fputc('}', f);
+    }
+    for (; depth > 0; depth--)
+        fprintf(f, ",\n{\"ph\":\"E\",\"pid\":1,\"tid\":%u,\"ts\":%.3f}",
+                r->tid, last_us);
+}
+
+TRACE_NOINSTR int trace_write_chrome(const char *path) {
+    FILE *f = fopen(path, "w");
+    if (f == NULL)
+        return -1;
+
+    double scale = ns_per_tick();
+    int first = 1;
+    unsigned n = atomic_load(&ring_count);
+
+    fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", f);
+    for (unsigned i = 0; i < n && i < TRACE_MAX_THREADS; i++) {
+        trace_ring *r = atomic_load_explicit(&rings[i], memory_order_acquire);
+        if (r != NULL)
+            write_ring(f, r, scale, &first);
+    }
+    fputs("\n]}\n", f);
+
+    if (ferror(f)) {
+        int e = errno;
+        fclose(f);
+        errno = e ? e : EIO;
+        return -1;
+    }
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+static TRACE_NOINSTR void dump_at_exit(void) {
+    const char *out = getenv("TRACE_OUT");
+    trace_stats s = trace_get_stats();
+    if (trace_write_chrome(out) != 0) {
+        perror(out);
+        return;
+    }
+    fprintf(stderr, "trace: %zu events (%zu overwritten), %zu threads -> %s\n",
+            s.events, s.dropped, s.threads, out);
+}
+
+__attribute__((constructor)) static TRACE_NOINSTR void trace_init(void) {
+    tick0 = trace_ticks();
+    ns0 = mono_ns();
+    if (getenv("TRACE_OUT"))
+        atexit(dump_at_exit);
+}
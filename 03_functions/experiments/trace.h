@@ -0,0 +1,130 @@
+/* trace.h — function entry/exit tracing into per-thread ring buffers.
+ *
+ * Where sprof (note 10) samples, this records *every* begin and end:
+ *
+ *   TRACE_SCOPE("step_add");          explicit: begin now, end when the
+ *                                     enclosing block exits (cleanup attr)
+ *   gcc -finstrument-functions ...    automatic: every function compiled
+ *                                     with the flag calls the hooks in
+ *                                     trace.c on entry and exit
+ *
+ * An event is one 16-byte record { ticks << 2 | kind, name-or-address }
+ * stored into the calling thread's ring: no locks, no atomics other than
+ * a release store of the ring's own head, one timestamp read (rdtsc /
+ * cntvct_el0 / clock_gettime). When a ring is full the oldest events are
+ * overwritten, so it always holds the most recent TRACE_RING events.
+ *
+ * trace_write_chrome() converts all rings to Chrome trace JSON, which
+ * chrome://tracing, Perfetto (ui.perfetto.dev) and speedscope open. With
+ * TRACE_OUT=path in the environment that happens automatically at exit.
+ *
+ * Link trace.c; build with -rdynamic so instrumented functions get names.
+ * -DTRACE_DISABLE turns every macro into nothing.
+ */
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>      /* __rdtsc */
+#endif
+
+/* Everything here runs inside the hooks, so none of it may be hooked. */
+#define TRACE_NOINSTR __attribute__((no_instrument_function))
+
+#ifndef TRACE_RING_LOG2
+#define TRACE_RING_LOG2 16               /* 64K events = 1 MB per thread */
+#endif
+#define TRACE_RING (1u << TRACE_RING_LOG2)
+#define TRACE_MAX_THREADS 256
+
+enum {
+    TRACE_BEGIN,        /* what = const char *name */
+    TRACE_END,
+    TRACE_BEGIN_FN,     /* what = function address (-finstrument-functions) */
+    TRACE_END_FN,
+};
+
+typedef struct {
+    uint64_t    stamp;                   /* ticks << 2 | kind */
+    const void *what;
+} trace_rec;
+
+typedef struct {
+    _Atomic uint64_t head;               /* events written since the start */
+    uint32_t         tid;
+    trace_rec        rec[TRACE_RING];
+} trace_ring;
+
+extern __thread trace_ring *trace_tls;
+trace_ring *trace_ring_new(void);        /* first event on a thread */
+
+static inline TRACE_NOINSTR uint64_t trace_ticks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t v;
+    __asm__ volatile("mrs %0, cntvct_el0" : "=r"(v));
+    return v;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+/* the ring write alone, with a timestamp read by the caller */
+static inline TRACE_NOINSTR void trace_emit_at(uint64_t ticks, unsigned kind,
+                                               const void *what) {
+    trace_ring *r = trace_tls;
+    if (__builtin_expect(r == NULL, 0) && (r = trace_ring_new()) == NULL)
+        return;
+    uint64_t h = atomic_load_explicit(&r->head, memory_order_relaxed);
+    trace_rec *e = &r->rec[h & (TRACE_RING - 1)];
+    e->stamp = ticks << 2 | kind;
+    e->what = what;
+    atomic_store_explicit(&r->head, h + 1, memory_order_release);
+}
+
+static inline TRACE_NOINSTR void trace_emit(unsigned kind, const void *what) {
+    trace_emit_at(trace_ticks(), kind, what);
+}
+
+static inline TRACE_NOINSTR void trace_scope_end_(const char *const *name) {
+    (void)name;
+    trace_emit(TRACE_END, NULL);
+}
+
+#define TRACE_CAT2_(a, b) a##b
+#define TRACE_CAT_(a, b)  TRACE_CAT2_(a, b)
+
+#ifdef TRACE_DISABLE
+#define TRACE_BEGIN_NAME(name) ((void)0)
+#define TRACE_END_NAME()       ((void)0)
+#define TRACE_SCOPE(name)      ((void)0)
+#else
+#define TRACE_BEGIN_NAME(name) trace_emit(TRACE_BEGIN, (name))
+#define TRACE_END_NAME()       trace_emit(TRACE_END, NULL)
+/* name must be a string that outlives the trace (a literal, usually) */
+#define TRACE_SCOPE(name)                                               \
+    __attribute__((cleanup(trace_scope_end_))) const char *const        \
+        TRACE_CAT_(trace_scope_, __LINE__) = (TRACE_BEGIN_NAME(name), (name))
+#endif
+
+typedef struct {
+    size_t threads;
+    size_t events;                       /* written */
+    size_t dropped;                      /* overwritten before the dump */
+    double ns_per_tick;
+} trace_stats;
+
+/* Writes every ring as Chrome trace JSON. Returns 0, or -1 with errno
+ * set. Meant for when the traced threads are quiet (joined, or at exit). */
+int trace_write_chrome(const char *path);
+
+trace_stats trace_get_stats(void);
+
+#endif /* TRACE_H */
@@ -0,0 +1,288 @@
+/*
+ * trace_demo.c — note 08's compute() and note 09's runWorkflow(), traced
+ * with trace.h on three threads, plus the per-event overhead.
+ *
+ *   main, 2 workers ─► runWorkflow ─► step_add ─► compute ─► add
+ *                                  └► step_sub ─► compute ─► sub
+ *                                  └► step_mix ─► compute ─► add / sub
+ *
+ * Two ways to get the events:
+ *
+ *   explicit   TRACE_SCOPE(__func__) at the top of each function
+ *     gcc -O2 -pthread -rdynamic trace_demo.c trace.c -o trace_demo
+ *
+ *   automatic  no macros; the compiler inserts the hooks
+ *     gcc -O2 -pthread -rdynamic -finstrument-functions -DTRACE_AUTO \
+ *         trace_demo.c trace.c -o trace_demo_auto
+ *
+ *   ./trace_demo [out.json [rounds]]     open out.json in ui.perfetto.dev
+ *   ./trace_demo bench [events]          ns per event
+ *   TRACE_OUT=x.json ./trace_demo       any program linked with trace.c
+ *
+ * With -DHDR_ENABLE, runWorkflow also times each step into an HDR
+ * histogram (hdr.h) and main prints p50 / p99 / p99.9 / max per step:
+ *     gcc -O2 -pthread -rdynamic -DHDR_ENABLE trace_demo.c trace.c -o trace_demo_hdr
+ */
+#include "hdr.h"
+#include "trace.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NOINLINE __attribute__((noipa))
+
+#if defined(TRACE_AUTO) || defined(TRACE_DISABLE)
+#define SCOPE() ((void)0)
+#else
+#define SCOPE() TRACE_SCOPE(__func__)
+#endif
+
+/* ---- note 08: a function that runs whatever it is handed ---- */
+
+typedef int (*fptrOperation)(int, int);
+
+NOINLINE int add(int num1, int num2) { SCOPE(); return num1 + num2; }
+NOINLINE int sub(int num1, int num2) { SCOPE(); return num1 - num2; }
+
+NOINLINE int compute(fptrOperation operation, int num2, int num3) {
+    SCOPE();
+    return operation(num2, num3);
+}
+
+/* ---- note 09: a workflow is an array of steps ---- */
+
+typedef void (*WorkflowStep)(void *context);
+
+typedef struct {
+    const char  *name;
+    WorkflowStep steps[4];
+} sWorkflow;
+
+typedef struct {
+    int num2, num3;
+    int result;
+    int work;                         /* loop length: how long a step takes */
+} sContext;
+
+NOINLINE void step_add(void *ctx) {
+    SCOPE();
+    sContext *c = ctx;
+    for (int i = 0; i < c->work; i++)
+        c->result = compute(add, c->result, c->num2);
+}
+
+NOINLINE void step_sub(void *ctx) {
+    SCOPE();
+    sContext *c = ctx;
+    for (int i = 0; i < c->work; i++)
+        c->result = compute(sub, c->result, c->num3);
+}
+
+NOINLINE void step_mix(void *ctx) {
+    SCOPE();
+    sContext *c = ctx;
+    for (int i = 0; i < c->work; i++)
+        c->result = compute(i & 1 ? add : sub, c->result, i);
+}
+
+static hdr_hist step_lat[4] = { HDR_HIST("steps[0]"), HDR_HIST("steps[1]"),
+                                HDR_HIST("steps[2]"), HDR_HIST("steps[3]") };
+
+NOINLINE void runWorkflow(sWorkflow *wf, void *ctx) {
+    SCOPE();
+    for (int i = 0; wf->steps[i]; i++)
+        HDR_TIME(&step_lat[i], wf->steps[i](ctx));
+}
+
+static sWorkflow calc = { "Calculator", { step_add, step_sub, step_mix, NULL } };
+
+typedef struct {
+    int rounds, work;
+    int result;
+} job;
+
+NOINLINE void *worker(void *arg) {
+    job *j = arg;
+    sContext ctx = { 10, 4, 0, j->work };
+    for (int r = 0; r < j->rounds; r++)
+        runWorkflow(&calc, &ctx);
+    j->result = ctx.result;
+    return NULL;
+}
+
+/* ---- self-test: what one workflow leaves in this thread's ring ---- */
+
+TRACE_NOINSTR static int is_fn(const trace_rec *e, const char *name,
+                               const void *fn) {
+    unsigned kind = (unsigned)(e->stamp & 3);
+    if (kind == TRACE_BEGIN)
+        return strcmp(e->what, name) == 0;
+    return kind == TRACE_BEGIN_FN && e->what == fn;
+}
+
+/* not hooked itself, so with -finstrument-functions the ring starts at
+ * runWorkflow just like with TRACE_SCOPE */
+TRACE_NOINSTR static void *self_test(void *arg) {
+    (void)arg;
+    sContext ctx = { 10, 4, 0, 3 };
+    runWorkflow(&calc, &ctx);         /* first events on a fresh thread */
+
+    trace_ring *r = trace_tls;
+#ifdef TRACE_DISABLE
+    if (r != NULL) {
+        fprintf(stderr, "self-test: events with TRACE_DISABLE\n");
+        exit(1);
+    }
+    return NULL;
+#endif
+    /* 1 + 3 steps + 9 computes + 9 add/sub = 22 scopes, 44 events */
+    uint64_t n = r ? atomic_load(&r->head) : 0;
+    if (n != 44) {
+        fprintf(stderr, "self-test: %llu events, want 44\n", (unsigned long long)n);
+        exit(1);
+    }
+    long depth = 0;
+    uint64_t prev = 0;
+    for (uint64_t i = 0; i < n; i++) {
+        const trace_rec *e = &r->rec[i];
+        unsigned kind = (unsigned)(e->stamp & 3);
+        depth += kind == TRACE_BEGIN || kind == TRACE_BEGIN_FN ? 1 : -1;
+        if (depth < 0 || e->stamp >> 2 < prev) {
+            fprintf(stderr, "self-test: event %llu unbalanced or out of order\n",
+                    (unsigned long long)i);
+            exit(1);
+        }
+        prev = e->stamp >> 2;
+    }
+    if (depth != 0 || !is_fn(&r->rec[0], "runWorkflow", __extension__ (const void *)runWorkflow)
+        || !is_fn(&r->rec[1], "step_add", __extension__ (const void *)step_add)) {
+        fprintf(stderr, "self-test: wrong nesting\n");
+        exit(1);
+    }
+    return NULL;
+}
+
+/* ---- overhead ---- */
+
+TRACE_NOINSTR static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+NOINLINE TRACE_NOINSTR static void empty_loop(long n) {
+    for (long i = 0; i < n; i++)
+        __asm__ volatile("" ::: "memory");
+}
+
+NOINLINE TRACE_NOINSTR static void scope_loop(long n) {
+    for (long i = 0; i < n; i++) {
+        TRACE_SCOPE("x");
+        __asm__ volatile("" ::: "memory");
+    }
+}
+
+void __cyg_profile_func_enter(void *fn, void *call_site);
+void __cyg_profile_func_exit(void *fn, void *call_site);
+
+NOINLINE TRACE_NOINSTR static void hook_loop(long n) {
+    for (long i = 0; i < n; i++) {
+        __cyg_profile_func_enter(__extension__ (void *)hook_loop, NULL);
+        __asm__ volatile("" ::: "memory");
+        __cyg_profile_func_exit(__extension__ (void *)hook_loop, NULL);
+    }
+}
+
+/* TRACE_SCOPE's two writes with one timestamp read before the loop */
+NOINLINE TRACE_NOINSTR static void ring_loop(long n) {
+    uint64_t t = trace_ticks();
+    for (long i = 0; i < n; i++) {
+        trace_emit_at(t, TRACE_BEGIN, "x");
+        __asm__ volatile("" ::: "memory");
+        trace_emit_at(t, TRACE_END, NULL);
+    }
+}
+
+NOINLINE TRACE_NOINSTR static void ticks_loop(long n) {
+    uint64_t s = 0;
+    for (long i = 0; i < n; i++)
+        s += trace_ticks();
+    __asm__ volatile("" :: "r"(s));
+}
+
+TRACE_NOINSTR static double best_of(void (*fn)(long), long n, int reps) {
+    double best = 1e30;
+    for (int r = 0; r < reps; r++) {
+        double t = now_sec();
+        fn(n);
+        t = now_sec() - t;
+        if (t < best)
+            best = t;
+    }
+    return best;
+}
+
+static void bench(long events) {
+    long n = events / 2;              /* one scope = begin + end */
+    double base = best_of(empty_loop, n, 9);
+    double scope = best_of(scope_loop, n, 9);
+    double hook = best_of(hook_loop, n, 9);
+    double tick = best_of(ticks_loop, n, 9);
+    double ring = best_of(ring_loop, n, 9);
+
+    printf("%ld events, ring %u, best of 9\n", 2 * n, TRACE_RING);
+    printf("  timestamp read        %6.2f ns\n", tick / (double)n * 1e9);
+    printf("  TRACE_SCOPE           %6.2f ns/event\n", (scope - base) / (double)(2 * n) * 1e9);
+    printf("  -finstrument hooks    %6.2f ns/event\n", (hook - base) / (double)(2 * n) * 1e9);
+    printf("  ring write only       %6.2f ns/event  (timestamp read once, outside the loop)\n",
+           (ring - base) / (double)(2 * n) * 1e9);
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+        bench(argc > 2 ? atol(argv[2]) : 20000000);
+        return 0;
+    }
+    const char *out = argc > 1 ? argv[1] : NULL;     /* or TRACE_OUT */
+    int rounds = argc > 2 ? atoi(argv[2]) : 4;
+
+    pthread_t t;
+    pthread_create(&t, NULL, self_test, NULL);
+    pthread_join(t, NULL);
+    puts("self-test: ok");
+
+    job jobs[3] = { { rounds, 200, 0 }, { rounds, 500, 0 }, { rounds, 1000, 0 } };
+    pthread_t th[2];
+    double t0 = now_sec();
+    for (int i = 0; i < 2; i++)
+        pthread_create(&th[i], NULL, worker, &jobs[i + 1]);
+    worker(&jobs[0]);
+    for (int i = 0; i < 2; i++)
+        pthread_join(th[i], NULL);
+    double el = now_sec() - t0;
+
+    trace_stats s = trace_get_stats();
+    printf("results %d %d %d in %.2f ms\n", jobs[0].result, jobs[1].result,
+           jobs[2].result, el * 1e3);
+    printf("%zu events (%zu overwritten), %zu threads, %.4f ns/tick\n",
+           s.events, s.dropped, s.threads, s.ns_per_tick);
+#ifdef HDR_ENABLE
+    static hdr_counts c;
+    printf("\n%s steps, all threads\n", calc.name);
+    hdr_print_header(stdout);
+    for (int i = 0; calc.steps[i]; i++) {
+        hdr_merge(&step_lat[i], &c);
+        hdr_print(stdout, step_lat[i].name, &c, hdr_ns_per_tick());
+    }
+#endif
+    if (out == NULL)
+        return 0;
+    if (trace_write_chrome(out) != 0) {
+        perror(out);
+        return 1;
+    }
+    printf("wrote %s\n", out);
+    return 0;
+}
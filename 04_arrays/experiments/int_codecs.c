@@ -0,0 +1,337 @@
+/*
+ * int_codecs.c — delta + zigzag + SIMD bit-packing for int arrays.
+ *
+ * The `int *pv` from 04_arrays/notes/array.c, scaled up to millions of
+ * mostly-small steps, compresses to a few bits per value. Layout follows
+ * SIMD-BP128: blocks of 128 ints seen as 32 rows of 4 lanes, deltas taken
+ * between rows (x[i] - x[i-4]) so both packing and the prefix sum on decode
+ * are plain 4-lane vector ops.
+ *
+ * Each block is independent (own base value and bit width), giving
+ * block-level random access. Decoding writes straight into caller memory.
+ *
+ * SIMD: SSE2 on x86-64, NEON on arm64, portable scalar lanes otherwise.
+ *
+ *   ./int_codecs            # 10M values
+ *   ./int_codecs 100000000  # 100M values
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+typedef __m128i v4;
+static inline v4 v_load(const uint32_t *p) { return _mm_loadu_si128((const __m128i *)p); }
+static inline void v_store(uint32_t *p, v4 v) { _mm_storeu_si128((__m128i *)p, v); }
+static inline v4 v_splat(uint32_t x) { return _mm_set1_epi32((int)x); }
+static inline v4 v_add(v4 a, v4 b) { return _mm_add_epi32(a, b); }
+static inline v4 v_sub(v4 a, v4 b) { return _mm_sub_epi32(a, b); }
+static inline v4 v_and(v4 a, v4 b) { return _mm_and_si128(a, b); }
+static inline v4 v_or(v4 a, v4 b) { return _mm_or_si128(a, b); }
+static inline v4 v_xor(v4 a, v4 b) { return _mm_xor_si128(a, b); }
+static inline v4 v_shl(v4 a, unsigned n) { return _mm_sll_epi32(a, _mm_cvtsi32_si128((int)n)); }
+static inline v4 v_shr(v4 a, unsigned n) { return _mm_srl_epi32(a, _mm_cvtsi32_si128((int)n)); }
+static inline v4 v_sar31(v4 a) { return _mm_srai_epi32(a, 31); }
+static inline uint32_t v_or_lanes(v4 a) {
+    a = _mm_or_si128(a, _mm_srli_si128(a, 8));
+    a = _mm_or_si128(a, _mm_srli_si128(a, 4));
+    return (uint32_t)_mm_cvtsi128_si32(a);
+}
+#define IC_SIMD "SSE2"
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+typedef uint32x4_t v4;
+static inline v4 v_load(const uint32_t *p) { return vld1q_u32(p); }
+static inline void v_store(uint32_t *p, v4 v) { vst1q_u32(p, v); }
+static inline v4 v_splat(uint32_t x) { return vdupq_n_u32(x); }
+static inline v4 v_add(v4 a, v4 b) { return vaddq_u32(a, b); }
+static inline v4 v_sub(v4 a, v4 b) { return vsubq_u32(a, b); }
+static inline v4 v_and(v4 a, v4 b) { return vandq_u32(a, b); }
+static inline v4 v_or(v4 a, v4 b) { return vorrq_u32(a, b); }
+static inline v4 v_xor(v4 a, v4 b) { return veorq_u32(a, b); }
+static inline v4 v_shl(v4 a, unsigned n) { return vshlq_u32(a, vdupq_n_s32((int)n)); }
+static inline v4 v_shr(v4 a, unsigned n) { return vshlq_u32(a, vdupq_n_s32(-(int)n)); }
+static inline v4 v_sar31(v4 a) { return vreinterpretq_u32_s32(vshrq_n_s32(vreinterpretq_s32_u32(a), 31)); }
+static inline uint32_t v_or_lanes(v4 a) {
+    return vgetq_lane_u32(a, 0) | vgetq_lane_u32(a, 1) |
+           vgetq_lane_u32(a, 2) | vgetq_lane_u32(a, 3);
+}
+#define IC_SIMD "NEON"
+#else
+typedef struct { uint32_t l[4]; } v4;
+#define V4_MAP(expr) do { for (int k = 0; k < 4; k++) r.l[k] = (expr); } while (0)
+static inline v4 v_load(const uint32_t *p) { v4 r; memcpy(r.l, p, 16); return r; }
+static inline void v_store(uint32_t *p, v4 v) { memcpy(p, v.l, 16); }
+static inline v4 v_splat(uint32_t x) { v4 r; V4_MAP(x); return r; }
+static inline v4 v_add(v4 a, v4 b) { v4 r; V4_MAP(a.l[k] + b.l[k]); return r; }
+static inline v4 v_sub(v4 a, v4 b) { v4 r; V4_MAP(a.l[k] - b.l[k]); return r; }
+static inline v4 v_and(v4 a, v4 b) { v4 r; V4_MAP(a.l[k] & b.l[k]); return r; }
+static inline v4 v_or(v4 a, v4 b) { v4 r; V4_MAP(a.l[k] | b.l[k]); return r; }
+static inline v4 v_xor(v4 a, v4 b) { v4 r; V4_MAP(a.l[k] ^ b.l[k]); return r; }
+static inline v4 v_shl(v4 a, unsigned n) { v4 r; V4_MAP(n < 32 ? a.l[k] << n : 0); return r; }
+static inline v4 v_shr(v4 a, unsigned n) { v4 r; V4_MAP(n < 32 ? a.l[k] >> n : 0); return r; }
+static inline v4 v_sar31(v4 a) { v4 r; V4_MAP((a.l[k] >> 31) ? 0xFFFFFFFFu : 0); return r; }
+static inline uint32_t v_or_lanes(v4 a) { return a.l[0] | a.l[1] | a.l[2] | a.l[3]; }
+#define IC_SIMD "scalar"
+#endif
+
+#define IC_BLOCK 128u            /* values per block */
+#define IC_ROWS  (IC_BLOCK / 4)  /* 4-lane rows per block */
+
+typedef struct {
+    uint32_t base;               /* x[0..3] of the block are deltas from this */
+    uint32_t offset;             /* first packed word of the block */
+    uint32_t bits;               /* bit width of every zigzag delta */
+} ic_block;
+
+typedef struct {
+    size_t    n;                 /* logical count */
+    size_t    nblocks;
+    ic_block *dir;               /* one entry per block */
+    uint32_t *data;              /* packed words */
+    size_t    words;
+} ic_encoded;
+
+/* zigzag: small negative deltas become small unsigned numbers */
+static inline v4 zz_enc(v4 d) { return v_xor(v_shl(d, 1), v_sar31(d)); }
+static inline v4 zz_dec(v4 z) {
+    return v_xor(v_shr(z, 1), v_sub(v_splat(0), v_and(z, v_splat(1))));
+}
+
+static unsigned bits_needed(uint32_t x) {
+    unsigned b = 0;
+    while (x) {
+        b++;
+        x >>= 1;
+    }
+    return b;
+}
+
+/* Pack 32 rows of `bits`-wide values: each lane becomes `bits` words. */
+static void pack_rows(const v4 *z, unsigned bits, uint32_t *out) {
+    if (bits == 0)
+        return;
+    v4 acc = v_splat(0);
+    unsigned shift = 0;
+    for (unsigned r = 0; r < IC_ROWS; r++) {
+        acc = v_or(acc, v_shl(z[r], shift));
+        shift += bits;
+        if (shift >= 32) {
+            v_store(out, acc);
+            out += 4;
+            shift -= 32;
+            acc = shift ? v_shr(z[r], bits - shift) : v_splat(0);
+        }
+    }
+}
+
+/* Encode one block: row deltas, zigzag, pack. Returns words written. */
+static size_t encode_block(const uint32_t *x, uint32_t *out, ic_block *blk) {
+    v4 z[IC_ROWS];
+    v4 prev = v_splat(x[0]);
+    v4 any = v_splat(0);
+    for (unsigned r = 0; r < IC_ROWS; r++) {
+        v4 v = v_load(x + 4 * r);
+        z[r] = zz_enc(v_sub(v, prev));
+        any = v_or(any, z[r]);
+        prev = v;
+    }
+    blk->base = x[0];
+    blk->bits = bits_needed(v_or_lanes(any));
+    pack_rows(z, blk->bits, out);
+    return 4 * blk->bits;
+}
+
+/* Unpack the first `rows` rows of a block and undo zigzag + row deltas.
+ * Always inlined so every constant `bits` below gets its own unrolled copy
+ * with immediate shifts. */
+static inline __attribute__((always_inline))
+void unpack_rows(const uint32_t *in, unsigned bits, uint32_t base,
+                 uint32_t *o, unsigned rows) {
+    v4 prev = v_splat(base);
+    if (bits == 0) {
+        for (unsigned r = 0; r < rows; r++)
+            v_store(o + 4 * r, prev);
+        return;
+    }
+    v4 mask = v_splat(bits == 32 ? 0xFFFFFFFFu : (1u << bits) - 1);
+    v4 w = v_load(in);
+    unsigned shift = 0;
+#pragma GCC unroll 32
+    for (unsigned r = 0; r < rows; r++) {
+        v4 v = v_shr(w, shift);
+        shift += bits;
+        if (shift >= 32) {
+            shift -= 32;
+            in += 4;
+            if (shift || r + 1 < rows)
+                w = v_load(in);
+            if (shift)
+                v = v_or(v, v_shl(w, bits - shift));
+        }
+        prev = v_add(prev, zz_dec(v_and(v, mask)));
+        v_store(o + 4 * r, prev);
+    }
+}
+
+typedef void (*unpack_fn)(const uint32_t *, uint32_t, uint32_t *);
+
+#define IC_UNPACK(B)                                                     \
+    static void unpack_##B(const uint32_t *in, uint32_t base, uint32_t *o) { \
+        unpack_rows(in, B, base, o, IC_ROWS);                            \
+    }
+IC_UNPACK(0)  IC_UNPACK(1)  IC_UNPACK(2)  IC_UNPACK(3)  IC_UNPACK(4)
+IC_UNPACK(5)  IC_UNPACK(6)  IC_UNPACK(7)  IC_UNPACK(8)  IC_UNPACK(9)
+IC_UNPACK(10) IC_UNPACK(11) IC_UNPACK(12) IC_UNPACK(13) IC_UNPACK(14)
+IC_UNPACK(15) IC_UNPACK(16) IC_UNPACK(17) IC_UNPACK(18) IC_UNPACK(19)
+IC_UNPACK(20) IC_UNPACK(21) IC_UNPACK(22) IC_UNPACK(23) IC_UNPACK(24)
+IC_UNPACK(25) IC_UNPACK(26) IC_UNPACK(27) IC_UNPACK(28) IC_UNPACK(29)
+IC_UNPACK(30) IC_UNPACK(31) IC_UNPACK(32)
+
+static const unpack_fn unpack_table[33] = {
+    unpack_0,  unpack_1,  unpack_2,  unpack_3,  unpack_4,  unpack_5,
+    unpack_6,  unpack_7,  unpack_8,  unpack_9,  unpack_10, unpack_11,
+    unpack_12, unpack_13, unpack_14, unpack_15, unpack_16, unpack_17,
+    unpack_18, unpack_19, unpack_20, unpack_21, unpack_22, unpack_23,
+    unpack_24, unpack_25, unpack_26, unpack_27, unpack_28, unpack_29,
+    unpack_30, unpack_31, unpack_32,
+};
+
+/* Decode one block of 128 values into `out` (caller memory). */
+static void ic_decode_block(const ic_encoded *e, size_t b, int32_t *out) {
+    const ic_block *blk = &e->dir[b];
+    unpack_table[blk->bits](e->data + blk->offset, blk->base, (uint32_t *)out);
+}
+
+static int ic_encode(const int32_t *in, size_t n, ic_encoded *e) {
+    e->n = n;
+    e->nblocks = (n + IC_BLOCK - 1) / IC_BLOCK;
+    e->dir = malloc(e->nblocks * sizeof *e->dir);
+    e->data = malloc(e->nblocks * IC_BLOCK * sizeof(uint32_t));  /* worst case */
+    if (!e->dir || !e->data) {
+        free(e->dir);
+        free(e->data);
+        return -1;
+    }
+    size_t w = 0;
+    for (size_t b = 0; b < e->nblocks; b++) {
+        const uint32_t *src = (const uint32_t *)in + b * IC_BLOCK;
+        uint32_t tail[IC_BLOCK];
+        size_t left = n - b * IC_BLOCK;
+        if (left < IC_BLOCK) {           /* pad by repeating the last value */
+            memcpy(tail, src, left * sizeof *tail);
+            for (size_t i = left; i < IC_BLOCK; i++)
+                tail[i] = tail[left - 1];
+            src = tail;
+        }
+        e->dir[b].offset = (uint32_t)w;
+        w += encode_block(src, e->data + w, &e->dir[b]);
+    }
+    e->words = w;
+    return 0;
+}
+
+/* Decode everything into `out`, which must hold e->n ints. */
+static void ic_decode(const ic_encoded *e, int32_t *out) {
+    size_t full = e->n / IC_BLOCK;
+    for (size_t b = 0; b < full; b++)
+        ic_decode_block(e, b, out + b * IC_BLOCK);
+    if (full < e->nblocks) {
+        int32_t tmp[IC_BLOCK];
+        ic_decode_block(e, full, tmp);
+        memcpy(out + full * IC_BLOCK, tmp, (e->n - full * IC_BLOCK) * sizeof *tmp);
+    }
+}
+
+/* Random access: decode only the rows of one block up to element i. */
+static int32_t ic_get(const ic_encoded *e, size_t i) {
+    uint32_t tmp[IC_BLOCK];
+    const ic_block *blk = &e->dir[i / IC_BLOCK];
+    unsigned row = (unsigned)(i % IC_BLOCK) / 4;
+    unpack_rows(e->data + blk->offset, blk->bits, blk->base, tmp, row + 1);
+    return (int32_t)tmp[i % IC_BLOCK];
+}
+
+static size_t ic_bytes(const ic_encoded *e) {
+    return e->nblocks * sizeof(ic_block) + e->words * sizeof(uint32_t);
+}
+
+static void ic_free(ic_encoded *e) {
+    free(e->dir);
+    free(e->data);
+    e->dir = NULL;
+    e->data = NULL;
+}
+
+/* ---------- benchmark ---------- */
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char **argv) {
+    size_t n = argc > 1 ? strtoull(argv[1], NULL, 10) : 10000000;
+    if (n == 0) {
+        fprintf(stderr, "%s: need at least one value\n", argv[0]);
+        return 1;
+    }
+    int32_t *pv = malloc(n * sizeof(int32_t));
+    int32_t *back = malloc(n * sizeof(int32_t));
+    if (!pv || !back)
+        return 1;
+
+    /* mostly small steps up and down, with a rare large jump */
+    srand(42);
+    int32_t x = 1000;
+    for (size_t i = 0; i < n; i++) {
+        x += (rand() % 33) - 16;
+        if (rand() % 1000 == 0)
+            x += rand() % 100000;
+        *(pv + i) = x;
+    }
+
+    ic_encoded e;
+    double t0 = now_sec();
+    if (ic_encode(pv, n, &e) != 0)
+        return 1;
+    double t_enc = now_sec() - t0;
+
+    memset(back, 0, n * sizeof *back);       /* keep page faults out of the timing */
+    t0 = now_sec();
+    ic_decode(&e, back);
+    double t_dec = now_sec() - t0;
+
+    if (memcmp(pv, back, n * sizeof *pv) != 0) {
+        fprintf(stderr, "round trip FAILED\n");
+        return 1;
+    }
+
+    size_t probes = 1000000;
+    int64_t sum = 0;
+    t0 = now_sec();
+    for (size_t k = 0; k < probes; k++) {
+        size_t i = (k * 2654435761u) % n;
+        sum += ic_get(&e, i) - pv[i];
+    }
+    double t_get = now_sec() - t0;
+
+    double raw = (double)n * sizeof(int32_t);
+    printf("SIMD path       : %s\n", IC_SIMD);
+    printf("values          : %zu (%.1f MB raw)\n", n, raw / 1e6);
+    printf("compressed      : %.1f MB (ratio %.2fx, %.2f bits/value)\n",
+           ic_bytes(&e) / 1e6, raw / ic_bytes(&e), 8.0 * ic_bytes(&e) / n);
+    printf("encode          : %.2f GB/s\n", raw / t_enc / 1e9);
+    printf("decode          : %.2f GB/s\n", raw / t_dec / 1e9);
+    printf("random get      : %.1f ns (check %lld)\n", t_get / probes * 1e9,
+           (long long)sum);
+
+    ic_free(&e);
+    free(pv);
+    free(back);
+    return 0;
+}
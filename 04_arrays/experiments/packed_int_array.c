@@ -0,0 +1,348 @@
+/*
+ * packed_int_array.c — integer array with a runtime bit width (1..64).
+ *
+ * The arrays chapter stores everything as `int`, 4 bytes each, even when
+ * the values fit in 5..12 bits. A packed array keeps element i at bit
+ * i * width of one byte buffer:
+ *
+ *   - get/set are O(1): one unaligned 64-bit load (memcpy) + shift + mask,
+ *     split in two halves only for widths above 56 bits;
+ *   - bulk ops (unpack, sum, count-less-than) work on groups of 8 values,
+ *     which always start on a byte boundary, using per-width unrolled
+ *     kernels so the compiler sees constant shifts and vectorizes; sum and
+ *     count are fused into the unpack loop (no intermediate buffer);
+ *   - pa_from_ints() stores value - min (frame of reference), so negative
+ *     ints pack too.
+ *
+ *   ./packed_int_array            # 10M values, widths 5/12/20
+ *   ./packed_int_array 100000000
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "packed_int_array assumes a little-endian target"
+#endif
+
+#define PA_CHUNK 256u            /* values unpacked per bulk step (32 groups) */
+
+typedef struct {
+    uint8_t *bytes;              /* n * width bits + 8 bytes of slack */
+    size_t   n;
+    unsigned width;              /* bits per element, 1..64 */
+    int64_t  base;               /* added back on every read */
+} packed_array;
+
+static inline uint64_t pa_mask(unsigned w) {
+    return w == 64 ? ~0ULL : (1ULL << w) - 1;
+}
+
+static inline uint64_t load64(const uint8_t *p) {
+    uint64_t x;
+    memcpy(&x, p, sizeof x);     /* compiles to one unaligned load */
+    return x;
+}
+
+static inline void store64(uint8_t *p, uint64_t x) {
+    memcpy(p, &x, sizeof x);
+}
+
+/* Read/write up to 56 bits starting at any bit position. */
+static inline uint64_t bits_get(const uint8_t *b, size_t pos, unsigned w) {
+    return (load64(b + (pos >> 3)) >> (pos & 7)) & pa_mask(w);
+}
+
+static inline void bits_set(uint8_t *b, size_t pos, unsigned w, uint64_t v) {
+    uint8_t *p = b + (pos >> 3);
+    unsigned sh = pos & 7;
+    uint64_t m = pa_mask(w) << sh;
+    store64(p, (load64(p) & ~m) | ((v << sh) & m));
+}
+
+static int pa_init(packed_array *a, size_t n, unsigned width) {
+    if (width < 1 || width > 64)
+        return -1;
+    size_t bytes = (n * width + 7) / 8 + 8;
+    a->bytes = calloc(bytes, 1);
+    a->n = n;
+    a->width = width;
+    a->base = 0;
+    return a->bytes ? 0 : -1;
+}
+
+static void pa_free(packed_array *a) {
+    free(a->bytes);
+    a->bytes = NULL;
+}
+
+static size_t pa_bytes(const packed_array *a) {
+    return (a->n * a->width + 7) / 8;
+}
+
+static inline uint64_t pa_get_raw(const packed_array *a, size_t i) {
+    size_t pos = i * a->width;
+    if (a->width <= 56)
+        return bits_get(a->bytes, pos, a->width);
+    return bits_get(a->bytes, pos, 32) |
+           bits_get(a->bytes, pos + 32, a->width - 32) << 32;
+}
+
+static inline int64_t pa_get(const packed_array *a, size_t i) {
+    return a->base + (int64_t)pa_get_raw(a, i);
+}
+
+static inline void pa_set(packed_array *a, size_t i, int64_t value) {
+    uint64_t v = (uint64_t)(value - a->base);
+    size_t pos = i * a->width;
+    if (a->width <= 56) {
+        bits_set(a->bytes, pos, a->width, v);
+    } else {
+        bits_set(a->bytes, pos, 32, v);
+        bits_set(a->bytes, pos + 32, a->width - 32, v >> 32);
+    }
+}
+
+/* ---------- per-width bulk unpack ---------- */
+
+/* Group g of 8 values starts at byte g * width. */
+static inline __attribute__((always_inline))
+void unpack_groups(const uint8_t *src, unsigned w, uint64_t *out, size_t groups) {
+    for (size_t g = 0; g < groups; g++, src += w, out += 8) {
+#pragma GCC unroll 8
+        for (unsigned j = 0; j < 8; j++)
+            out[j] = bits_get(src, j * w, w);
+    }
+}
+
+/* Fused scan over groups: op 0 = sum, op 1 = count(v < t). */
+static inline __attribute__((always_inline))
+uint64_t scan_groups(const uint8_t *src, unsigned w, size_t groups, int op,
+                     uint64_t t) {
+    uint64_t acc = 0;
+    for (size_t g = 0; g < groups; g++, src += w) {
+#pragma GCC unroll 8
+        for (unsigned j = 0; j < 8; j++) {
+            uint64_t v = bits_get(src, j * w, w);
+            acc += op == 0 ? v : (uint64_t)(v < t);
+        }
+    }
+    return acc;
+}
+
+typedef void (*unpack_fn)(const uint8_t *, uint64_t *, size_t);
+typedef uint64_t (*scan_fn)(const uint8_t *, size_t, uint64_t);
+
+#define PA_WIDTHS(X)                                                      \
+    X(1)  X(2)  X(3)  X(4)  X(5)  X(6)  X(7)  X(8)  X(9)  X(10)           \
+    X(11) X(12) X(13) X(14) X(15) X(16) X(17) X(18) X(19) X(20)           \
+    X(21) X(22) X(23) X(24) X(25) X(26) X(27) X(28) X(29) X(30)           \
+    X(31) X(32) X(33) X(34) X(35) X(36) X(37) X(38) X(39) X(40)           \
+    X(41) X(42) X(43) X(44) X(45) X(46) X(47) X(48) X(49) X(50)           \
+    X(51) X(52) X(53) X(54) X(55) X(56)
+
+#define PA_DEFINE(W)                                                      \
+    static void unpack_w##W(const uint8_t *s, uint64_t *o, size_t g) {    \
+        unpack_groups(s, W, o, g);                                        \
+    }                                                                     \
+    static uint64_t sum_w##W(const uint8_t *s, size_t g, uint64_t t) {    \
+        (void)t;                                                          \
+        return scan_groups(s, W, g, 0, 0);                                \
+    }                                                                     \
+    static uint64_t less_w##W(const uint8_t *s, size_t g, uint64_t t) {   \
+        return scan_groups(s, W, g, 1, t);                                \
+    }
+#define PA_UNPACK_ENTRY(W) unpack_w##W,
+#define PA_SUM_ENTRY(W)    sum_w##W,
+#define PA_LESS_ENTRY(W)   less_w##W,
+
+PA_WIDTHS(PA_DEFINE)
+
+static const unpack_fn unpack_table[57] = { NULL, PA_WIDTHS(PA_UNPACK_ENTRY) };
+static const scan_fn   sum_table[57]    = { NULL, PA_WIDTHS(PA_SUM_ENTRY) };
+static const scan_fn   less_table[57]   = { NULL, PA_WIDTHS(PA_LESS_ENTRY) };
+
+/* Unpack raw values [first, first + count) into out; first % 8 == 0. */
+static void pa_unpack_raw(const packed_array *a, size_t first, size_t count,
+                          uint64_t *out) {
+    size_t groups = count / 8;
+    if (a->width <= 56) {
+        unpack_table[a->width](a->bytes + (first / 8) * a->width, out, groups);
+    } else {
+        for (size_t k = 0; k < groups * 8; k++)
+            out[k] = pa_get_raw(a, first + k);
+    }
+    for (size_t k = groups * 8; k < count; k++)
+        out[k] = pa_get_raw(a, first + k);
+}
+
+/* Bulk unpack into a regular int array (the reverse of pa_from_ints). */
+static void pa_to_ints(const packed_array *a, int32_t *out) {
+    uint64_t buf[PA_CHUNK];
+    for (size_t i = 0; i < a->n; i += PA_CHUNK) {
+        size_t cnt = a->n - i < PA_CHUNK ? a->n - i : PA_CHUNK;
+        pa_unpack_raw(a, i, cnt, buf);
+        for (size_t k = 0; k < cnt; k++)
+            out[i + k] = (int32_t)(a->base + (int64_t)buf[k]);
+    }
+}
+
+/* Whole groups go through the fused per-width kernel, the tail (and
+ * widths above 56) through pa_get_raw. */
+static uint64_t pa_scan(const packed_array *a, const scan_fn *table, int op,
+                        uint64_t t) {
+    size_t groups = a->width <= 56 ? a->n / 8 : 0;
+    uint64_t acc = groups ? table[a->width](a->bytes, groups, t) : 0;
+    for (size_t i = groups * 8; i < a->n; i++) {
+        uint64_t v = pa_get_raw(a, i);
+        acc += op == 0 ? v : (uint64_t)(v < t);
+    }
+    return acc;
+}
+
+static int64_t pa_sum(const packed_array *a) {
+    return (int64_t)pa_scan(a, sum_table, 0, 0) + a->base * (int64_t)a->n;
+}
+
+/* Count elements with value < threshold. */
+static size_t pa_count_less(const packed_array *a, int64_t threshold) {
+    if (threshold <= a->base)
+        return 0;
+    return (size_t)pa_scan(a, less_table, 1, (uint64_t)(threshold - a->base));
+}
+
+/* Bulk conversion: pick the narrowest width for [min, max] and pack. */
+static int pa_from_ints(packed_array *a, const int32_t *src, size_t n) {
+    int64_t lo = n ? src[0] : 0, hi = lo;
+    for (size_t i = 1; i < n; i++) {
+        if (src[i] < lo) lo = src[i];
+        if (src[i] > hi) hi = src[i];
+    }
+    unsigned w = 1;
+    while (w < 64 && ((uint64_t)(hi - lo) >> w))
+        w++;
+    if (pa_init(a, n, w) != 0)
+        return -1;
+    a->base = lo;
+    /* groups of 8 are byte aligned, so neighbouring writes never overlap a
+     * partially written word from a different group */
+    for (size_t i = 0; i < n; i++)
+        pa_set(a, i, src[i]);
+    return 0;
+}
+
+/* ---------- benchmark ---------- */
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int64_t int_sum(const int32_t *v, size_t n) {
+    int64_t s = 0;
+    for (size_t i = 0; i < n; i++)
+        s += v[i];
+    return s;
+}
+
+static size_t int_count_less(const int32_t *v, size_t n, int32_t t) {
+    size_t hits = 0;
+    for (size_t i = 0; i < n; i++)
+        hits += v[i] < t;
+    return hits;
+}
+
+static int run(size_t n, unsigned bits) {
+    int32_t *arr = malloc(n * sizeof *arr);
+    int32_t *back = malloc(n * sizeof *back);
+    if (!arr || !back)
+        return 1;
+    srand(7);
+    for (size_t i = 0; i < n; i++)
+        arr[i] = (int32_t)(rand() & ((1u << bits) - 1)) - 100;
+
+    packed_array pa;
+    double t0 = now_sec();
+    if (pa_from_ints(&pa, arr, n) != 0)
+        return 1;
+    double t_pack = now_sec() - t0;
+
+    memset(back, 0, n * sizeof *back);
+    pa_to_ints(&pa, back);
+    if (memcmp(arr, back, n * sizeof *arr) != 0) {
+        fprintf(stderr, "round trip FAILED at width %u\n", pa.width);
+        return 1;
+    }
+
+    int32_t thr = (int32_t)(1u << (bits - 1));
+    t0 = now_sec();
+    int64_t s1 = int_sum(arr, n);
+    size_t c1 = int_count_less(arr, n, thr);
+    double t_int = now_sec() - t0;
+
+    t0 = now_sec();
+    int64_t s2 = pa_sum(&pa);
+    size_t c2 = pa_count_less(&pa, thr);
+    double t_pa = now_sec() - t0;
+
+    size_t probes = 1000000;
+    int64_t g1 = 0, g2 = 0;
+    t0 = now_sec();
+    for (size_t k = 0; k < probes; k++)
+        g1 += arr[(k * 2654435761u) % n];
+    double t_gi = now_sec() - t0;
+    t0 = now_sec();
+    for (size_t k = 0; k < probes; k++)
+        g2 += pa_get(&pa, (k * 2654435761u) % n);
+    double t_gp = now_sec() - t0;
+
+    if (s1 != s2 || c1 != c2 || g1 != g2) {
+        fprintf(stderr, "mismatch at width %u\n", pa.width);
+        return 1;
+    }
+    double scan_bytes = 2.0 * n * sizeof(int32_t);  /* sum + count passes */
+    printf("%5u %10.1f %10.1f %8.2f %12.2f %12.2f %9.1f %9.1f %8.3f\n",
+           pa.width, n * 4 / 1e6, pa_bytes(&pa) / 1e6,
+           (double)n * 4 / pa_bytes(&pa),
+           scan_bytes / t_int / 1e9, scan_bytes / t_pa / 1e9,
+           t_gi / probes * 1e9, t_gp / probes * 1e9, t_pack);
+
+    pa_free(&pa);
+    free(arr);
+    free(back);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    size_t n = argc > 1 ? strtoull(argv[1], NULL, 10) : 10000000;
+    unsigned widths[] = { 5, 12, 20 };
+    if (n == 0) {
+        fprintf(stderr, "usage: %s [N > 0]\n", argv[0]);
+        return 1;
+    }
+
+    printf("scan GB/s counts int-equivalent bytes (sum + count-less pass)\n");
+    printf("%5s %10s %10s %8s %12s %12s %9s %9s %8s\n", "width", "int[] MB",
+           "packed MB", "ratio", "int[] GB/s", "packed GB/s", "int[] ns",
+           "get ns", "pack s");
+    for (size_t k = 0; k < sizeof widths / sizeof *widths; k++)
+        if (run(n, widths[k]) != 0)
+            return 1;
+
+    /* edge widths: exercise the split path for > 56 bits */
+    packed_array wide;
+    pa_init(&wide, 100, 64);
+    for (size_t i = 0; i < 100; i++)
+        pa_set(&wide, i, (int64_t)(i * 0x0123456789ABCDEFULL));
+    for (size_t i = 0; i < 100; i++)
+        if (pa_get(&wide, i) != (int64_t)(i * 0x0123456789ABCDEFULL)) {
+            fprintf(stderr, "64-bit width FAILED\n");
+            return 1;
+        }
+    pa_free(&wide);
+    printf("64-bit width round trip OK\n");
+    return 0;
+}
@@ -0,0 +1,104 @@
+/* span.h — pointer + length that travel together.
+ *
+ * Note 04 shows `sizeof` losing an array's length as soon as the name
+ * decays to a pointer, and note 01's printArray(int *arr, int size) has to
+ * pass the length on the side. A span keeps the two in one value:
+ *
+ *   span_int   { int *p; size_t len; }         mutable elements
+ *   cspan_int  { const int *p; size_t len; }   read-only elements
+ *
+ * SPAN_DECLARE(T, name) declares the pair for any element type. The
+ * operations are macros, so they work on every span type:
+ *
+ *   SPAN_ARRAY(span_int, arr)     span over a real array (rejects pointers)
+ *   SPAN_AT(s, i)                 element i, bounds-checked in debug builds
+ *   SPAN_SUB(s, off, n)           elements [off, off + n), checked
+ *   SPAN_FIRST / SPAN_DROP        prefix / suffix
+ *   SPAN_CONST(cspan_int, s)      mutable -> read-only view
+ *   SPAN_REQUIRE(cond)            precondition, e.g. matching lengths
+ *   SPAN_FOREACH(it, s)           it walks pointers to the elements
+ *
+ * A failed check prints file:line and aborts. With NDEBUG defined every
+ * check compiles to nothing: SPAN_AT is a plain s.p[i] and SPAN_SUB is
+ * pointer arithmetic. Macro arguments may be evaluated more than once —
+ * pass plain variables.
+ */
+#ifndef SPAN_H
+#define SPAN_H
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>      /* vfprintf */
+#include <stdlib.h>     /* abort   */
+
+#define SPAN_DECLARE(T, name)                                   \
+    typedef struct { T *p; size_t len; } span_##name;           \
+    typedef struct { const T *p; size_t len; } cspan_##name
+
+#ifdef NDEBUG
+
+#define SPAN_IDX(s, i)            (i)
+#define SPAN_OFF(s, off, n)       (off)
+#define SPAN_REQUIRE(cond)        ((void)0)
+
+#else
+
+__attribute__((noreturn, cold, noinline, format(printf, 3, 4)))
+static void span_fail(const char *file, int line, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    fprintf(stderr, "%s:%d: ", file, line);
+    vfprintf(stderr, fmt, ap);
+    fputc('\n', stderr);
+    va_end(ap);
+    abort();
+}
+
+static inline size_t span_check_idx(size_t i, size_t len, const char *file, int line) {
+    if (__builtin_expect(i >= len, 0))
+        span_fail(file, line, "span index %zu out of range [0, %zu)", i, len);
+    return i;
+}
+
+static inline size_t span_check_off(size_t off, size_t n, size_t len,
+                                    const char *file, int line) {
+    if (__builtin_expect(off > len || n > len - off, 0))
+        span_fail(file, line, "span slice at %zu of %zu elements out of range [0, %zu)",
+                  off, n, len);
+    return off;
+}
+
+#define SPAN_IDX(s, i)        span_check_idx((i), (s).len, __FILE__, __LINE__)
+#define SPAN_OFF(s, off, n)   span_check_off((off), (n), (s).len, __FILE__, __LINE__)
+#define SPAN_REQUIRE(cond)                                              \
+    ((cond) ? (void)0 : span_fail(__FILE__, __LINE__, "span requirement failed: %s", #cond))
+
+#endif /* NDEBUG */
+
+/* sizeof(a) / sizeof(a[0]) silently gives the wrong answer for a pointer;
+ * this refuses to compile instead. */
+#define SPAN_COUNT(a)                                                   \
+    (sizeof(a) / sizeof((a)[0]) +                                       \
+     0 * sizeof(char[1 - 2 * __builtin_types_compatible_p(__typeof__(a), \
+                                                          __typeof__(&(a)[0]))]))
+
+#define SPAN_OF(type, ptr, n)     ((type){ (ptr), (n) })
+#define SPAN_ARRAY(type, a)       ((type){ (a), SPAN_COUNT(a) })
+#define SPAN_CONST(ctype, s)      ((ctype){ (s).p, (s).len })
+
+#define SPAN_AT(s, i)             ((s).p[SPAN_IDX((s), (i))])
+#define SPAN_SUB(s, off, n)                                             \
+    ((__typeof__(s)){ (s).p + SPAN_OFF((s), (off), (n)), (n) })
+#define SPAN_FIRST(s, n)          SPAN_SUB((s), 0, (n))
+#define SPAN_DROP(s, n)           SPAN_SUB((s), (n), (s).len - (n))
+#define SPAN_EMPTY(s)             ((s).len == 0)
+
+/* for (int *it ...) over the span; `it` is a pointer to the element. */
+#define SPAN_FOREACH(it, s)                                             \
+    for (__typeof__((s).p) it = (s).p, it##_end_ = (s).p + (s).len;    \
+         it != it##_end_; ++it)
+
+SPAN_DECLARE(int, int);
+SPAN_DECLARE(double, double);
+
+#endif /* SPAN_H */
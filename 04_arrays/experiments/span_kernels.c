@@ -0,0 +1,273 @@
+/*
+ * span_kernels.c — the chapter's array kernels, pointer + size vs span.
+ *
+ * fill / add / average / copy / print are written twice:
+ *
+ *   ptr     void fill_ptr(int *arr, int size, int v)     (note 01 style)
+ *   span    void fill(span_int s, int v)                 (span.h)
+ *
+ * The span kernels check their preconditions once at the top
+ * (SPAN_REQUIRE) and then run an unchecked loop. add_at() instead goes
+ * through SPAN_AT for every element, to show what a per-access check costs
+ * in a debug build and that it disappears with -DNDEBUG.
+ *
+ * Build it both ways and compare the columns:
+ *
+ *   gcc -O2 span_kernels.c -o span_debug              # checks on
+ *   gcc -O2 -DNDEBUG span_kernels.c -o span_release   # checks compiled out
+ *   ./span_release            # 64K ints (L2-resident), 500 passes
+ *   ./span_release 4000000 100
+ */
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "span.h"
+
+#define KERNEL __attribute__((noinline))
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* ---------- pointer + size ---------- */
+
+KERNEL static void fill_ptr(int *arr, int size, int v) {
+    for (int i = 0; i < size; i++)
+        arr[i] = v;
+}
+
+KERNEL static void add_ptr(int *dst, const int *a, const int *b, int size) {
+    for (int i = 0; i < size; i++)
+        dst[i] = a[i] + b[i];
+}
+
+KERNEL static double average_ptr(const int *arr, int size) {
+    long long sum = 0;
+    for (int i = 0; i < size; i++)
+        sum += arr[i];
+    return size ? (double)sum / size : 0.0;
+}
+
+KERNEL static void copy_ptr(int *dst, const int *src, int size) {
+    for (int i = 0; i < size; i++)
+        dst[i] = src[i];
+}
+
+static void print_ptr(const int *arr, int size) {
+    for (int i = 0; i < size; i++)
+        printf("%d ", arr[i]);
+    printf("\n");
+}
+
+/* ---------- spans ---------- */
+
+KERNEL static void fill(span_int s, int v) {
+    SPAN_FOREACH(it, s)
+        *it = v;
+}
+
+KERNEL static void add(span_int dst, cspan_int a, cspan_int b) {
+    SPAN_REQUIRE(a.len == dst.len && b.len == dst.len);
+    for (size_t i = 0; i < dst.len; i++)
+        dst.p[i] = a.p[i] + b.p[i];
+}
+
+/* Same as add(), but every access is individually checked. */
+KERNEL static void add_at(span_int dst, cspan_int a, cspan_int b) {
+    for (size_t i = 0; i < dst.len; i++)
+        SPAN_AT(dst, i) = SPAN_AT(a, i) + SPAN_AT(b, i);
+}
+
+KERNEL static double average(cspan_int s) {
+    long long sum = 0;
+    SPAN_FOREACH(it, s)
+        sum += *it;
+    return s.len ? (double)sum / (double)s.len : 0.0;
+}
+
+/* Copies all of src into the front of dst; returns the part written. */
+KERNEL static span_int copy(span_int dst, cspan_int src) {
+    SPAN_REQUIRE(src.len <= dst.len);
+    for (size_t i = 0; i < src.len; i++)
+        dst.p[i] = src.p[i];
+    return SPAN_FIRST(dst, src.len);
+}
+
+static void print(cspan_int s) {
+    SPAN_FOREACH(it, s)
+        printf("%d ", *it);
+    printf("\n");
+}
+
+/* ---------- benchmark ---------- */
+
+#define BARRIER() __asm__ volatile("" ::: "memory")
+#define REPS 21
+
+typedef struct {
+    const char *name;
+    double ptr, span, at;        /* ns per element, at < 0 if n/a */
+} row;
+
+static void report(row r) {
+    printf("%-8s %8.3f %8.3f", r.name, r.ptr, r.span);
+    if (r.at >= 0)
+        printf(" %8.3f", r.at);
+    else
+        printf("        -");
+    printf("   span/ptr %.2f\n", r.span / r.ptr);
+}
+
+static void bench(size_t n, size_t passes) {
+    int *x = malloc(n * sizeof *x), *y = malloc(n * sizeof *y), *z = malloc(n * sizeof *z);
+    for (size_t i = 0; i < n; i++) {
+        x[i] = (int)(i * 7 % 1000);
+        y[i] = (int)(i * 13 % 1000);
+    }
+    span_int  sz = SPAN_OF(span_int, z, n);
+    cspan_int cx = SPAN_OF(cspan_int, x, n), cy = SPAN_OF(cspan_int, y, n);
+    double scale = 1e9 / ((double)n * (double)passes);
+    volatile double sink = 0;
+
+/* `passes` calls of expr; keeps the fastest run in out */
+#define TIME(out, expr)                                                 \
+    do {                                                                \
+        double t0_ = now_sec();                                         \
+        for (size_t p_ = 0; p_ < passes; p_++) {                        \
+            expr;                                                       \
+            BARRIER();                                                  \
+        }                                                               \
+        double t_ = (now_sec() - t0_) * scale;                          \
+        if (t_ < out)                                                   \
+            out = t_;                                                   \
+    } while (0)
+
+    printf("%zu ints x %zu passes, best of %d, ns/element\n", n, passes, REPS);
+    printf("kernel        ptr     span  span_at\n");
+    /* the variants take turns, so a noisy moment hits all of them */
+    row r = { "fill", 1e30, 1e30, -1 };
+    for (int rep = 0; rep < REPS; rep++) {
+        TIME(r.ptr, fill_ptr(z, (int)n, (int)p_));
+        TIME(r.span, fill(sz, (int)p_));
+    }
+    report(r);
+    r = (row){ "add", 1e30, 1e30, 1e30 };
+    for (int rep = 0; rep < REPS; rep++) {
+        TIME(r.ptr, add_ptr(z, x, y, (int)n));
+        TIME(r.span, add(sz, cx, cy));
+        TIME(r.at, add_at(sz, cx, cy));
+    }
+    report(r);
+    r = (row){ "average", 1e30, 1e30, -1 };
+    for (int rep = 0; rep < REPS; rep++) {
+        TIME(r.ptr, sink += average_ptr(x, (int)n));
+        TIME(r.span, sink += average(cx));
+    }
+    report(r);
+    r = (row){ "copy", 1e30, 1e30, -1 };
+    for (int rep = 0; rep < REPS; rep++) {
+        TIME(r.ptr, copy_ptr(z, x, (int)n));
+        TIME(r.span, copy(sz, cx));
+    }
+    report(r);
+#undef TIME
+    (void)sink;
+    free(x);
+    free(y);
+    free(z);
+}
+
+/* ---------- self-test ---------- */
+
+#ifndef NDEBUG
+/* Runs fn in a child; returns the signal that ended it, or 0. */
+static int dies_with(void (*fn)(void)) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(STDERR_FILENO);                 /* keep the abort message quiet */
+        fn();
+        _exit(0);
+    }
+    int st;
+    waitpid(pid, &st, 0);
+    return WIFSIGNALED(st) ? WTERMSIG(st) : 0;
+}
+
+static void oob_index(void) {
+    int v[4] = { 0 };
+    span_int s = SPAN_ARRAY(span_int, v);
+    volatile size_t i = s.len;
+    SPAN_AT(s, i) = 1;                        /* one past the end */
+}
+
+static void oob_slice(void) {
+    int v[4] = { 0 };
+    span_int s = SPAN_ARRAY(span_int, v);
+    volatile size_t off = 3;
+    span_int t = SPAN_SUB(s, off, 2);
+    (void)t;
+}
+#endif
+
+static int selftest(void) {
+    int ok = 1;
+    int vector[5] = { 1, 2, 3, 4, 5 };
+    span_int v = SPAN_ARRAY(span_int, vector);   /* length from sizeof, once */
+    ok &= v.len == 5 && SPAN_AT(v, 4) == 5;
+    printf("printArray(vector, 5): ");
+    print_ptr(vector, 5);
+    printf("print(v):              ");
+    print(SPAN_CONST(cspan_int, v));
+    printf("print(SPAN_SUB(v,1,3)): ");
+    print(SPAN_CONST(cspan_int, SPAN_SUB(v, 1, 3)));
+
+    ok &= SPAN_DROP(v, 5).len == 0 && SPAN_EMPTY(SPAN_FIRST(v, 0));
+    ok &= SPAN_SUB(v, 2, 3).p == vector + 2 && SPAN_DROP(v, 1).len == 4;
+    ok &= average(SPAN_CONST(cspan_int, v)) == average_ptr(vector, 5);
+
+    int a[1000], b[1000], c[1000], d[1000];
+    span_int sa = SPAN_ARRAY(span_int, a), sc = SPAN_ARRAY(span_int, c);
+    fill(sa, 7);
+    fill_ptr(b, 1000, 7);
+    ok &= memcmp(a, b, sizeof a) == 0;
+    for (int i = 0; i < 1000; i++)
+        b[i] = i;
+    add(sc, SPAN_CONST(cspan_int, sa), SPAN_ARRAY(cspan_int, b));
+    add_ptr(d, a, b, 1000);
+    ok &= memcmp(c, d, sizeof c) == 0;
+    add_at(sc, SPAN_CONST(cspan_int, sa), SPAN_ARRAY(cspan_int, b));
+    ok &= memcmp(c, d, sizeof c) == 0;
+    span_int w = copy(SPAN_ARRAY(span_int, d), SPAN_SUB(SPAN_ARRAY(cspan_int, b), 10, 20));
+    ok &= w.len == 20 && d[0] == 10 && d[19] == 29 && d[20] == 27;
+
+#ifdef NDEBUG
+    printf("bounds checks: off (NDEBUG)\n");
+#else
+    printf("bounds checks: on\n");
+    ok &= dies_with(oob_index) == SIGABRT;
+    ok &= dies_with(oob_slice) == SIGABRT;
+#endif
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    size_t n      = argc > 1 ? strtoull(argv[1], NULL, 10) : 65536;
+    size_t passes = argc > 2 ? strtoull(argv[2], NULL, 10) : 500;
+    if (n == 0 || passes == 0) {
+        fprintf(stderr, "usage: %s [N > 0 [PASSES > 0]]\n", argv[0]);
+        return 1;
+    }
+    int ok = selftest();
+    printf("self-test: %s\n\n", ok ? "ok" : "FAILED");
+    bench(n, passes);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,309 @@
+/* lstr.h — length-carrying strings with SIMD scanning kernels.
+ *
+ *   ls_view   non-owning (pointer, length) slice — no NUL required
+ *   lstr      owning, growable, always NUL-terminated for C interop
+ *
+ * A C string only knows where it ends by scanning for '\0'; strlen(),
+ * strcpy(), strcat() and strcmp() all repeat that scan. Here the length is
+ * computed once (ls_strlen at the boundary, or sizeof on a literal via
+ * LS_LIT) and every operation returns the resulting length, so nothing
+ * ever needs a rescan.
+ *
+ * Kernels compare LS_W bytes per step: 32 with AVX2, 16 with SSE2 or NEON,
+ * 8 in the portable SWAR fallback.
+ */
+#ifndef LSTR_H
+#define LSTR_H
+
+#include <stdint.h>
+#include <stdlib.h>   /* realloc, free */
+#include <string.h>   /* memcpy, memmove, memcmp */
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/* ls_strlen reads whole aligned blocks, possibly before the string starts
+ * or past its NUL. That can't fault (same page), but ASan would flag it, so
+ * block loads are left uninstrumented. */
+#if defined(__SANITIZE_ADDRESS__)
+#define LS_NO_ASAN __attribute__((no_sanitize_address))
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define LS_NO_ASAN __attribute__((no_sanitize_address))
+#endif
+#endif
+#ifndef LS_NO_ASAN
+#define LS_NO_ASAN
+#endif
+
+/* ---------- block compare: bit mask of bytes equal to c ---------- */
+
+/* Lane k of a mask occupies LS_LANE_BITS bits starting at k << LS_LANE_SHIFT. */
+#if defined(__AVX2__)
+#define LS_W 32
+#define LS_LANE_SHIFT 0
+typedef __m256i ls_vec;
+static inline ls_vec ls_splat(char c) { return _mm256_set1_epi8(c); }
+LS_NO_ASAN static inline ls_vec ls_load(const char *p) { return _mm256_loadu_si256((const __m256i *)p); }
+static inline uint64_t ls_eq(ls_vec a, ls_vec b) {
+    return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b));
+}
+#elif defined(__SSE2__)
+#define LS_W 16
+#define LS_LANE_SHIFT 0
+typedef __m128i ls_vec;
+static inline ls_vec ls_splat(char c) { return _mm_set1_epi8(c); }
+LS_NO_ASAN static inline ls_vec ls_load(const char *p) { return _mm_loadu_si128((const __m128i *)p); }
+static inline uint64_t ls_eq(ls_vec a, ls_vec b) {
+    return (uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(a, b));
+}
+#elif defined(__ARM_NEON)
+#define LS_W 16
+#define LS_LANE_SHIFT 2               /* vshrn trick: 4 bits per lane */
+typedef uint8x16_t ls_vec;
+static inline ls_vec ls_splat(char c) { return vdupq_n_u8((uint8_t)c); }
+LS_NO_ASAN static inline ls_vec ls_load(const char *p) { return vld1q_u8((const uint8_t *)p); }
+static inline uint64_t ls_eq(ls_vec a, ls_vec b) {
+    uint8x8_t n = vshrn_n_u16(vreinterpretq_u16_u8(vceqq_u8(a, b)), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(n), 0);
+}
+#else
+/* SWAR: 8 bytes in a uint64_t; a matching byte sets its own top bit. */
+#define LS_W 8
+#define LS_LANE_SHIFT 3
+typedef uint64_t ls_vec;
+static inline ls_vec ls_splat(char c) { return 0x0101010101010101ull * (unsigned char)c; }
+LS_NO_ASAN static inline ls_vec ls_load(const char *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof v);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);         /* byte k must sit in bits 8k..8k+7 */
+#endif
+    return v;
+}
+static inline uint64_t ls_eq(ls_vec a, ls_vec b) {
+    const uint64_t lo7 = 0x7f7f7f7f7f7f7f7full;
+    uint64_t x = a ^ b;               /* zero byte where equal */
+    return ~(((x & lo7) + lo7) | x | lo7);   /* exact: no false hits */
+}
+#define LS_FULL_MASK 0x8080808080808080ull
+#endif
+
+#define LS_LANE_BITS (1u << LS_LANE_SHIFT)
+#ifndef LS_FULL_MASK                  /* every lane matched */
+#define LS_FULL_MASK (LS_W * LS_LANE_BITS == 64 ? ~(uint64_t)0 \
+                      : ((uint64_t)1 << (LS_W * LS_LANE_BITS)) - 1)
+#endif
+
+static inline size_t ls_first(uint64_t m) {
+    return (size_t)__builtin_ctzll(m) >> LS_LANE_SHIFT;
+}
+
+/* Clear the lowest matching lane. */
+static inline uint64_t ls_drop_first(uint64_t m) {
+    return m & ~((((uint64_t)1 << LS_LANE_BITS) - 1) << (ls_first(m) << LS_LANE_SHIFT));
+}
+
+/* ---------- views ---------- */
+
+typedef struct {
+    const char *p;
+    size_t      len;
+} ls_view;
+
+/* Length of a literal at compile time — no scan at all. */
+#define LS_LIT(s) ((ls_view){ "" s, sizeof(s) - 1 })
+
+/* Aligned loads never cross a page, so reading a whole block around the
+ * terminator is safe even at the end of a mapping. */
+LS_NO_ASAN static inline size_t ls_strlen(const char *s) {
+    const ls_vec zero = ls_splat(0);
+    uintptr_t a = (uintptr_t)s & ~(uintptr_t)(LS_W - 1);
+    const char *p = (const char *)a;
+    uint64_t m = ls_eq(ls_load(p), zero) >> (((uintptr_t)s - a) << LS_LANE_SHIFT);
+    if (m)
+        return ls_first(m);
+    for (;;) {
+        p += LS_W;
+        if ((m = ls_eq(ls_load(p), zero)))
+            return (size_t)(p - s) + ls_first(m);
+    }
+}
+
+static inline ls_view ls_cstr(const char *s) {
+    return (ls_view){ s, ls_strlen(s) };
+}
+
+/* Index of the first `c` in p[0..n), or n. */
+static inline size_t ls_find_byte(const char *p, size_t n, char c) {
+    const ls_vec vc = ls_splat(c);
+    size_t i = 0;
+    for (; i + LS_W <= n; i += LS_W) {
+        uint64_t m = ls_eq(ls_load(p + i), vc);
+        if (m)
+            return i + ls_first(m);
+    }
+    for (; i < n; i++)
+        if (p[i] == c)
+            return i;
+    return n;
+}
+
+/* Length of the common prefix of a and b. */
+static inline size_t ls_mismatch(ls_view a, ls_view b) {
+    size_t n = a.len < b.len ? a.len : b.len, i = 0;
+    for (; i + LS_W <= n; i += LS_W) {
+        uint64_t m = ls_eq(ls_load(a.p + i), ls_load(b.p + i)) ^ LS_FULL_MASK;
+        if (m)
+            return i + ls_first(m);
+    }
+    while (i < n && a.p[i] == b.p[i])
+        i++;
+    return i;
+}
+
+/* strcmp() order (unsigned bytes, shorter prefix first). */
+static inline int ls_compare(ls_view a, ls_view b) {
+    size_t i = ls_mismatch(a, b);
+    if (i < a.len && i < b.len)
+        return (unsigned char)a.p[i] < (unsigned char)b.p[i] ? -1 : 1;
+    return (a.len > b.len) - (a.len < b.len);
+}
+
+/* Different lengths can't be equal: most comparisons end before a byte
+ * is read. */
+static inline int ls_equal(ls_view a, ls_view b) {
+    return a.len == b.len && memcmp(a.p, b.p, a.len) == 0;
+}
+
+/* Offset of the first occurrence of `needle`, or hay.len.
+ * Filters positions whose first *and* last byte match, LS_W at a time,
+ * and verifies only those — rare for real text. */
+static inline size_t ls_find(ls_view hay, ls_view needle) {
+    size_t k = needle.len;
+    if (k == 0)
+        return 0;
+    if (k > hay.len)
+        return hay.len;
+    if (k == 1)
+        return ls_find_byte(hay.p, hay.len, needle.p[0]);
+    const ls_vec first = ls_splat(needle.p[0]), last = ls_splat(needle.p[k - 1]);
+    size_t i = 0;
+    for (; i + k - 1 + LS_W <= hay.len; i += LS_W) {
+        uint64_t m = ls_eq(ls_load(hay.p + i), first) &
+                     ls_eq(ls_load(hay.p + i + k - 1), last);
+        while (m) {
+            size_t j = i + ls_first(m);
+            if (memcmp(hay.p + j + 1, needle.p + 1, k - 2) == 0)
+                return j;
+            m = ls_drop_first(m);
+        }
+    }
+    for (; i + k <= hay.len; i++)
+        if (hay.p[i] == needle.p[0] && memcmp(hay.p + i, needle.p, k) == 0)
+            return i;
+    return hay.len;
+}
+
+/* Tokenizer: splits *rest at the next `delim`. Returns 0 once the input
+ * is used up. Empty fields are kept ("a,,b" gives "a", "", "b"), and so is
+ * a trailing empty one. Unlike strtok() it neither writes into the input
+ * nor keeps hidden state. */
+static inline int ls_split(ls_view *rest, char delim, ls_view *tok) {
+    if (!rest->p)
+        return 0;
+    size_t i = ls_find_byte(rest->p, rest->len, delim);
+    *tok = (ls_view){ rest->p, i };
+    if (i == rest->len) {
+        rest->p = NULL;
+        rest->len = 0;
+    } else {
+        rest->p += i + 1;
+        rest->len -= i + 1;
+    }
+    return 1;
+}
+
+static inline ls_view ls_sub(ls_view v, size_t from, size_t n) {
+    if (from > v.len)
+        from = v.len;
+    if (n > v.len - from)
+        n = v.len - from;
+    return (ls_view){ v.p + from, n };
+}
+
+/* ---------- owning string ---------- */
+
+typedef struct {
+    char  *p;
+    size_t len, cap;           /* cap excludes the terminating NUL */
+} lstr;
+
+#define LSTR_ERR ((size_t)-1)
+
+static inline void lstr_init(lstr *s) {
+    s->p = NULL;
+    s->len = s->cap = 0;
+}
+
+static inline ls_view lstr_view(const lstr *s) {
+    return (ls_view){ s->p ? s->p : "", s->len };
+}
+
+/* Returns the capacity, or LSTR_ERR (the string is left untouched). */
+static inline size_t lstr_reserve(lstr *s, size_t need) {
+    if (need <= s->cap && s->p)
+        return s->cap;
+    size_t cap = s->cap ? s->cap : 15;
+    while (cap < need)
+        cap = cap * 2 + 1;
+    char *p = realloc(s->p, cap + 1);
+    if (!p)
+        return LSTR_ERR;
+    s->p = p;
+    s->cap = cap;
+    return cap;
+}
+
+/* Copy: the length is known, so this is one memcpy — no terminator scan
+ * like strcpy(). Returns the new length or LSTR_ERR. */
+static inline size_t lstr_set(lstr *s, ls_view v) {
+    if (lstr_reserve(s, v.len) == LSTR_ERR)
+        return LSTR_ERR;
+    memmove(s->p, v.p, v.len);
+    s->p[s->len = v.len] = '\0';
+    return s->len;
+}
+
+/* strcat() rescans dst every call (quadratic in a loop); this is O(|v|).
+ * v may point into s itself (lstr_append(s, lstr_view(s))): the reserve can
+ * move the buffer, so v is rebased onto the new one. */
+static inline size_t lstr_append(lstr *s, ls_view v) {
+    uintptr_t at = (uintptr_t)v.p, base = (uintptr_t)s->p;
+    int self = s->p && at >= base && at <= base + s->len;
+    if (lstr_reserve(s, s->len + v.len) == LSTR_ERR)
+        return LSTR_ERR;
+    if (self)
+        v.p = s->p + (at - base);
+    memcpy(s->p + s->len, v.p, v.len);
+    s->len += v.len;
+    s->p[s->len] = '\0';
+    return s->len;
+}
+
+static inline size_t lstr_from_cstr(lstr *s, const char *c) {
+    lstr_init(s);
+    return lstr_set(s, ls_cstr(c));
+}
+
+static inline void lstr_free(lstr *s) {
+    free(s->p);
+    lstr_init(s);
+}
+
+#endif /* LSTR_H */
@@ -0,0 +1,306 @@
+/*
+ * lstr_bench.c — lstr.h kernels vs libc, and a log-parsing workload.
+ *
+ * Part 1: raw kernels on a 64 MB buffer (GB/s)
+ *   ls_strlen vs strlen, ls_find_byte vs memchr, ls_find vs strstr/memmem,
+ *   ls_compare vs memcmp
+ *
+ * Part 2: parse a generated access log (one line per request):
+ *   2026-10-17T10:27:59 level=INFO user=u4821 path=/api/v1/items/77 status=200 ...
+ * counting lines, ERROR lines, lines that mention "timeout" and the total
+ * length of all path values. Three implementations:
+ *   libc   fgets + strlen + strtok + strchr + strcmp + strstr
+ *   mem*   mmap + memchr/memmem (lengths, but libc kernels)
+ *   lstr   mmap + ls_split/ls_find/ls_equal (no NUL anywhere)
+ *
+ *   gcc -O2 -march=native lstr_bench.c -o lstr_bench
+ *   ./lstr_bench                  # generates a 512 MB log in /tmp
+ *   ./lstr_bench 4096             # 4 GB
+ *   ./lstr_bench 0 my.log         # parse an existing file
+ */
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "lstr.h"
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* ---------- part 1: kernels ---------- */
+
+static void kernel_row(const char *name, double t, size_t bytes, size_t check) {
+    printf("  %-26s %6.2f GB/s   (%zu)\n", name, bytes / t * 1e-9, check);
+}
+
+static void bench_kernels(void) {
+    size_t n = 64u << 20;
+    char *a = malloc(n + 1), *b = malloc(n + 1);
+    for (size_t i = 0; i < n; i++)
+        a[i] = (char)('a' + i * 7 % 26);
+    a[n] = '\0';
+    memcpy(b, a, n + 1);
+    ls_view va = { a, n }, vb = { b, n };
+    int reps = 10;
+    size_t r = 0;
+    double t0;
+
+    printf("kernels on %zu MB (LS_W = %d)\n", n >> 20, LS_W);
+/* the empty asm hides a/b from the optimizer: otherwise it hoists the
+ * pure libc calls out of the loop and runs them once */
+#define KERNEL(name, expr)                                  \
+    t0 = now_sec();                                         \
+    for (int i = 0; i < reps; i++) {                        \
+        __asm__ volatile("" : "+r"(a), "+r"(b));            \
+        va.p = a;                                           \
+        vb.p = b;                                           \
+        r += (size_t)(expr);                                \
+    }                                                       \
+    kernel_row(name, (now_sec() - t0) / reps, n, r / reps); \
+    r = 0
+
+    KERNEL("strlen", strlen(a));
+    KERNEL("ls_strlen", ls_strlen(a));
+    KERNEL("memchr (absent)", memchr(a, '#', n) == NULL);
+    KERNEL("ls_find_byte (absent)", ls_find_byte(a, n, '#'));
+    KERNEL("strstr (absent)", strstr(a, "needle") == NULL);
+    KERNEL("memmem (absent)", memmem(a, n, "needle", 6) == NULL);
+    KERNEL("ls_find (absent)", ls_find(va, LS_LIT("needle")));
+    KERNEL("memcmp (equal)", memcmp(a, b, n) == 0);
+    KERNEL("ls_compare (equal)", ls_compare(va, vb) == 0);
+#undef KERNEL
+    free(a);
+    free(b);
+}
+
+/* ---------- part 2: log parsing ---------- */
+
+typedef struct {
+    size_t lines, errors, timeouts, path_bytes;
+} stats;
+
+static const char *levels[] = { "INFO", "INFO", "INFO", "DEBUG", "WARN", "ERROR" };
+static const char *msgs[] = {
+    "request served", "cache hit", "cache miss", "retrying", "upstream timeout",
+    "validation failed for field name",
+};
+
+static int generate(const char *path, size_t mb) {
+    FILE *f = fopen(path, "w");
+    if (!f)
+        return -1;
+    static char buf[1 << 16];
+    size_t used = 0, total = 0, target = mb << 20;
+    unsigned s = 12345;
+    while (total < target) {
+        s = s * 1103515245u + 12345u;
+        unsigned x = s >> 8;
+        int len = snprintf(buf + used, sizeof buf - used,
+                           "2026-10-17T%02u:%02u:%02u level=%s user=u%u path=/api/v1/items/%u "
+                           "status=%u latency_ms=%u msg=\"%s\"\n",
+                           x % 24, x / 24 % 60, x / 1440 % 60, levels[x % 6], x % 100000,
+                           x / 7 % 1000000, x % 6 == 5 ? 500u : 200u, x % 250,
+                           msgs[x / 3 % 6]);
+        used += (size_t)len;
+        total += (size_t)len;
+        if (used > sizeof buf - 256) {
+            fwrite(buf, 1, used, f);
+            used = 0;
+        }
+    }
+    fwrite(buf, 1, used, f);
+    return fclose(f);
+}
+
+static stats parse_libc(const char *path) {
+    stats st = { 0, 0, 0, 0 };
+    FILE *f = fopen(path, "r");
+    char line[4096];
+    while (fgets(line, sizeof line, f)) {
+        if (strlen(line) <= 1)
+            continue;
+        st.lines++;
+        if (strstr(line, "timeout"))
+            st.timeouts++;
+        char *save;
+        for (char *tok = strtok_r(line, " \n", &save); tok; tok = strtok_r(NULL, " \n", &save)) {
+            char *eq = strchr(tok, '=');
+            if (!eq)
+                continue;
+            *eq = '\0';
+            if (strcmp(tok, "level") == 0 && strcmp(eq + 1, "ERROR") == 0)
+                st.errors++;
+            else if (strcmp(tok, "path") == 0)
+                st.path_bytes += strlen(eq + 1);
+        }
+    }
+    fclose(f);
+    return st;
+}
+
+static const char *map_file(const char *path, size_t *size) {
+    int fd = open(path, O_RDONLY);
+    struct stat sb;
+    if (fd < 0 || fstat(fd, &sb) != 0)
+        return NULL;
+    *size = (size_t)sb.st_size;
+    const char *p = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        return NULL;
+    madvise((void *)p, *size, MADV_SEQUENTIAL);
+    return p;
+}
+
+static stats parse_mem(const char *p, size_t size) {
+    stats st = { 0, 0, 0, 0 };
+    const char *end = p + size;
+    while (p < end) {
+        const char *nl = memchr(p, '\n', (size_t)(end - p));
+        const char *le = nl ? nl : end;
+        size_t len = (size_t)(le - p);
+        if (len) {
+            st.lines++;
+            if (memmem(p, len, "timeout", 7))
+                st.timeouts++;
+            const char *f = p;
+            while (f < le) {
+                const char *sp = memchr(f, ' ', (size_t)(le - f));
+                const char *fe = sp ? sp : le;
+                const char *eq = memchr(f, '=', (size_t)(fe - f));
+                if (eq) {
+                    size_t kl = (size_t)(eq - f), vl = (size_t)(fe - eq - 1);
+                    if (kl == 5 && memcmp(f, "level", 5) == 0 && vl == 5 &&
+                        memcmp(eq + 1, "ERROR", 5) == 0)
+                        st.errors++;
+                    else if (kl == 4 && memcmp(f, "path", 4) == 0)
+                        st.path_bytes += vl;
+                }
+                f = fe + 1;
+            }
+        }
+        p = le + 1;
+    }
+    return st;
+}
+
+static stats parse_lstr(const char *p, size_t size) {
+    stats st = { 0, 0, 0, 0 };
+    ls_view rest = { p, size }, line, field;
+    while (ls_split(&rest, '\n', &line)) {
+        if (!line.len)
+            continue;
+        st.lines++;
+        if (ls_find(line, LS_LIT("timeout")) < line.len)
+            st.timeouts++;
+        while (ls_split(&line, ' ', &field)) {
+            size_t eq = ls_find_byte(field.p, field.len, '=');
+            if (eq == field.len)
+                continue;
+            ls_view key = ls_sub(field, 0, eq), val = ls_sub(field, eq + 1, field.len);
+            if (ls_equal(key, LS_LIT("level")) && ls_equal(val, LS_LIT("ERROR")))
+                st.errors++;
+            else if (ls_equal(key, LS_LIT("path")))
+                st.path_bytes += val.len;
+        }
+    }
+    return st;
+}
+
+static void parse_row(const char *name, double t, size_t size, stats st) {
+    printf("  %-6s %7.3f s  %6.2f GB/s   lines %zu, errors %zu, timeouts %zu, path bytes %zu\n",
+           name, t, size / t * 1e-9, st.lines, st.errors, st.timeouts, st.path_bytes);
+}
+
+/* Small fixed cases for the kernels, at every offset around a block. */
+static int selftest(void) {
+    char buf[160];
+    int ok = 1;
+    for (int n = 0; n < 100; n++)
+        for (int off = 0; off < LS_W; off++) {
+            char *s = buf + off;
+            memset(buf, 'x', sizeof buf);
+            s[n] = '\0';
+            ok &= ls_strlen(s) == (size_t)n;
+            ok &= ls_find_byte(s, (size_t)n + 1, '\0') == (size_t)n;
+            memcpy(s + (n > 3 ? n - 3 : 0), "abc", 3);
+            ls_view v = { s, (size_t)n };
+            size_t want = n >= 3 ? (size_t)n - 3 : (size_t)n;
+            ok &= ls_find(v, LS_LIT("abc")) == want;
+            ok &= ls_find(v, LS_LIT("abd")) == (size_t)n;
+        }
+    ok &= ls_compare(LS_LIT("abc"), LS_LIT("abd")) < 0;
+    ok &= ls_compare(LS_LIT("abc"), LS_LIT("ab")) > 0;
+    ok &= ls_compare(LS_LIT("0123456789abcdef0123456789abcdefX"),
+                     LS_LIT("0123456789abcdef0123456789abcdefY")) < 0;
+    ok &= ls_compare(LS_LIT("\xff"), LS_LIT("a")) > 0;
+    ls_view rest = LS_LIT("a,,b,"), t;
+    const char *want[] = { "a", "", "b", "" };
+    int k = 0;
+    while (ls_split(&rest, ',', &t))
+        ok &= k < 4 && ls_equal(t, ls_cstr(want[k++]));
+    ok &= k == 4;
+    lstr s;
+    ok &= lstr_from_cstr(&s, "Code") == 4;
+    ok &= lstr_append(&s, LS_LIT("Zailla")) == 10;
+    ok &= strcmp(s.p, "CodeZailla") == 0 && ls_strlen(s.p) == s.len;
+    ok &= lstr_append(&s, lstr_view(&s)) == 20;          /* grows out from under v */
+    ok &= strcmp(s.p, "CodeZaillaCodeZailla") == 0;
+    lstr_free(&s);
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    size_t mb = argc > 1 ? strtoull(argv[1], NULL, 10) : 512;
+    const char *path = argc > 2 ? argv[2] : "/tmp/lstr_bench.log";
+
+    printf("self-test: %s\n", selftest() ? "ok" : "FAILED");
+    bench_kernels();
+
+    if (mb) {
+        double t0 = now_sec();
+        if (generate(path, mb) != 0) {
+            perror(path);
+            return 1;
+        }
+        printf("generated %zu MB log in %.1f s\n", mb, now_sec() - t0);
+    }
+    size_t size;
+    const char *map = map_file(path, &size);
+    if (!map) {
+        perror(path);
+        return 1;
+    }
+    /* warm the page cache so all three read from memory */
+    volatile char sink = 0;
+    for (size_t i = 0; i < size; i += 4096)
+        sink ^= map[i];
+    (void)sink;
+
+    printf("parsing %s (%.1f MB)\n", path, size / 1048576.0);
+    double t0 = now_sec();
+    stats a = parse_libc(path);
+    parse_row("libc", now_sec() - t0, size, a);
+    t0 = now_sec();
+    stats b = parse_mem(map, size);
+    parse_row("mem*", now_sec() - t0, size, b);
+    t0 = now_sec();
+    stats c = parse_lstr(map, size);
+    parse_row("lstr", now_sec() - t0, size, c);
+    if (memcmp(&a, &b, sizeof a) || memcmp(&a, &c, sizeof a))
+        printf("  MISMATCH\n");
+
+    munmap((void *)map, size);
+    if (mb)
+        unlink(path);
+    return 0;
+}
@@ -0,0 +1,316 @@
+/* rope.h — editable text as a balanced tree of chunks.
+ *
+ * A flat buffer pays O(n) memmove for every insert or delete in the
+ * middle. A rope keeps the text in leaves of at most ROPE_LEAF bytes,
+ * organised as an *implicit treap*: in-order traversal gives the text,
+ * each node caches the length of its subtree, and random priorities keep
+ * the depth O(log n) expected.
+ *
+ *   rope_insert(r, pos, text)   O(log n + |text| / ROPE_LEAF)
+ *   rope_delete(r, pos, n)      O(log n + removed leaves)
+ *
+ * Both are split + merge. Small inserts that fit into the target leaf's
+ * spare room skip the restructuring and edit the leaf in place.
+ */
+#ifndef ROPE_H
+#define ROPE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lstr.h"       /* ls_view, lstr */
+
+#define ROPE_LEAF 1024
+#define ROPE_ERR  ((size_t)-1)
+/* Treap depth is ~3 log2(nodes) in practice; 256 is far beyond reach. */
+#define ROPE_MAX_DEPTH 256
+
+typedef struct rope_node {
+    struct rope_node *left, *right;
+    size_t            size;      /* bytes in this subtree */
+    uint32_t          prio;
+    uint32_t          n;         /* bytes in this node's own leaf */
+    char              text[ROPE_LEAF];
+} rope_node;
+
+typedef struct {
+    rope_node *root;
+    uint64_t   rng;
+} rope;
+
+static inline size_t rope_size(const rope_node *t) { return t ? t->size : 0; }
+
+static inline void rope_update(rope_node *t) {
+    t->size = rope_size(t->left) + t->n + rope_size(t->right);
+}
+
+static inline uint32_t rope_rand(rope *r) {
+    r->rng ^= r->rng << 13;
+    r->rng ^= r->rng >> 7;
+    r->rng ^= r->rng << 17;
+    return (uint32_t)(r->rng >> 32);
+}
+
+static inline rope_node *rope_leaf(rope *r, const char *p, size_t n) {
+    rope_node *t = malloc(sizeof *t);
+    if (!t)
+        return NULL;
+    t->left = t->right = NULL;
+    t->prio = rope_rand(r);
+    t->n = (uint32_t)n;
+    memcpy(t->text, p, n);
+    t->size = n;
+    return t;
+}
+
+/* Every key of a precedes every key of b. */
+static rope_node *rope_merge(rope_node *a, rope_node *b) {
+    if (!a)
+        return b;
+    if (!b)
+        return a;
+    if (a->prio >= b->prio) {
+        a->right = rope_merge(a->right, b);
+        rope_update(a);
+        return a;
+    }
+    b->left = rope_merge(a, b->left);
+    rope_update(b);
+    return b;
+}
+
+/* *l gets the first pos bytes, *r the rest. Splitting inside a leaf
+ * creates one node (same priority, so the heap order holds). Returns -1
+ * if that allocation fails; the tree is then unchanged. */
+static int rope_split(rope_node *t, size_t pos, rope_node **l, rope_node **r) {
+    if (!t) {
+        *l = *r = NULL;
+        return 0;
+    }
+    size_t ls = rope_size(t->left);
+    if (pos <= ls) {
+        rope_node *a, *b;
+        if (rope_split(t->left, pos, &a, &b) != 0)
+            return -1;
+        t->left = b;
+        rope_update(t);
+        *l = a;
+        *r = t;
+    } else if (pos >= ls + t->n) {
+        rope_node *a, *b;
+        if (rope_split(t->right, pos - ls - t->n, &a, &b) != 0)
+            return -1;
+        t->right = a;
+        rope_update(t);
+        *l = t;
+        *r = b;
+    } else {
+        size_t off = pos - ls;
+        rope_node *u = malloc(sizeof *u);
+        if (!u)
+            return -1;
+        u->n = t->n - (uint32_t)off;
+        memcpy(u->text, t->text + off, u->n);
+        u->prio = t->prio;
+        u->left = NULL;
+        u->right = t->right;
+        t->right = NULL;
+        t->n = (uint32_t)off;
+        rope_update(u);
+        rope_update(t);
+        *l = t;
+        *r = u;
+    }
+    return 0;
+}
+
+static void rope_free_tree(rope_node *t) {
+    while (t) {                       /* recurse left, loop right */
+        rope_free_tree(t->left);
+        rope_node *r = t->right;
+        free(t);
+        t = r;
+    }
+}
+
+/* Full leaves for v, merged into one subtree. */
+static rope_node *rope_build(rope *r, ls_view v) {
+    rope_node *t = NULL;
+    for (size_t off = 0; off < v.len; off += ROPE_LEAF) {
+        size_t n = v.len - off < ROPE_LEAF ? v.len - off : ROPE_LEAF;
+        rope_node *leaf = rope_leaf(r, v.p + off, n);
+        if (!leaf) {
+            rope_free_tree(t);
+            return NULL;
+        }
+        t = rope_merge(t, leaf);
+    }
+    return t;
+}
+
+static inline void rope_init(rope *r) {
+    r->root = NULL;
+    r->rng = 0x9e3779b97f4a7c15ull;
+}
+
+static inline size_t rope_len(const rope *r) { return rope_size(r->root); }
+
+static inline size_t rope_from(rope *r, ls_view v) {
+    rope_init(r);
+    if (v.len && !(r->root = rope_build(r, v)))
+        return ROPE_ERR;
+    return v.len;
+}
+
+/* Fast path: the insert point lies in (or at the end of) a leaf with
+ * enough spare room. Sizes on the path are bumped on the way down. */
+static int rope_insert_inplace(rope_node *t, size_t pos, ls_view v) {
+    rope_node *path[ROPE_MAX_DEPTH];
+    int depth = 0;
+    while (t && depth < ROPE_MAX_DEPTH) {
+        size_t ls = rope_size(t->left);
+        path[depth++] = t;
+        if (pos < ls || (pos == ls && t->left)) {
+            t = t->left;
+        } else if (pos <= ls + t->n) {
+            size_t off = pos - ls;
+            if (t->n + v.len > ROPE_LEAF)
+                return 0;
+            memmove(t->text + off + v.len, t->text + off, t->n - off);
+            memcpy(t->text + off, v.p, v.len);
+            t->n += (uint32_t)v.len;
+            for (int i = 0; i < depth; i++)
+                path[i]->size += v.len;
+            return 1;
+        } else {
+            pos -= ls + t->n;
+            t = t->right;
+        }
+    }
+    return 0;
+}
+
+/* Returns the new length, or ROPE_ERR (the rope is unchanged). */
+static size_t rope_insert(rope *r, size_t pos, ls_view v) {
+    size_t len = rope_len(r);
+    if (pos > len)
+        pos = len;
+    if (v.len == 0)
+        return len;
+    if (v.len <= ROPE_LEAF && rope_insert_inplace(r->root, pos, v))
+        return len + v.len;
+    rope_node *mid = rope_build(r, v), *a, *b;
+    if (!mid)
+        return ROPE_ERR;
+    if (rope_split(r->root, pos, &a, &b) != 0) {
+        rope_free_tree(mid);
+        return ROPE_ERR;
+    }
+    r->root = rope_merge(rope_merge(a, mid), b);
+    return len + v.len;
+}
+
+/* After a delete the two leaves that meet at the cut are often small;
+ * move the first leaf of *c into the last leaf of a when they fit, so
+ * repeated edits don't leave a trail of nearly empty nodes. */
+static void rope_join_edges(rope_node *a, rope_node **c) {
+    rope_node *pa[ROPE_MAX_DEPTH], *pc[ROPE_MAX_DEPTH], *t;
+    int na = 0, nc = 0;
+    for (t = a; t && na < ROPE_MAX_DEPTH; t = t->right)
+        pa[na++] = t;
+    for (t = *c; t && nc < ROPE_MAX_DEPTH; t = t->left)
+        pc[nc++] = t;
+    if (!na || !nc || pa[na - 1]->right || pc[nc - 1]->left)
+        return;
+    rope_node *last = pa[na - 1], *first = pc[nc - 1];
+    if (last->n + first->n > ROPE_LEAF)
+        return;
+    memcpy(last->text + last->n, first->text, first->n);
+    last->n += first->n;
+    for (int i = 0; i < na; i++)
+        pa[i]->size += first->n;
+    if (nc == 1)
+        *c = first->right;
+    else
+        pc[nc - 2]->left = first->right;
+    for (int i = 0; i < nc - 1; i++)
+        pc[i]->size -= first->n;
+    free(first);
+}
+
+/* Removes up to n bytes at pos. Returns the new length, or ROPE_ERR. */
+static size_t rope_delete(rope *r, size_t pos, size_t n) {
+    size_t len = rope_len(r);
+    if (pos >= len || n == 0)
+        return len;
+    if (n > len - pos)
+        n = len - pos;
+    rope_node *a, *b, *m, *c;
+    if (rope_split(r->root, pos, &a, &b) != 0)
+        return ROPE_ERR;
+    if (rope_split(b, n, &m, &c) != 0) {
+        r->root = rope_merge(a, b);
+        return ROPE_ERR;
+    }
+    rope_free_tree(m);
+    rope_join_edges(a, &c);
+    r->root = rope_merge(a, c);
+    return len - n;
+}
+
+/* Copies up to n bytes starting at pos into out; returns bytes copied. */
+static size_t rope_read(const rope *r, size_t pos, char *out, size_t n) {
+    size_t done = 0;
+    const rope_node *t = r->root;
+    /* descend to the node holding pos, remembering ancestors we went left
+     * from: they come next in order */
+    const rope_node *stack[ROPE_MAX_DEPTH];
+    int sp = 0;
+    while (t && done < n) {
+        size_t ls = rope_size(t->left);
+        if (pos < ls) {
+            if (sp == ROPE_MAX_DEPTH)
+                break;
+            stack[sp++] = t;
+            t = t->left;
+            continue;
+        }
+        pos -= ls;
+        if (pos < t->n) {
+            size_t k = t->n - pos < n - done ? t->n - pos : n - done;
+            memcpy(out + done, t->text + pos, k);
+            done += k;
+            pos = 0;
+        } else {
+            pos -= t->n;
+        }
+        /* continue in order: right subtree (from its start), then ancestors */
+        if (t->right) {
+            t = t->right;
+        } else if (sp) {
+            t = stack[--sp];
+            pos = rope_size(t->left);         /* resume at this node's own text */
+        } else {
+            t = NULL;
+        }
+    }
+    return done;
+}
+
+static size_t rope_flatten(const rope *r, lstr *out) {
+    size_t len = rope_len(r);
+    lstr_init(out);
+    if (lstr_reserve(out, len) == LSTR_ERR)
+        return ROPE_ERR;
+    rope_read(r, 0, out->p, len);
+    out->p[len] = '\0';
+    return out->len = len;
+}
+
+static inline void rope_free(rope *r) {
+    rope_free_tree(r->root);
+    r->root = NULL;
+}
+
+#endif /* ROPE_H */
@@ -0,0 +1,184 @@
+/*
+ * sso_bench.c — char *name = malloc(...) vs sso_str for short names.
+ *
+ * Workload (like a user table being refreshed): N names, each
+ * "user_<8 digits>" (13 bytes) with every 16th one a long path-like name
+ * (> 23 bytes), are copied into a table of M slots, replacing whatever
+ * was there. Every 8th name is also compared against its slot neighbour.
+ *
+ *   malloc   malloc(strlen + 1) + strcpy per name, free on replace
+ *   sso      sso_from into a temporary, sso_move into the slot
+ *
+ * malloc/realloc/free are counted through wrappers.
+ *
+ *   gcc -O2 sso_bench.c -o sso_bench
+ *   ./sso_bench               # 100M names, 1M slots
+ *   ./sso_bench 10000000 100000
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* ---------- allocation counting ---------- */
+
+static size_t n_malloc, n_free;
+
+static void *counted_malloc(size_t n) { n_malloc++; return malloc(n); }
+static void *counted_realloc(void *p, size_t n) { n_malloc += !p; return realloc(p, n); }
+static void counted_free(void *p) { n_free += p != NULL; free(p); }
+
+/* <stdlib.h> is already in: from here on the headers below use the
+ * counting versions. */
+#define malloc(n)     counted_malloc(n)
+#define realloc(p, n) counted_realloc(p, n)
+#define free(p)       counted_free(p)
+
+#include "sso_str.h"
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Writes the i-th name into buf and returns its length. */
+static size_t make_name(char *buf, size_t i) {
+    static const char long_prefix[] = "engineering/platform/";
+    size_t n = 0;
+    if (i % 16 == 15) {
+        memcpy(buf, long_prefix, sizeof long_prefix - 1);
+        n = sizeof long_prefix - 1;
+    }
+    memcpy(buf + n, "user_", 5);
+    n += 5;
+    size_t v = i * 2654435761u % 100000000u;
+    for (int d = 7; d >= 0; d--, v /= 10)
+        buf[n + (size_t)d] = (char)('0' + v % 10);
+    n += 8;
+    buf[n] = '\0';
+    return n;
+}
+
+/* Names are generated once, up front, so the timed loops measure string
+ * handling and not integer formatting. */
+#define NAME_POOL 65536
+
+static char   pool_text[NAME_POOL][48];
+static size_t pool_len[NAME_POOL];
+
+static void build_pool(void) {
+    for (size_t i = 0; i < NAME_POOL; i++)
+        pool_len[i] = make_name(pool_text[i], i);
+}
+
+typedef struct {
+    double sec;
+    size_t allocs, frees, equal;
+    size_t bytes;              /* table + heap payload at the end */
+} result;
+
+static result run_malloc(size_t n, size_t m) {
+    char **table = calloc(m, sizeof *table);
+    size_t equal = 0;
+    n_malloc = n_free = 0;
+    double t0 = now_sec();
+    for (size_t i = 0; i < n; i++) {
+        const char *src = pool_text[i % NAME_POOL];
+        char *name = malloc(strlen(src) + 1);
+        strcpy(name, src);
+        size_t slot = i % m;
+        free(table[slot]);
+        table[slot] = name;
+        if (i % 8 == 0 && slot && strcmp(table[slot], table[slot - 1]) == 0)
+            equal++;
+    }
+    double sec = now_sec() - t0;
+    size_t bytes = m * sizeof *table;
+    for (size_t s = 0; s < m; s++)
+        if (table[s])
+            bytes += (strlen(table[s]) + 1 + 8 + 15) & ~(size_t)15;   /* glibc chunk */
+    result r = { sec, n_malloc, n_free, equal, bytes };
+    for (size_t s = 0; s < m; s++)
+        free(table[s]);
+    free(table);
+    return r;
+}
+
+static result run_sso(size_t n, size_t m) {
+    sso_str *table = calloc(m, sizeof *table);
+    for (size_t s = 0; s < m; s++)
+        sso_init(&table[s]);
+    size_t equal = 0;
+    n_malloc = n_free = 0;
+    double t0 = now_sec();
+    for (size_t i = 0; i < n; i++) {
+        sso_str name;
+        sso_from(&name, (ls_view){ pool_text[i % NAME_POOL], pool_len[i % NAME_POOL] });
+        size_t slot = i % m;
+        sso_move(&table[slot], &name);        /* frees the old one, no copy */
+        if (i % 8 == 0 && slot &&
+            ls_equal(sso_view(&table[slot]), sso_view(&table[slot - 1])))
+            equal++;
+    }
+    double sec = now_sec() - t0;
+    size_t bytes = m * sizeof *table;
+    for (size_t s = 0; s < m; s++)
+        if (sso_is_heap(&table[s]))
+            bytes += (sso_capacity(&table[s]) + 1 + 8 + 15) & ~(size_t)15;
+    result r = { sec, n_malloc, n_free, equal, bytes };
+    for (size_t s = 0; s < m; s++)
+        sso_free(&table[s]);
+    free(table);
+    return r;
+}
+
+static void report(const char *name, result r, size_t n) {
+    printf("%-7s %7.2f s  %6.1f M names/s  %11zu mallocs  %11zu frees  %7.1f MB table  (eq %zu)\n",
+           name, r.sec, n / r.sec * 1e-6, r.allocs, r.frees, r.bytes / 1e6, r.equal);
+}
+
+static int selftest(void) {
+    int ok = 1;
+    sso_str a, b;
+    ok &= sso_from(&a, LS_LIT("")) == 0 && !sso_is_heap(&a) && sso_cstr(&a)[0] == '\0';
+    ok &= sso_assign(&a, LS_LIT("12345678901234567890123")) == 23;   /* exactly full */
+    ok &= !sso_is_heap(&a) && strlen(sso_cstr(&a)) == 23;
+    ok &= sso_append(&a, LS_LIT("4")) == 24 && sso_is_heap(&a);
+    ok &= strcmp(sso_cstr(&a), "123456789012345678901234") == 0;
+    sso_init(&b);
+    ok &= sso_copy(&b, &a) == 24 && ls_equal(sso_view(&a), sso_view(&b));
+    ok &= sso_move(&b, &a) == 24 && sso_len(&a) == 0 && !sso_is_heap(&a);
+    ok &= sso_assign(&b, LS_LIT("short")) == 5 && sso_is_heap(&b);   /* keeps its block */
+    sso_swap(&a, &b);
+    ok &= sso_len(&a) == 5 && sso_len(&b) == 0;
+    for (size_t i = 0; i < 40; i++)
+        ok &= sso_append(&b, LS_LIT("x")) == i + 1 && strlen(sso_cstr(&b)) == i + 1;
+    sso_free(&a);
+    sso_free(&b);
+    /* self-append: stays inline, leaves the struct, grows the heap block */
+    ok &= sso_from(&a, LS_LIT("abc")) == 3 && sso_append(&a, sso_view(&a)) == 6;
+    ok &= !sso_is_heap(&a) && strcmp(sso_cstr(&a), "abcabc") == 0;
+    ok &= sso_assign(&a, LS_LIT("0123456789ab")) == 12 && sso_append(&a, sso_view(&a)) == 24;
+    ok &= sso_is_heap(&a) && strcmp(sso_cstr(&a), "0123456789ab0123456789ab") == 0;
+    ok &= sso_append(&a, sso_view(&a)) == 48;
+    ok &= strcmp(sso_cstr(&a), "0123456789ab0123456789ab0123456789ab0123456789ab") == 0;
+    sso_free(&a);
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    size_t n = argc > 1 ? strtoull(argv[1], NULL, 10) : 100000000;
+    size_t m = argc > 2 ? strtoull(argv[2], NULL, 10) : 1000000;
+    printf("self-test: %s, sizeof(sso_str) = %zu, inline capacity %d\n",
+           selftest() ? "ok" : "FAILED", sizeof(sso_str), SSO_CAP);
+    build_pool();
+    printf("%zu names (1 in 16 longer than %d bytes) into %zu slots\n", n, SSO_CAP, m);
+    result a = run_malloc(n, m);
+    report("malloc", a, n);
+    result b = run_sso(n, m);
+    report("sso", b, n);
+    printf("speedup %.2fx, %.1fx fewer allocations\n", a.sec / b.sec,
+           (double)a.allocs / (b.allocs ? b.allocs : 1));
+    return a.equal == b.equal ? 0 : 1;
+}
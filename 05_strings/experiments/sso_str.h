@@ -0,0 +1,175 @@
+/* sso_str.h — 24-byte string with small-string optimization.
+ *
+ * Strings of up to SSO_CAP (23) bytes live *inside* the struct; longer
+ * ones move to the heap. Both modes share the same 24 bytes:
+ *
+ *   small:  [ buf[0..22] .................... | 23 - len ]
+ *   heap:   [ char *p | size_t len | size_t cap (top bit = heap flag) ]
+ *
+ * The last byte holds the *remaining* inline room, so a full 23-byte
+ * string ends with 0 there — the counter doubles as the NUL terminator.
+ * In heap mode the same byte is the top byte of cap (little-endian) and
+ * carries the heap flag, so capacities stay below 2^63.
+ *
+ * Builds on ls_view from lstr.h; lengths are returned, never rescanned.
+ */
+#ifndef SSO_STR_H
+#define SSO_STR_H
+
+#include <stdint.h>
+#include <stdlib.h>   /* malloc, realloc, free */
+#include <string.h>   /* memcpy, memmove */
+
+#include "lstr.h"     /* ls_view */
+
+#define SSO_CAP 23
+#define SSO_ERR ((size_t)-1)
+
+typedef union {
+    struct {
+        char  *p;
+        size_t len;
+        size_t cap;            /* encoded, see sso_cap_encode() */
+    } heap;
+    struct {
+        char          buf[SSO_CAP];
+        unsigned char room;    /* SSO_CAP - len; 0x80 bit set = heap */
+    } small;
+} sso_str;
+
+_Static_assert(sizeof(sso_str) == 24, "sso_str must stay 24 bytes");
+
+/* The flag must land in the last byte of `cap` whatever the byte order. */
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define SSO_CAP_FLAG ((size_t)0x80)
+static inline size_t sso_cap_encode(size_t cap) { return cap << 8 | SSO_CAP_FLAG; }
+static inline size_t sso_cap_decode(size_t enc) { return enc >> 8; }
+#else
+#define SSO_CAP_FLAG ((size_t)1 << (sizeof(size_t) * 8 - 1))
+static inline size_t sso_cap_encode(size_t cap) { return cap | SSO_CAP_FLAG; }
+static inline size_t sso_cap_decode(size_t enc) { return enc & ~SSO_CAP_FLAG; }
+#endif
+
+static inline int sso_is_heap(const sso_str *s) {
+    return s->small.room & 0x80;
+}
+
+static inline void sso_init(sso_str *s) {
+    s->small.buf[0] = '\0';
+    s->small.room = SSO_CAP;
+}
+
+static inline size_t sso_len(const sso_str *s) {
+    return sso_is_heap(s) ? s->heap.len : (size_t)(SSO_CAP - s->small.room);
+}
+
+static inline size_t sso_capacity(const sso_str *s) {
+    return sso_is_heap(s) ? sso_cap_decode(s->heap.cap) : SSO_CAP;
+}
+
+/* Always NUL-terminated, in both modes. */
+static inline const char *sso_cstr(const sso_str *s) {
+    return sso_is_heap(s) ? s->heap.p : s->small.buf;
+}
+
+static inline ls_view sso_view(const sso_str *s) {
+    return (ls_view){ sso_cstr(s), sso_len(s) };
+}
+
+static inline void sso_set_len(sso_str *s, size_t len) {
+    if (sso_is_heap(s)) {
+        s->heap.len = len;
+        s->heap.p[len] = '\0';
+    } else {
+        if (len < SSO_CAP)
+            s->small.buf[len] = '\0';
+        s->small.room = (unsigned char)(SSO_CAP - len);   /* 0 == NUL at 23 */
+    }
+}
+
+/* Makes room for `need` bytes (plus NUL). Moves to the heap only when the
+ * inline buffer is too small. Returns the capacity or SSO_ERR. */
+static inline size_t sso_reserve(sso_str *s, size_t need) {
+    size_t cap = sso_capacity(s);
+    if (need <= cap)
+        return cap;
+    while (cap < need)
+        cap = cap * 2 + 1;
+    if (sso_is_heap(s)) {
+        char *p = realloc(s->heap.p, cap + 1);
+        if (!p)
+            return SSO_ERR;
+        s->heap.p = p;
+    } else {
+        size_t len = SSO_CAP - s->small.room;
+        char *p = malloc(cap + 1);
+        if (!p)
+            return SSO_ERR;
+        memcpy(p, s->small.buf, len + 1);
+        p[len] = '\0';
+        s->heap.p = p;
+        s->heap.len = len;
+    }
+    s->heap.cap = sso_cap_encode(cap);
+    return cap;
+}
+
+/* Copy v in; returns the new length or SSO_ERR. */
+static inline size_t sso_assign(sso_str *s, ls_view v) {
+    if (sso_reserve(s, v.len) == SSO_ERR)
+        return SSO_ERR;
+    memmove((char *)sso_cstr(s), v.p, v.len);
+    sso_set_len(s, v.len);
+    return v.len;
+}
+
+static inline size_t sso_from(sso_str *s, ls_view v) {
+    sso_init(s);
+    return sso_assign(s, v);
+}
+
+/* v may point into s itself (sso_append(s, sso_view(s))): growing moves the
+ * bytes, from the struct or the old block, so v is rebased onto the new ones. */
+static inline size_t sso_append(sso_str *s, ls_view v) {
+    size_t len = sso_len(s);
+    uintptr_t at = (uintptr_t)v.p, base = (uintptr_t)sso_cstr(s);
+    int self = at >= base && at <= base + len;
+    if (sso_reserve(s, len + v.len) == SSO_ERR)
+        return SSO_ERR;
+    if (self)
+        v.p = sso_cstr(s) + (at - base);
+    memcpy((char *)sso_cstr(s) + len, v.p, v.len);
+    sso_set_len(s, len + v.len);
+    return len + v.len;
+}
+
+static inline void sso_free(sso_str *s) {
+    if (sso_is_heap(s))
+        free(s->heap.p);
+    sso_init(s);
+}
+
+/* Ownership transfer: dst takes src's bytes (or its heap block) with a
+ * 24-byte copy and no allocation; src is left empty. dst's old contents
+ * are released. Returns the length moved. */
+static inline size_t sso_move(sso_str *dst, sso_str *src) {
+    if (dst == src)
+        return sso_len(dst);
+    sso_free(dst);
+    *dst = *src;
+    sso_init(src);
+    return sso_len(dst);
+}
+
+static inline void sso_swap(sso_str *a, sso_str *b) {
+    sso_str t = *a;
+    *a = *b;
+    *b = t;
+}
+
+/* Deep copy; short strings never touch the allocator. */
+static inline size_t sso_copy(sso_str *dst, const sso_str *src) {
+    return sso_assign(dst, sso_view(src));
+}
+
+#endif /* SSO_STR_H */
@@ -0,0 +1,191 @@
+/* str_builder.h — append-only string builder over a list of chunks.
+ *
+ * The realloc notes grow one buffer and strcat() into it: every append
+ * rescans the whole string (quadratic) and every growth may copy it all.
+ * Here bytes are appended into the tail chunk; a full chunk is never
+ * moved, the next one is simply twice as large (up to SB_MAX_CHUNK). The
+ * text is assembled once at the end:
+ *
+ *   sb_flatten   one exact-size allocation, one memcpy per chunk
+ *   sb_writev    straight to a file descriptor, no flattening at all
+ *
+ * Errors are sticky: after a failed allocation every later append is a
+ * no-op returning SB_ERR, and sb_free() still releases everything — there
+ * is no half-grown buffer to leak.
+ */
+#ifndef STR_BUILDER_H
+#define STR_BUILDER_H
+
+#include <errno.h>
+#include <limits.h>     /* IOV_MAX                   */
+#include <stdarg.h>
+#include <stdio.h>      /* vsnprintf                 */
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>    /* writev, struct iovec      */
+
+#include "lstr.h"       /* ls_view, lstr             */
+
+#define SB_MIN_CHUNK (4u << 10)
+#define SB_MAX_CHUNK (1u << 20)
+#define SB_ERR       ((size_t)-1)
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+typedef struct sb_chunk {
+    struct sb_chunk *next;
+    size_t           used, cap;
+    char             data[];
+} sb_chunk;
+
+typedef struct {
+    sb_chunk *head, *tail;
+    size_t    len;             /* total bytes appended */
+    size_t    nchunks;
+    int       failed;
+} strbuf;
+
+static inline void sb_init(strbuf *b) {
+    b->head = b->tail = NULL;
+    b->len = b->nchunks = 0;
+    b->failed = 0;
+}
+
+/* Adds a chunk with room for at least `need` bytes. */
+static inline sb_chunk *sb_grow(strbuf *b, size_t need) {
+    size_t cap = b->tail ? b->tail->cap * 2 : SB_MIN_CHUNK;
+    if (cap > SB_MAX_CHUNK)
+        cap = SB_MAX_CHUNK;
+    if (cap < need)
+        cap = need;
+    sb_chunk *c = malloc(sizeof *c + cap);
+    if (!c) {
+        b->failed = 1;
+        return NULL;
+    }
+    c->next = NULL;
+    c->used = 0;
+    c->cap = cap;
+    if (b->tail)
+        b->tail->next = c;
+    else
+        b->head = c;
+    b->tail = c;
+    b->nchunks++;
+    return c;
+}
+
+/* Returns the total length so far, or SB_ERR. Large appends fill the
+ * current chunk first, so chunks stay full. */
+static inline size_t sb_append(strbuf *b, ls_view v) {
+    if (b->failed)
+        return SB_ERR;
+    sb_chunk *c = b->tail;
+    size_t room = c ? c->cap - c->used : 0;
+    if (v.len <= room) {                      /* the common case */
+        memcpy(c->data + c->used, v.p, v.len);
+        c->used += v.len;
+        return b->len += v.len;
+    }
+    if (room) {
+        memcpy(c->data + c->used, v.p, room);
+        c->used += room;
+    }
+    if (!(c = sb_grow(b, v.len - room)))
+        return SB_ERR;
+    memcpy(c->data, v.p + room, v.len - room);
+    c->used = v.len - room;
+    return b->len += v.len;
+}
+
+/* printf into the builder: formats straight into the tail chunk, and
+ * only retries in a fresh chunk if it didn't fit. */
+__attribute__((format(printf, 2, 3)))
+static inline size_t sb_appendf(strbuf *b, const char *fmt, ...) {
+    if (b->failed)
+        return SB_ERR;
+    va_list ap;
+    sb_chunk *c = b->tail;
+    size_t room = c ? c->cap - c->used : 0;
+    va_start(ap, fmt);
+    int n = vsnprintf(c ? c->data + c->used : NULL, room, fmt, ap);
+    va_end(ap);
+    if (n < 0) {
+        b->failed = 1;
+        return SB_ERR;
+    }
+    if ((size_t)n >= room) {                  /* needs n + 1 for the NUL */
+        if (!(c = sb_grow(b, (size_t)n + 1)))
+            return SB_ERR;
+        va_start(ap, fmt);
+        vsnprintf(c->data, c->cap, fmt, ap);
+        va_end(ap);
+    }
+    c->used += (size_t)n;
+    return b->len += (size_t)n;
+}
+
+/* One allocation of exactly len + 1 bytes. Returns the length or SB_ERR. */
+static inline size_t sb_flatten(const strbuf *b, lstr *out) {
+    lstr_init(out);
+    if (b->failed || lstr_reserve(out, b->len) == LSTR_ERR)
+        return SB_ERR;
+    char *p = out->p;
+    for (const sb_chunk *c = b->head; c; c = c->next) {
+        memcpy(p, c->data, c->used);
+        p += c->used;
+    }
+    *p = '\0';
+    return out->len = b->len;
+}
+
+/* Writes every chunk with writev(), IOV_MAX chunks per call, resuming
+ * after short writes. Returns bytes written, or SB_ERR with errno set. */
+static inline size_t sb_writev(const strbuf *b, int fd) {
+    struct iovec iov[64 < IOV_MAX ? 64 : IOV_MAX];
+    const int max = (int)(sizeof iov / sizeof iov[0]);
+    const sb_chunk *c = b->head;
+    size_t skip = 0, total = 0;               /* bytes of *c already written */
+    if (b->failed) {
+        errno = ENOMEM;
+        return SB_ERR;
+    }
+    while (c) {
+        int n = 0;
+        const sb_chunk *d = c;
+        for (size_t off = skip; d && n < max; d = d->next, off = 0)
+            if (d->used > off)
+                iov[n++] = (struct iovec){ (char *)d->data + off, d->used - off };
+        if (n == 0)
+            break;
+        ssize_t w = writev(fd, iov, n);
+        if (w < 0) {
+            if (errno == EINTR)
+                continue;
+            return SB_ERR;
+        }
+        total += (size_t)w;
+        /* advance (c, skip) past w bytes */
+        size_t left = (size_t)w;
+        while (c && left >= c->used - skip) {
+            left -= c->used - skip;
+            skip = 0;
+            c = c->next;
+        }
+        skip += left;
+    }
+    return total;
+}
+
+static inline void sb_free(strbuf *b) {
+    while (b->head) {
+        sb_chunk *n = b->head->next;
+        free(b->head);
+        b->head = n;
+    }
+    sb_init(b);
+}
+
+#endif /* STR_BUILDER_H */
@@ -0,0 +1,365 @@
+/*
+ * text_bench.c — building and editing large text: strcat vs realloc vs
+ * strbuf, and flat-buffer edits vs a rope.
+ *
+ * Part 1: assemble a log of ~100-byte lines and write it to a file.
+ *   strcat    realloc by exact size + strcat (256 KB - 1 MB only: quadratic)
+ *   realloc   capacity doubling + memcpy at a tracked length
+ *   strbuf    chunk list, then sb_flatten + write, or sb_writev directly
+ *
+ * Part 2: random 16-byte inserts and deletes in a large text.
+ *   flat      memmove in one buffer
+ *   rope      rope_insert / rope_delete
+ *
+ *   gcc -O2 text_bench.c -o text_bench
+ *   ./text_bench              # 1024 MB log, 64 MB rope text, 200000 edits
+ *   ./text_bench 256 16 50000
+ */
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "str_builder.h"
+#include "rope.h"
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint64_t rng_state = 88172645463325252ull;
+
+static uint64_t rng(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+/* ---------- part 1: log assembly ---------- */
+
+/* Writes log line i (with '\n') into buf; returns its length. */
+static size_t make_line(char *buf, size_t i) {
+    static const char *lvl[] = { "INFO ", "DEBUG", "WARN ", "ERROR" };
+    static const char *msg[] = {
+        "request served from cache",
+        "upstream connection reset, retrying",
+        "slow query detected on orders table",
+        "session expired for client",
+    };
+    return (size_t)sprintf(buf, "2024-05-%02zu %02zu:%02zu:%02zu.%03zu [%s] worker-%02zu: %s (id=%zu)\n",
+                           1 + i / 86400000 % 28, i / 3600000 % 24, i / 60000 % 60,
+                           i / 1000 % 60, i % 1000, lvl[i % 4], i % 16, msg[i / 4 % 4], i);
+}
+
+/* Lines are formatted once, up front, so the timed loops measure
+ * assembly and not sprintf. */
+#define LINE_POOL 4096
+
+static char   line_text[LINE_POOL][128];
+static size_t line_len[LINE_POOL];
+static size_t pool_bytes;                    /* one pass over the pool */
+
+static void build_lines(void) {
+    for (size_t i = 0; i < LINE_POOL; i++) {
+        line_len[i] = make_line(line_text[i], i * 7919);
+        pool_bytes += line_len[i];
+    }
+}
+
+static size_t lines_for(size_t bytes) {
+    return bytes / (pool_bytes / LINE_POOL);
+}
+
+static size_t run_strcat(size_t lines, char **out) {
+    char *s = calloc(1, 1);
+    size_t len = 0;
+    for (size_t i = 0; i < lines; i++) {
+        len += line_len[i % LINE_POOL];
+        s = realloc(s, len + 1);
+        strcat(s, line_text[i % LINE_POOL]);   /* rescans everything so far */
+    }
+    *out = s;
+    return len;
+}
+
+static size_t run_realloc(size_t lines, char **out) {
+    size_t len = 0, cap = 4096;
+    char *s = malloc(cap);
+    for (size_t i = 0; i < lines; i++) {
+        size_t n = line_len[i % LINE_POOL];
+        if (len + n + 1 > cap) {
+            cap *= 2;
+            char *t = realloc(s, cap);
+            if (!t) {
+                free(s);
+                *out = NULL;
+                return 0;
+            }
+            s = t;
+        }
+        memcpy(s + len, line_text[i % LINE_POOL], n);
+        len += n;
+    }
+    s[len] = '\0';
+    *out = s;
+    return len;
+}
+
+static size_t run_strbuf(size_t lines, strbuf *b) {
+    sb_init(b);
+    size_t len = 0;
+    for (size_t i = 0; i < lines; i++)
+        len = sb_append(b, (ls_view){ line_text[i % LINE_POOL], line_len[i % LINE_POOL] });
+    return len;
+}
+
+static int write_all(int fd, const char *p, size_t n) {
+    while (n) {
+        ssize_t w = write(fd, p, n);
+        if (w < 0)
+            return -1;
+        p += w;
+        n -= (size_t)w;
+    }
+    return 0;
+}
+
+static int open_tmp(char *path) {
+    strcpy(path, "/tmp/text_bench_XXXXXX");
+    return mkstemp(path);
+}
+
+static void part_log(size_t mb) {
+    char path[32];
+    size_t target = mb << 20;
+
+    printf("\n-- log assembly (%zu-byte lines on average) --\n", pool_bytes / LINE_POOL);
+    for (size_t small = 256; small <= 1024; small *= 2) {
+        size_t lines = lines_for(small << 10);
+        char *a, *b;
+        double t0 = now_sec();
+        size_t la = run_strcat(lines, &a);
+        double t1 = now_sec();
+        size_t lb = run_realloc(lines, &b);
+        double t2 = now_sec();
+        printf("%4zu KB: strcat %8.3f s   realloc %8.4f s   %s\n", small, t1 - t0, t2 - t1,
+               la == lb && memcmp(a, b, la) == 0 ? "same" : "DIFFERENT");
+        free(a);
+        free(b);
+    }
+
+    size_t lines = lines_for(target);
+    printf("%zu MB, %zu lines:\n", mb, lines);
+
+    char *flat;
+    double t0 = now_sec();
+    size_t lf = run_realloc(lines, &flat);
+    double t1 = now_sec();
+    int fd = open_tmp(path);
+    unlink(path);
+    write_all(fd, flat, lf);
+    double t2 = now_sec();
+    close(fd);
+    printf("realloc        build %6.3f s                  + write %6.3f s  = %6.3f s\n", t1 - t0, t2 - t1, t2 - t0);
+
+    strbuf sb;
+    t0 = now_sec();
+    size_t ls = run_strbuf(lines, &sb);
+    t1 = now_sec();
+    lstr joined;
+    sb_flatten(&sb, &joined);
+    double tf = now_sec();
+    fd = open_tmp(path);
+    unlink(path);
+    write_all(fd, joined.p, joined.len);
+    t2 = now_sec();
+    close(fd);
+    int same = ls == lf && joined.len == lf && memcmp(joined.p, flat, lf) == 0;
+    lstr_free(&joined);
+    free(flat);
+    printf("strbuf+flatten build %6.3f s  + flatten %6.3f s + write %6.3f s  = %6.3f s  (%zu chunks)\n",
+           t1 - t0, tf - t1, t2 - tf, t2 - t0, sb.nchunks);
+
+    fd = open_tmp(path);
+    double t3 = now_sec();
+    size_t w = sb_writev(&sb, fd);
+    double t4 = now_sec();
+    close(fd);
+    printf("strbuf+writev  build %6.3f s                 + writev %6.3f s  = %6.3f s\n",
+           t1 - t0, t4 - t3, (t1 - t0) + (t4 - t3));
+    same &= w == ls;
+
+    /* read back the file and compare against a fresh build */
+    fd = open(path, O_RDONLY);
+    unlink(path);
+    char *back = malloc(ls ? ls : 1);
+    size_t got = 0;
+    ssize_t r;
+    while (got < ls && (r = read(fd, back + got, ls - got)) > 0)
+        got += (size_t)r;
+    close(fd);
+    size_t off = 0;
+    for (sb_chunk *c = sb.head; c && same; c = c->next) {
+        same = off + c->used <= got && memcmp(back + off, c->data, c->used) == 0;
+        off += c->used;
+    }
+    same &= off == got;
+    free(back);
+    sb_free(&sb);
+    printf("outputs %s\n", same ? "identical" : "DIFFERENT");
+}
+
+/* ---------- part 2: edits ---------- */
+
+static void part_edit(size_t mb, size_t edits) {
+    size_t len = mb << 20;
+    char *flat = malloc(len + edits * 16 + 1);
+    for (size_t i = 0; i < len; i++)
+        flat[i] = (char)('a' + rng() % 26);
+
+    rope r;
+    double t0 = now_sec();
+    rope_from(&r, (ls_view){ flat, len });
+    double t1 = now_sec();
+    printf("\n-- %zu random 16-byte edits in %zu MB (half inserts, half deletes) --\n", edits, mb);
+    printf("rope build  %.3f s\n", t1 - t0);
+
+    /* the flat buffer is slow: run a slice of the edits, same sequence */
+    size_t flat_edits = edits / 100 ? edits / 100 : 1;
+    uint64_t seed = rng_state;
+    size_t flen = len;
+    t0 = now_sec();
+    for (size_t e = 0; e < flat_edits; e++) {
+        size_t pos = rng() % (flen + 1);
+        if (e % 2 == 0) {
+            memmove(flat + pos + 16, flat + pos, flen - pos);
+            memcpy(flat + pos, "<inserted text!>", 16);
+            flen += 16;
+        } else {
+            size_t n = flen - pos < 16 ? flen - pos : 16;
+            memmove(flat + pos, flat + pos + n, flen - pos - n);
+            flen -= n;
+        }
+    }
+    t1 = now_sec();
+    double flat_ns = (t1 - t0) / flat_edits * 1e9;
+
+    rng_state = seed;
+    size_t rlen = len;
+    t0 = now_sec();
+    for (size_t e = 0; e < edits; e++) {
+        size_t pos = rng() % (rlen + 1);
+        if (e % 2 == 0)
+            rlen = rope_insert(&r, pos, LS_LIT("<inserted text!>"));
+        else
+            rlen = rope_delete(&r, pos, 16);
+        if (e + 1 == flat_edits) {            /* checkpoint against flat */
+            double c0 = now_sec();
+            lstr check;
+            rope_flatten(&r, &check);
+            printf("after %zu edits rope %s flat buffer\n", flat_edits,
+                   check.len == flen && memcmp(check.p, flat, flen) == 0 ? "==" : "!=");
+            lstr_free(&check);
+            t0 += now_sec() - c0;             /* don't time the check */
+        }
+    }
+    double t2 = now_sec();
+    double rope_ns = (t2 - t0) / edits * 1e9;
+    printf("flat  %10.0f ns/edit  (%zu edits, memmove of ~%zu MB each)\n", flat_ns, flat_edits, mb / 2);
+    printf("rope  %10.0f ns/edit  (%zu edits)\n", rope_ns, edits);
+    printf("rope is %.0fx faster per edit; %zu edits flat would take ~%.1f s\n",
+           flat_ns / rope_ns, edits, flat_ns * edits * 1e-9);
+
+    char probe[64];
+    size_t got = rope_read(&r, rlen / 2, probe, sizeof probe - 1);
+    probe[got] = '\0';
+    printf("final length %zu, middle: \"%.32s…\"\n", rope_len(&r), probe);
+
+    rope_free(&r);
+    free(flat);
+}
+
+/* ---------- self-test ---------- */
+
+static int selftest(void) {
+    int ok = 1;
+
+    /* strbuf: appends across chunk boundaries, appendf, flatten, writev */
+    strbuf b;
+    sb_init(&b);
+    char big[10000];
+    memset(big, 'x', sizeof big);
+    for (int i = 0; i < 1000; i++)
+        sb_appendf(&b, "line %d\n", i);
+    sb_append(&b, (ls_view){ big, sizeof big });
+    sb_append(&b, LS_LIT("end"));
+    lstr f;
+    ok &= sb_flatten(&b, &f) == b.len && strlen(f.p) == b.len;
+    ok &= strncmp(f.p, "line 0\nline 1\n", 14) == 0;
+    ok &= memcmp(f.p + f.len - 3, "end", 3) == 0 && b.nchunks > 1;
+
+    char path[32];
+    int fd = open_tmp(path);
+    ok &= sb_writev(&b, fd) == b.len;
+    char *back = malloc(b.len);
+    ok &= pread(fd, back, b.len, 0) == (ssize_t)b.len && memcmp(back, f.p, b.len) == 0;
+    close(fd);
+    unlink(path);
+    free(back);
+    lstr_free(&f);
+    sb_free(&b);
+
+    /* rope: random edits against a flat buffer */
+    char ref[20000];
+    size_t rl = 3000;
+    for (size_t i = 0; i < rl; i++)
+        ref[i] = (char)('a' + i % 26);
+    rope r;
+    ok &= rope_from(&r, (ls_view){ ref, rl }) == rl;
+    for (int e = 0; e < 3000 && ok; e++) {
+        size_t pos = rng() % (rl + 1);
+        size_t n = 1 + rng() % (e % 50 == 0 ? 2500 : 20);
+        if (rng() % 2 && rl + n < sizeof ref) {
+            char ins[2600];
+            for (size_t i = 0; i < n; i++)
+                ins[i] = (char)('A' + (e + i) % 26);
+            memmove(ref + pos + n, ref + pos, rl - pos);
+            memcpy(ref + pos, ins, n);
+            rl += n;
+            ok &= rope_insert(&r, pos, (ls_view){ ins, n }) == rl;
+        } else {
+            if (n > rl - pos)
+                n = rl - pos;
+            memmove(ref + pos, ref + pos + n, rl - pos - n);
+            rl -= n;
+            ok &= rope_delete(&r, pos, n) == rl;
+        }
+        char out[64];
+        size_t at = rng() % (rl + 1);
+        size_t got = rope_read(&r, at, out, sizeof out);
+        ok &= got == (rl - at < sizeof out ? rl - at : sizeof out);
+        ok &= memcmp(out, ref + at, got) == 0;
+    }
+    lstr flat;
+    ok &= rope_flatten(&r, &flat) == rl && memcmp(flat.p, ref, rl) == 0;
+    lstr_free(&flat);
+    rope_free(&r);
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    size_t log_mb  = argc > 1 ? strtoull(argv[1], NULL, 10) : 1024;
+    size_t rope_mb = argc > 2 ? strtoull(argv[2], NULL, 10) : 64;
+    size_t edits   = argc > 3 ? strtoull(argv[3], NULL, 10) : 200000;
+    int ok = selftest();
+    printf("self-test: %s\n", ok ? "ok" : "FAILED");
+    build_lines();
+    part_log(log_mb);
+    part_edit(rope_mb, edits);
+    return ok ? 0 : 1;
+}
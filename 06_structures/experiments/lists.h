@@ -0,0 +1,243 @@
+/* lists.h — cache-conscious list building blocks.
+ *
+ *   obj_pool     fixed-size object pool: objects carved from 64 KB slabs,
+ *                recycled through a free list (no malloc per node)
+ *   ilist        intrusive doubly linked list: the links live *inside* the
+ *                user's struct, so one allocation holds data + links
+ *   ulist        unrolled linked list: each 64-byte chunk holds up to
+ *                UL_CAP ints, so iteration pays one miss per 11 items
+ */
+#ifndef LISTS_H
+#define LISTS_H
+
+#include <stddef.h>   /* offsetof, size_t */
+#include <stdint.h>
+#include <stdlib.h>   /* aligned_alloc, free */
+#include <string.h>   /* memmove           */
+
+/* ---------- object pool ---------- */
+
+#define POOL_SLAB (64u * 1024u)
+
+typedef struct pool_slab {
+    struct pool_slab *next;
+} pool_slab;
+
+typedef struct {
+    size_t     obj_size;       /* pointer-aligned; 64-aligned from 64 bytes up */
+    void      *free_list;      /* singly linked through the objects */
+    char      *bump, *end;     /* unused tail of the newest slab */
+    pool_slab *slabs;
+} obj_pool;
+
+static inline void pool_init(obj_pool *p, size_t obj_size) {
+    /* line-sized objects (ul_chunk) must each sit on one cache line */
+    size_t a = obj_size >= 64 ? 64 : sizeof(void *);
+    p->obj_size = (obj_size < a ? a : obj_size + a - 1) & ~(a - 1);
+    p->free_list = NULL;
+    p->bump = p->end = NULL;
+    p->slabs = NULL;
+}
+
+static inline void *pool_alloc(obj_pool *p) {
+    if (p->free_list) {
+        void *o = p->free_list;
+        p->free_list = *(void **)o;
+        return o;
+    }
+    if (p->bump + p->obj_size > p->end) {
+        /* malloc only promises 16: slabs start on a cache line */
+        pool_slab *s = aligned_alloc(64, POOL_SLAB);
+        if (!s)
+            return NULL;
+        s->next = p->slabs;
+        p->slabs = s;
+        /* objects start on a cache line inside each slab */
+        p->bump = (char *)s + 64;
+        p->end = (char *)s + POOL_SLAB;
+    }
+    void *o = p->bump;
+    p->bump += p->obj_size;
+    return o;
+}
+
+static inline void pool_free(obj_pool *p, void *o) {
+    *(void **)o = p->free_list;
+    p->free_list = o;
+}
+
+/* Releases every object at once — no per-node free. */
+static inline void pool_destroy(obj_pool *p) {
+    while (p->slabs) {
+        pool_slab *next = p->slabs->next;
+        free(p->slabs);
+        p->slabs = next;
+    }
+    pool_init(p, p->obj_size);
+}
+
+/* ---------- intrusive doubly linked list ---------- */
+
+typedef struct ilist_node {
+    struct ilist_node *prev, *next;
+} ilist_node;
+
+/* Circular with a sentinel head: no NULL checks on insert/remove. */
+typedef struct {
+    ilist_node head;
+    size_t     size;
+} ilist;
+
+/* From a pointer to the embedded link back to the enclosing struct. */
+#define container_of(ptr, type, member) \
+    ((type *)((char *)(ptr) - offsetof(type, member)))
+
+#define ilist_for_each(pos, list) \
+    for ((pos) = (list)->head.next; (pos) != &(list)->head; (pos) = (pos)->next)
+
+static inline void ilist_init(ilist *l) {
+    l->head.prev = l->head.next = &l->head;
+    l->size = 0;
+}
+
+static inline void ilist_insert_after(ilist *l, ilist_node *at, ilist_node *n) {
+    n->prev = at;
+    n->next = at->next;
+    at->next->prev = n;
+    at->next = n;
+    l->size++;
+}
+
+static inline void ilist_push_back(ilist *l, ilist_node *n) {
+    ilist_insert_after(l, l->head.prev, n);
+}
+
+static inline void ilist_remove(ilist *l, ilist_node *n) {
+    n->prev->next = n->next;
+    n->next->prev = n->prev;
+    n->prev = n->next = NULL;
+    l->size--;
+}
+
+/* ---------- unrolled linked list ---------- */
+
+#define UL_CAP ((64 - 2 * sizeof(void *) - sizeof(uint32_t)) / sizeof(int32_t))
+
+typedef struct ul_chunk {
+    struct ul_chunk *prev, *next;
+    uint32_t         count;
+    int32_t          items[UL_CAP];
+} ul_chunk;
+
+typedef struct {
+    ul_chunk *head, *tail;
+    size_t    size;
+    obj_pool  pool;            /* chunks come from here */
+} ulist;
+
+typedef struct {
+    ul_chunk *chunk;
+    uint32_t  idx;
+} ul_iter;
+
+#define ulist_for_each(it, l)                                              \
+    for ((it).chunk = (l)->head, (it).idx = 0;                             \
+         (it).chunk;                                                       \
+         ++(it).idx >= (it).chunk->count                                   \
+             ? ((it).chunk = (it).chunk->next, (it).idx = 0) : 0)
+
+#define ul_value(it) ((it).chunk->items[(it).idx])
+
+static inline void ulist_init(ulist *l) {
+    l->head = l->tail = NULL;
+    l->size = 0;
+    pool_init(&l->pool, sizeof(ul_chunk));
+}
+
+static inline ul_chunk *ul_new_chunk(ulist *l, ul_chunk *after) {
+    ul_chunk *c = pool_alloc(&l->pool);
+    if (!c)
+        return NULL;
+    c->count = 0;
+    c->prev = after;
+    c->next = after ? after->next : l->head;
+    if (c->next)
+        c->next->prev = c;
+    else
+        l->tail = c;
+    if (after)
+        after->next = c;
+    else
+        l->head = c;
+    return c;
+}
+
+static inline int ulist_push_back(ulist *l, int32_t v) {
+    ul_chunk *c = l->tail;
+    if (!c || c->count == UL_CAP)
+        if (!(c = ul_new_chunk(l, l->tail)))
+            return -1;
+    c->items[c->count++] = v;
+    l->size++;
+    return 0;
+}
+
+/* Insert before position `it`; a full chunk is split in half first. */
+static inline int ulist_insert(ulist *l, ul_iter it, int32_t v) {
+    ul_chunk *c = it.chunk;
+    if (!c)
+        return ulist_push_back(l, v);
+    if (c->count == UL_CAP) {
+        ul_chunk *n = ul_new_chunk(l, c);
+        if (!n)
+            return -1;
+        uint32_t move = c->count / 2;
+        memcpy(n->items, c->items + c->count - move, move * sizeof(int32_t));
+        n->count = move;
+        c->count -= move;
+        if (it.idx > c->count) {
+            it.idx -= c->count;
+            c = n;
+        }
+    }
+    memmove(c->items + it.idx + 1, c->items + it.idx,
+            (c->count - it.idx) * sizeof(int32_t));
+    c->items[it.idx] = v;
+    c->count++;
+    l->size++;
+    return 0;
+}
+
+/* Remove the item at `it`. A chunk that drops below half full absorbs its
+ * successor when both fit, so chunks stay dense. */
+static inline void ulist_remove(ulist *l, ul_iter it) {
+    ul_chunk *c = it.chunk;
+    memmove(c->items + it.idx, c->items + it.idx + 1,
+            (c->count - it.idx - 1) * sizeof(int32_t));
+    c->count--;
+    l->size--;
+    ul_chunk *n = c->next;
+    if (n && c->count < UL_CAP / 2 && c->count + n->count <= UL_CAP) {
+        memcpy(c->items + c->count, n->items, n->count * sizeof(int32_t));
+        c->count += n->count;
+        c->next = n->next;
+        if (n->next)
+            n->next->prev = c;
+        else
+            l->tail = c;
+        pool_free(&l->pool, n);
+    }
+    if (c->count == 0) {
+        if (c->prev) c->prev->next = c->next; else l->head = c->next;
+        if (c->next) c->next->prev = c->prev; else l->tail = c->prev;
+        pool_free(&l->pool, c);
+    }
+}
+
+static inline void ulist_destroy(ulist *l) {
+    pool_destroy(&l->pool);
+    l->head = l->tail = NULL;
+    l->size = 0;
+}
+
+#endif /* LISTS_H */
@@ -0,0 +1,262 @@
+/*
+ * lists_bench.c — naive malloc-per-node list vs lists.h.
+ *
+ * Three lists of N ints:
+ *   naive     struct { int value; node *prev, *next; } from malloc()
+ *   intrusive same links embedded in the item, items from obj_pool
+ *   unrolled  11 ints per 64-byte chunk, chunks from obj_pool
+ *
+ * "aged" relinks the nodes in random order, which is what a long-running
+ * program's heap looks like after many inserts and removes: list order no
+ * longer matches memory order, and every hop is a cache miss.
+ *
+ *   ./lists_bench             # 1M items
+ *   ./lists_bench 10000000
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "lists.h"
+
+typedef struct naive_node {
+    int                value;
+    struct naive_node *prev, *next;
+} naive_node;
+
+typedef struct {
+    int        value;
+    ilist_node link;
+} item;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void shuffle(void **v, size_t n) {
+    for (size_t i = n - 1; i > 0; i--) {
+        size_t j = (size_t)rand() % (i + 1);
+        void *t = v[i];
+        v[i] = v[j];
+        v[j] = t;
+    }
+}
+
+static void row(const char *name, double build, double walk, double aged,
+                double mid, double teardown, size_t n, long long sum) {
+    printf("%-10s %9.1f %9.2f %9.2f %9.1f %9.1f   (sum %lld)\n", name,
+           build / n * 1e9, walk / n * 1e9, aged / n * 1e9, mid * 1e9,
+           teardown / n * 1e9, sum);
+}
+
+/* ---------- naive ---------- */
+
+static naive_node *naive_link(naive_node **nodes, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        nodes[i]->prev = i ? nodes[i - 1] : NULL;
+        nodes[i]->next = i + 1 < n ? nodes[i + 1] : NULL;
+    }
+    return nodes[0];
+}
+
+static long long naive_sum(const naive_node *h) {
+    long long s = 0;
+    for (; h; h = h->next)
+        s += h->value;
+    return s;
+}
+
+static void bench_naive(size_t n, size_t mids) {
+    naive_node **nodes = malloc(n * sizeof *nodes);
+    double t0 = now_sec();
+    naive_node *head = NULL, *tail = NULL;
+    for (size_t i = 0; i < n; i++) {
+        naive_node *nd = malloc(sizeof *nd);
+        nd->value = (int)i;
+        nd->prev = tail;
+        nd->next = NULL;
+        if (tail) tail->next = nd; else head = nd;
+        tail = nd;
+        nodes[i] = nd;
+    }
+    double build = now_sec() - t0;
+
+    t0 = now_sec();
+    long long s = naive_sum(head);
+    double walk = now_sec() - t0;
+
+    shuffle((void **)nodes, n);
+    head = naive_link(nodes, n);
+    t0 = now_sec();
+    s += naive_sum(head);
+    double aged = now_sec() - t0;
+
+    /* insert after a node we already hold (O(1) for any doubly linked list) */
+    t0 = now_sec();
+    for (size_t k = 0; k < mids; k++) {
+        naive_node *at = nodes[(k * 7919) % n];
+        naive_node *nd = malloc(sizeof *nd);
+        nd->value = 1;
+        nd->prev = at;
+        nd->next = at->next;
+        if (at->next) at->next->prev = nd;
+        at->next = nd;
+    }
+    double mid = (now_sec() - t0) / mids;
+
+    t0 = now_sec();
+    while (head) {
+        naive_node *next = head->next;
+        free(head);
+        head = next;
+    }
+    double teardown = now_sec() - t0;
+    row("naive", build, walk, aged, mid, teardown, n, s);
+    free(nodes);
+}
+
+/* ---------- intrusive + pool ---------- */
+
+static long long ilist_sum(ilist *l) {
+    long long s = 0;
+    ilist_node *p;
+    ilist_for_each(p, l)
+        s += container_of(p, item, link)->value;
+    return s;
+}
+
+static void bench_intrusive(size_t n, size_t mids) {
+    obj_pool pool;
+    ilist l;
+    item **items = malloc(n * sizeof *items);
+    pool_init(&pool, sizeof(item));
+    ilist_init(&l);
+
+    double t0 = now_sec();
+    for (size_t i = 0; i < n; i++) {
+        item *it = pool_alloc(&pool);
+        it->value = (int)i;
+        ilist_push_back(&l, &it->link);
+        items[i] = it;
+    }
+    double build = now_sec() - t0;
+
+    t0 = now_sec();
+    long long s = ilist_sum(&l);
+    double walk = now_sec() - t0;
+
+    shuffle((void **)items, n);
+    ilist_init(&l);
+    for (size_t i = 0; i < n; i++)
+        ilist_push_back(&l, &items[i]->link);
+    t0 = now_sec();
+    s += ilist_sum(&l);
+    double aged = now_sec() - t0;
+
+    t0 = now_sec();
+    for (size_t k = 0; k < mids; k++) {
+        item *it = pool_alloc(&pool);
+        it->value = 1;
+        ilist_insert_after(&l, &items[(k * 7919) % n]->link, &it->link);
+    }
+    double mid = (now_sec() - t0) / mids;
+
+    for (size_t k = 0; k < mids; k++) {  /* recycle through the pool */
+        ilist_node *first = l.head.next;
+        ilist_remove(&l, first);
+        pool_free(&pool, container_of(first, item, link));
+    }
+    if (l.size != n)
+        fprintf(stderr, "intrusive list size %zu, expected %zu\n", l.size, n);
+
+    t0 = now_sec();
+    pool_destroy(&pool);                 /* one free per 64 KB slab */
+    double teardown = now_sec() - t0;
+    row("intrusive", build, walk, aged, mid, teardown, n, s);
+    free(items);
+}
+
+/* ---------- unrolled ---------- */
+
+static long long ulist_sum(ulist *l) {
+    long long s = 0;
+    for (ul_chunk *c = l->head; c; c = c->next)
+        for (uint32_t i = 0; i < c->count; i++)
+            s += c->items[i];
+    return s;
+}
+
+static void bench_unrolled(size_t n, size_t mids) {
+    ulist l;
+    ulist_init(&l);
+
+    double t0 = now_sec();
+    for (size_t i = 0; i < n; i++)
+        ulist_push_back(&l, (int32_t)i);
+    double build = now_sec() - t0;
+
+    t0 = now_sec();
+    long long s = ulist_sum(&l);
+    double walk = now_sec() - t0;
+
+    /* age it: relink the chunks in random order */
+    size_t nc = 0;
+    for (ul_chunk *c = l.head; c; c = c->next)
+        nc++;
+    ul_chunk **chunks = malloc(nc * sizeof *chunks);
+    nc = 0;
+    for (ul_chunk *c = l.head; c; c = c->next)
+        chunks[nc++] = c;
+    shuffle((void **)chunks, nc);
+    for (size_t i = 0; i < nc; i++) {
+        chunks[i]->prev = i ? chunks[i - 1] : NULL;
+        chunks[i]->next = i + 1 < nc ? chunks[i + 1] : NULL;
+    }
+    l.head = chunks[0];
+    l.tail = chunks[nc - 1];
+    t0 = now_sec();
+    s += ulist_sum(&l);
+    double aged = now_sec() - t0;
+
+    t0 = now_sec();
+    for (size_t k = 0; k < mids; k++) {
+        ul_chunk *c = chunks[(k * 7919) % nc];
+        ulist_insert(&l, (ul_iter){ c, c->count / 2 }, 1);
+    }
+    double mid = (now_sec() - t0) / mids;
+
+    /* sanity: the iteration macro sees every item */
+    size_t seen = 0;
+    ul_iter it;
+    ulist_for_each(it, &l)
+        seen += ul_value(it) >= 0;
+    if (seen != n + mids)
+        fprintf(stderr, "unrolled list lost items: %zu vs %zu\n", seen, n + mids);
+
+    for (size_t k = 0; k < mids; k++)
+        ulist_remove(&l, (ul_iter){ l.head, 0 });
+    if (l.size != n)
+        fprintf(stderr, "unrolled list size %zu, expected %zu\n", l.size, n);
+
+    t0 = now_sec();
+    ulist_destroy(&l);
+    double teardown = now_sec() - t0;
+    row("unrolled", build, walk, aged, mid, teardown, n, s);
+    free(chunks);
+}
+
+int main(int argc, char **argv) {
+    size_t n = argc > 1 ? strtoull(argv[1], NULL, 10) : 1000000;
+    size_t mids = 100000;
+    srand(5);
+    printf("%zu items; ns per item (mid-insert: ns per insert), UL_CAP = %zu\n",
+           n, (size_t)UL_CAP);
+    printf("%-10s %9s %9s %9s %9s %9s\n", "list", "build", "iterate",
+           "aged", "mid-ins", "teardown");
+    bench_naive(n, mids);
+    bench_intrusive(n, mids);
+    bench_unrolled(n, mids);
+    return 0;
+}
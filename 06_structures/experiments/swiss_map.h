@@ -0,0 +1,314 @@
+/* swiss_map.h — open-addressing hash map keyed by pointers / integers.
+ *
+ * SwissTable-style layout:
+ *   ctrl[]  one control byte per slot: EMPTY (0x80) or the low 7 hash bits
+ *   slots[] key + value stored inline (no per-entry allocation)
+ *
+ * Lookups compare 16 control bytes at once (SSE2 / NEON / scalar fallback)
+ * and only touch slots whose 7-bit tag matches.
+ *
+ * Probing is linear in windows of 16, which allows *backward-shift*
+ * deletion: erasing never leaves a tombstone behind.
+ *
+ * Concurrency: read-mostly. sm_find() is lock-free (seqlock + retry),
+ * writers are serialized by an internal mutex. Grown tables are retired,
+ * not freed, until sm_destroy(), so a reader can never touch freed memory.
+ */
+#ifndef SWISS_MAP_H
+#define SWISS_MAP_H
+
+#include <pthread.h>    /* writer mutex          */
+#include <stdatomic.h>  /* seqlock counter       */
+#include <stdbool.h>
+#include <stdint.h>     /* uintptr_t, uint64_t   */
+#include <stdlib.h>     /* malloc, free          */
+#include <string.h>     /* memset                */
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#define SM_GROUP 16
+#define SM_EMPTY ((int8_t)-128)       /* 0x80: only negative control value */
+
+typedef struct {
+    uintptr_t key;
+    uint64_t  val;
+} sm_slot;
+
+typedef struct sm_table {
+    size_t           cap;              /* power of two, >= SM_GROUP */
+    int8_t          *ctrl;             /* cap + SM_GROUP - 1 bytes (tail mirrors head) */
+    sm_slot         *slots;
+    struct sm_table *retired;          /* older tables, freed in sm_destroy */
+} sm_table;
+
+typedef struct {
+    _Atomic(sm_table *) table;
+    size_t              size;
+    _Atomic unsigned    seq;           /* odd while a writer is active */
+    pthread_mutex_t     lock;
+} swiss_map;
+
+/* ---------- hashing ---------- */
+
+/* Pointers have zero low bits and cluster in a few ranges, so every bit of
+ * the uintptr_t must be mixed before we slice the hash (fmix64 finalizer). */
+static inline uint64_t sm_hash(uintptr_t key) {
+    uint64_t x = (uint64_t)key;
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+static inline size_t  sm_h1(uint64_t h) { return (size_t)(h >> 7); }
+static inline int8_t  sm_h2(uint64_t h) { return (int8_t)(h & 0x7f); }
+
+/* ---------- 16-byte group matching ---------- */
+
+/* Bit mask of matching bytes; lane k occupies SM_LANE_BITS bits. */
+#if defined(__SSE2__)
+#define SM_LANE_SHIFT 0
+static inline uint64_t sm_match(const int8_t *c, int8_t tag) {
+    __m128i g = _mm_loadu_si128((const __m128i *)c);
+    return (uint64_t)_mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8(tag)));
+}
+static inline uint64_t sm_match_empty(const int8_t *c) {
+    return (uint64_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)c));
+}
+#elif defined(__ARM_NEON)
+#define SM_LANE_SHIFT 2               /* vshrn trick: 4 bits per lane */
+static inline uint64_t sm_neon_mask(uint8x16_t eq) {
+    uint8x8_t n = vshrn_n_u16(vreinterpretq_u16_u8(eq), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(n), 0) & 0x8888888888888888ULL;
+}
+static inline uint64_t sm_match(const int8_t *c, int8_t tag) {
+    return sm_neon_mask(vceqq_s8(vld1q_s8(c), vdupq_n_s8(tag)));
+}
+static inline uint64_t sm_match_empty(const int8_t *c) {
+    return sm_neon_mask(vcltzq_s8(vld1q_s8(c)));
+}
+#else
+#define SM_LANE_SHIFT 0
+static inline uint64_t sm_match(const int8_t *c, int8_t tag) {
+    uint64_t m = 0;
+    for (int k = 0; k < SM_GROUP; k++)
+        m |= (uint64_t)(c[k] == tag) << k;
+    return m;
+}
+static inline uint64_t sm_match_empty(const int8_t *c) {
+    return sm_match(c, SM_EMPTY);
+}
+#endif
+
+static inline unsigned sm_first_lane(uint64_t m) {
+    return (unsigned)__builtin_ctzll(m) >> SM_LANE_SHIFT;
+}
+
+/* ---------- table helpers ---------- */
+
+static sm_table *sm_table_new(size_t cap) {
+    sm_table *t = malloc(sizeof *t);
+    if (!t)
+        return NULL;
+    t->cap = cap;
+    t->ctrl = malloc(cap + SM_GROUP - 1);
+    t->slots = malloc(cap * sizeof *t->slots);
+    t->retired = NULL;
+    if (!t->ctrl || !t->slots) {
+        free(t->ctrl);
+        free(t->slots);
+        free(t);
+        return NULL;
+    }
+    memset(t->ctrl, SM_EMPTY, cap + SM_GROUP - 1);
+    return t;
+}
+
+/* Keep the mirrored tail in sync so a 16-byte load at any i < cap is valid. */
+static inline void sm_set_ctrl(sm_table *t, size_t i, int8_t c) {
+    t->ctrl[i] = c;
+    if (i < SM_GROUP - 1)
+        t->ctrl[t->cap + i] = c;
+}
+
+/* Slot index of key, or SIZE_MAX. Probes at most cap / 16 + 1 windows so a
+ * reader racing a writer can't loop forever on a torn view. */
+static inline size_t sm_locate(const sm_table *t, uintptr_t key, uint64_t h) {
+    size_t mask = t->cap - 1;
+    size_t pos = sm_h1(h) & mask;
+    int8_t tag = sm_h2(h);
+    for (size_t w = 0; w <= t->cap / SM_GROUP; w++) {
+        const int8_t *c = t->ctrl + pos;
+        for (uint64_t m = sm_match(c, tag); m; m &= m - 1) {
+            size_t i = (pos + sm_first_lane(m)) & mask;
+            if (t->slots[i].key == key)
+                return i;
+        }
+        if (sm_match_empty(c))
+            return SIZE_MAX;
+        pos = (pos + SM_GROUP) & mask;
+    }
+    return SIZE_MAX;
+}
+
+/* First empty slot on key's probe path (table must have room). */
+static size_t sm_find_empty(const sm_table *t, uint64_t h) {
+    size_t mask = t->cap - 1;
+    size_t pos = sm_h1(h) & mask;
+    for (;;) {
+        uint64_t m = sm_match_empty(t->ctrl + pos);
+        if (m)
+            return (pos + sm_first_lane(m)) & mask;
+        pos = (pos + SM_GROUP) & mask;
+    }
+}
+
+static void sm_place(sm_table *t, uintptr_t key, uint64_t val, uint64_t h) {
+    size_t i = sm_find_empty(t, h);
+    t->slots[i].key = key;
+    t->slots[i].val = val;
+    sm_set_ctrl(t, i, sm_h2(h));
+}
+
+/* ---------- seqlock ---------- */
+
+static inline void sm_write_begin(swiss_map *m) {
+    pthread_mutex_lock(&m->lock);
+    atomic_fetch_add_explicit(&m->seq, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+static inline void sm_write_end(swiss_map *m) {
+    atomic_fetch_add_explicit(&m->seq, 1, memory_order_release);
+    pthread_mutex_unlock(&m->lock);
+}
+
+/* ---------- public API ---------- */
+
+static inline int sm_init(swiss_map *m, size_t expected) {
+    size_t cap = SM_GROUP;
+    while (cap * 7 / 8 < expected)
+        cap *= 2;
+    sm_table *t = sm_table_new(cap);
+    if (!t)
+        return -1;
+    atomic_init(&m->table, t);
+    atomic_init(&m->seq, 0);
+    m->size = 0;
+    pthread_mutex_init(&m->lock, NULL);
+    return 0;
+}
+
+static inline void sm_destroy(swiss_map *m) {
+    sm_table *t = atomic_load(&m->table);
+    while (t) {
+        sm_table *next = t->retired;
+        free(t->ctrl);
+        free(t->slots);
+        free(t);
+        t = next;
+    }
+    pthread_mutex_destroy(&m->lock);
+}
+
+/* Lock-free lookup; safe to call while another thread writes. */
+static inline bool sm_find(swiss_map *m, uintptr_t key, uint64_t *val) {
+    uint64_t h = sm_hash(key);
+    for (;;) {
+        unsigned s1 = atomic_load_explicit(&m->seq, memory_order_acquire);
+        if (s1 & 1u)
+            continue;                      /* writer active */
+        sm_table *t = atomic_load_explicit(&m->table, memory_order_acquire);
+        size_t i = sm_locate(t, key, h);
+        uint64_t v = i != SIZE_MAX ? t->slots[i].val : 0;
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&m->seq, memory_order_relaxed) != s1)
+            continue;                      /* torn read: retry */
+        if (i != SIZE_MAX && val)
+            *val = v;
+        return i != SIZE_MAX;
+    }
+}
+
+/* Double capacity and rehash; old table is retired, not freed. */
+static int sm_grow(swiss_map *m) {
+    sm_table *old = atomic_load_explicit(&m->table, memory_order_relaxed);
+    sm_table *t = sm_table_new(old->cap * 2);
+    if (!t)
+        return -1;
+    for (size_t i = 0; i < old->cap; i++)
+        if (old->ctrl[i] != SM_EMPTY)
+            sm_place(t, old->slots[i].key, old->slots[i].val,
+                     sm_hash(old->slots[i].key));
+    t->retired = old;
+    atomic_store_explicit(&m->table, t, memory_order_release);
+    return 0;
+}
+
+/* Insert or overwrite. Returns 0 on success, -1 if growing failed. */
+static inline int sm_insert(swiss_map *m, uintptr_t key, uint64_t val) {
+    uint64_t h = sm_hash(key);
+    int rc = 0;
+    sm_write_begin(m);
+    sm_table *t = atomic_load_explicit(&m->table, memory_order_relaxed);
+    size_t i = sm_locate(t, key, h);
+    if (i != SIZE_MAX) {
+        t->slots[i].val = val;
+    } else if ((m->size + 1) * 8 > t->cap * 7 && sm_grow(m) != 0) {
+        rc = -1;
+    } else {
+        sm_place(atomic_load_explicit(&m->table, memory_order_relaxed), key, val, h);
+        m->size++;
+    }
+    sm_write_end(m);
+    return rc;
+}
+
+/* Erase with backward shift: later entries of the same run slide into the
+ * hole, so lookups never have to step over tombstones. */
+static inline bool sm_erase(swiss_map *m, uintptr_t key) {
+    uint64_t h = sm_hash(key);
+    sm_write_begin(m);
+    sm_table *t = atomic_load_explicit(&m->table, memory_order_relaxed);
+    size_t mask = t->cap - 1;
+    size_t hole = sm_locate(t, key, h);
+    if (hole == SIZE_MAX) {
+        sm_write_end(m);
+        return false;
+    }
+    for (size_t j = (hole + 1) & mask; t->ctrl[j] != SM_EMPTY; j = (j + 1) & mask) {
+        size_t home = sm_h1(sm_hash(t->slots[j].key)) & mask;
+        /* can slot j move back to `hole` without passing its home? */
+        bool movable = hole <= j ? (home <= hole || home > j)
+                                 : (home <= hole && home > j);
+        if (movable) {
+            t->slots[hole] = t->slots[j];
+            sm_set_ctrl(t, hole, t->ctrl[j]);
+            hole = j;
+        }
+    }
+    sm_set_ctrl(t, hole, SM_EMPTY);
+    m->size--;
+    sm_write_end(m);
+    return true;
+}
+
+/* Visit every entry (writers are blocked for the duration). */
+static inline void sm_for_each(swiss_map *m,
+                               void (*fn)(uintptr_t key, uint64_t val, void *ctx),
+                               void *ctx) {
+    pthread_mutex_lock(&m->lock);
+    sm_table *t = atomic_load_explicit(&m->table, memory_order_relaxed);
+    for (size_t i = 0; i < t->cap; i++)
+        if (t->ctrl[i] != SM_EMPTY)
+            fn(t->slots[i].key, t->slots[i].val, ctx);
+    pthread_mutex_unlock(&m->lock);
+}
+
+#endif /* SWISS_MAP_H */
@@ -0,0 +1,306 @@
+/*
+ * swiss_map_bench.c — swiss_map.h vs a classic chained hash table.
+ *
+ * Keys are pointer-like values (16-byte aligned, clustered), the common
+ * "map pointer -> metadata" case from the dangling-pointer and leak notes.
+ * A small allocation tracker at the end shows that use directly.
+ *
+ *   gcc -O2 -pthread swiss_map_bench.c -o swiss_map_bench
+ *   ./swiss_map_bench            # 1M keys
+ *   ./swiss_map_bench 10000000
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "swiss_map.h"
+
+/* ---------- baseline: separate chaining, one malloc per entry ---------- */
+
+typedef struct chain_node {
+    uintptr_t          key;
+    uint64_t           val;
+    struct chain_node *next;
+} chain_node;
+
+typedef struct {
+    chain_node **buckets;
+    size_t       nbuckets;
+    size_t       size;
+} chain_map;
+
+static void chain_init(chain_map *m, size_t nb) {
+    m->nbuckets = nb;
+    m->buckets = calloc(nb, sizeof *m->buckets);
+    m->size = 0;
+}
+
+static void chain_grow(chain_map *m) {
+    size_t nb = m->nbuckets * 2;
+    chain_node **b = calloc(nb, sizeof *b);
+    for (size_t i = 0; i < m->nbuckets; i++) {
+        chain_node *n = m->buckets[i];
+        while (n) {
+            chain_node *next = n->next;
+            size_t k = sm_hash(n->key) & (nb - 1);
+            n->next = b[k];
+            b[k] = n;
+            n = next;
+        }
+    }
+    free(m->buckets);
+    m->buckets = b;
+    m->nbuckets = nb;
+}
+
+static void chain_insert(chain_map *m, uintptr_t key, uint64_t val) {
+    size_t k = sm_hash(key) & (m->nbuckets - 1);
+    for (chain_node *n = m->buckets[k]; n; n = n->next)
+        if (n->key == key) {
+            n->val = val;
+            return;
+        }
+    if (m->size + 1 > m->nbuckets) {
+        chain_grow(m);
+        k = sm_hash(key) & (m->nbuckets - 1);
+    }
+    chain_node *n = malloc(sizeof *n);
+    n->key = key;
+    n->val = val;
+    n->next = m->buckets[k];
+    m->buckets[k] = n;
+    m->size++;
+}
+
+static bool chain_find(const chain_map *m, uintptr_t key, uint64_t *val) {
+    for (chain_node *n = m->buckets[sm_hash(key) & (m->nbuckets - 1)]; n; n = n->next)
+        if (n->key == key) {
+            *val = n->val;
+            return true;
+        }
+    return false;
+}
+
+static bool chain_erase(chain_map *m, uintptr_t key) {
+    chain_node **pp = &m->buckets[sm_hash(key) & (m->nbuckets - 1)];
+    for (; *pp; pp = &(*pp)->next)
+        if ((*pp)->key == key) {
+            chain_node *dead = *pp;
+            *pp = dead->next;
+            free(dead);
+            m->size--;
+            return true;
+        }
+    return false;
+}
+
+static void chain_destroy(chain_map *m) {
+    for (size_t i = 0; i < m->nbuckets; i++) {
+        chain_node *n = m->buckets[i];
+        while (n) {
+            chain_node *next = n->next;
+            free(n);
+            n = next;
+        }
+    }
+    free(m->buckets);
+}
+
+/* ---------- benchmark ---------- */
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void shuffle(uintptr_t *v, size_t n) {
+    for (size_t i = n - 1; i > 0; i--) {
+        size_t j = (size_t)rand() % (i + 1);
+        uintptr_t t = v[i];
+        v[i] = v[j];
+        v[j] = t;
+    }
+}
+
+static void report(const char *what, double sec, size_t ops) {
+    printf("  %-18s %8.1f ns/op\n", what, sec / ops * 1e9);
+}
+
+static void bench_single(size_t n) {
+    uintptr_t *keys = malloc(n * sizeof *keys);
+    uintptr_t *miss = malloc(n * sizeof *miss);
+    uintptr_t base = 0x7f3a12340000u;
+    for (size_t i = 0; i < n; i++) {
+        keys[i] = base + 48 * i;                 /* like malloc(40) results */
+        miss[i] = base + 48 * (i + n) + 16;
+    }
+    shuffle(keys, n);
+
+    swiss_map sm;
+    chain_map cm;
+    uint64_t v, sum = 0;
+    double t0;
+
+    printf("swiss_map (%zu keys)\n", n);
+    sm_init(&sm, 16);
+    t0 = now_sec();
+    for (size_t i = 0; i < n; i++)
+        sm_insert(&sm, keys[i], i);
+    report("insert", now_sec() - t0, n);
+    shuffle(keys, n);
+    t0 = now_sec();
+    for (size_t i = 0; i < n; i++)
+        sum += sm_find(&sm, keys[i], &v) ? v : 0;
+    report("find hit", now_sec() - t0, n);
+    t0 = now_sec();
+    for (size_t i = 0; i < n; i++)
+        sum += sm_find(&sm, miss[i], &v);
+    report("find miss", now_sec() - t0, n);
+    t0 = now_sec();
+    for (size_t i = 0; i < n / 2; i++)
+        sm_erase(&sm, keys[i]);
+    report("erase", now_sec() - t0, n / 2);
+    size_t found = 0;
+    for (size_t i = 0; i < n; i++)
+        found += sm_find(&sm, keys[i], NULL);
+    sm_table *t = atomic_load(&sm.table);
+    printf("  %-18s %8zu (expect %zu)\n", "left after erase", found, n - n / 2);
+    printf("  %-18s %8.1f bytes/entry (table only)\n", "memory",
+           (double)(t->cap * (sizeof(sm_slot) + 1)) / n);
+    sm_destroy(&sm);
+
+    printf("chained (%zu keys)\n", n);
+    chain_init(&cm, 16);
+    t0 = now_sec();
+    for (size_t i = 0; i < n; i++)
+        chain_insert(&cm, keys[i], i);
+    report("insert", now_sec() - t0, n);
+    shuffle(keys, n);
+    t0 = now_sec();
+    for (size_t i = 0; i < n; i++)
+        sum += chain_find(&cm, keys[i], &v) ? v : 0;
+    report("find hit", now_sec() - t0, n);
+    t0 = now_sec();
+    for (size_t i = 0; i < n; i++)
+        sum += chain_find(&cm, miss[i], &v);
+    report("find miss", now_sec() - t0, n);
+    t0 = now_sec();
+    for (size_t i = 0; i < n / 2; i++)
+        chain_erase(&cm, keys[i]);
+    report("erase", now_sec() - t0, n / 2);
+    printf("  %-18s %8.1f bytes/entry (+ malloc headers)\n", "memory",
+           (double)(cm.nbuckets * sizeof(chain_node *) + n * sizeof(chain_node)) / n);
+    chain_destroy(&cm);
+
+    printf("(checksum %llu)\n", (unsigned long long)sum);
+    free(keys);
+    free(miss);
+}
+
+/* ---------- read-mostly concurrency ---------- */
+
+typedef struct {
+    swiss_map       *map;
+    size_t           n;
+    _Atomic int     *stop;
+    unsigned long    reads;
+    unsigned long    wrong;
+} reader_arg;
+
+static void *reader(void *p) {
+    reader_arg *a = p;
+    uint64_t v;
+    size_t i = 0;
+    while (!atomic_load_explicit(a->stop, memory_order_relaxed)) {
+        uintptr_t key = 0x1000 + 16 * (i % a->n);    /* stable keys: always present */
+        if (!sm_find(a->map, key, &v) || v != key * 3)
+            a->wrong++;
+        a->reads++;
+        i += 7919;
+    }
+    return NULL;
+}
+
+static void bench_concurrent(size_t n, int nreaders) {
+    swiss_map m;
+    sm_init(&m, n);
+    for (size_t i = 0; i < n; i++)
+        sm_insert(&m, 0x1000 + 16 * i, (0x1000 + 16 * i) * 3);
+
+    _Atomic int stop = 0;
+    pthread_t th[8];
+    reader_arg args[8];
+    for (int r = 0; r < nreaders; r++) {
+        args[r] = (reader_arg){ &m, n, &stop, 0, 0 };
+        pthread_create(&th[r], NULL, reader, &args[r]);
+    }
+
+    /* writer churns a disjoint key range (and forces a few resizes) */
+    double t0 = now_sec();
+    size_t writes = 0;
+    while (now_sec() - t0 < 1.0) {
+        uintptr_t k = 0x80000000u + 16 * (writes % (4 * n));
+        if (writes / (4 * n) % 2 == 0)
+            sm_insert(&m, k, writes);
+        else
+            sm_erase(&m, k);
+        writes++;
+    }
+    atomic_store(&stop, 1);
+    unsigned long reads = 0, wrong = 0;
+    for (int r = 0; r < nreaders; r++) {
+        pthread_join(th[r], NULL);
+        reads += args[r].reads;
+        wrong += args[r].wrong;
+    }
+    double dt = now_sec() - t0;
+    printf("concurrent: %d readers + 1 writer for %.1f s\n", nreaders, dt);
+    printf("  reads %.1f M/s, writes %.1f M/s, wrong results %lu\n",
+           reads / dt / 1e6, writes / dt / 1e6, wrong);
+    sm_destroy(&m);
+}
+
+/* ---------- the motivating use: pointer -> metadata ---------- */
+
+static swiss_map live;
+
+static void *tracked_malloc(size_t size) {
+    void *p = malloc(size);
+    if (p)
+        sm_insert(&live, (uintptr_t)p, size);
+    return p;
+}
+
+static void tracked_free(void *p) {
+    if (p && !sm_erase(&live, (uintptr_t)p))
+        fprintf(stderr, "free of untracked or already freed %p\n", p);
+    free(p);
+}
+
+static void report_leak(uintptr_t key, uint64_t size, void *ctx) {
+    (void)ctx;
+    printf("  leak: %p (%llu bytes)\n", (void *)key, (unsigned long long)size);
+}
+
+static void leak_demo(void) {
+    sm_init(&live, 16);
+    char *name = tracked_malloc(20);
+    int *pv = tracked_malloc(5 * sizeof(int));
+    tracked_free(pv);
+    (void)name;                       /* never freed: reported below */
+    printf("leak report:\n");
+    sm_for_each(&live, report_leak, NULL);
+    free(name);
+    sm_destroy(&live);
+}
+
+int main(int argc, char **argv) {
+    size_t n = argc > 1 ? strtoull(argv[1], NULL, 10) : 1000000;
+    srand(1);
+    bench_single(n);
+    bench_concurrent(n / 10 ? n / 10 : 1, 2);
+    leak_demo();
+    return 0;
+}
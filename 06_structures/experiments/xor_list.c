@@ -0,0 +1,492 @@
+/*
+ * xor_list.c — halving link overhead by storing pointers as integers.
+ *
+ * 01_intro/notes/11_intptr_t_and_uintptr_t.md shows that a pointer survives
+ * a round trip through uintptr_t. Two structures built on that:
+ *
+ *   XOR list      one uintptr_t per node holds prev ^ next. Knowing where
+ *                 you came from gives you where to go, in either direction.
+ *   delta array   an array of pointers stored as 32-bit differences from the
+ *                 previous entry (in units of the common alignment), with a
+ *                 full pointer every DP_STRIDE entries for random access.
+ *
+ * The benchmark compares bytes per node and traversal speed against a
+ * malloc'd doubly linked list and the pooled intrusive list from lists.h.
+ *
+ *   gcc -O2 xor_list.c -o xor_list
+ *   ./xor_list              # 10^7 nodes
+ *   ./xor_list 1000000
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "lists.h"
+
+/* ---------- 1) XOR doubly linked list ---------- */
+
+typedef struct xnode {
+    uintptr_t link;            /* (uintptr_t)prev ^ (uintptr_t)next */
+    int       value;
+} xnode;
+
+typedef struct {
+    xnode   *head, *tail;
+    size_t   size;
+    obj_pool pool;
+} xlist;
+
+/* A position needs two pointers: the node and the one we arrived from.
+ * Forward and backward cursors are the same thing started at opposite ends.
+ * `rev` records which end that was; only insert at an end needs it, since
+ * on a one-node list head == tail and the pointers can't tell. */
+typedef struct {
+    xnode *prev, *cur;
+    int    rev;                /* 1: travelling from tail to head */
+} xcursor;
+
+static inline xnode *x_other(const xnode *n, const xnode *one) {
+    return (xnode *)(n->link ^ (uintptr_t)one);
+}
+
+static void xlist_init(xlist *l) {
+    l->head = l->tail = NULL;
+    l->size = 0;
+    pool_init(&l->pool, sizeof(xnode));
+}
+
+static inline xcursor xlist_begin(const xlist *l) { return (xcursor){ NULL, l->head, 0 }; }
+static inline xcursor xlist_rbegin(const xlist *l) { return (xcursor){ NULL, l->tail, 1 }; }
+
+static inline xcursor xcur_next(xcursor c) {
+    return (xcursor){ c.cur, x_other(c.cur, c.prev), c.rev };
+}
+
+/* Turn around in place: the old "next" becomes the node we came from. */
+static inline xcursor xcur_reverse(xcursor c) {
+    return (xcursor){ x_other(c.cur, c.prev), c.cur, !c.rev };
+}
+
+#define xlist_for_each(c, l) \
+    for ((c) = xlist_begin(l); (c).cur; (c) = xcur_next(c))
+
+#define xlist_for_each_reverse(c, l) \
+    for ((c) = xlist_rbegin(l); (c).cur; (c) = xcur_next(c))
+
+/* Insert between c.prev and c.cur (c.cur may be NULL: append at that end).
+ * Returns the cursor positioned on the new node. */
+static xcursor xlist_insert(xlist *l, xcursor c, int value) {
+    xnode *n = pool_alloc(&l->pool);
+    if (!n)
+        return (xcursor){ NULL, NULL, c.rev };
+    n->value = value;
+    n->link = (uintptr_t)c.prev ^ (uintptr_t)c.cur;
+    if (c.prev)
+        c.prev->link ^= (uintptr_t)c.cur ^ (uintptr_t)n;
+    if (c.cur)
+        c.cur->link ^= (uintptr_t)c.prev ^ (uintptr_t)n;
+    /* a NULL neighbour means we're at an end: behind the cursor is the end
+     * it started from, ahead of it the other one */
+    if (!c.prev) {
+        if (c.rev) l->tail = n; else l->head = n;
+    }
+    if (!c.cur) {
+        if (c.rev) l->head = n; else l->tail = n;
+    }
+    l->size++;
+    return (xcursor){ c.prev, n, c.rev };
+}
+
+static void xlist_push_back(xlist *l, int value) {
+    xlist_insert(l, (xcursor){ l->tail, NULL, 0 }, value);
+}
+
+static void xlist_push_front(xlist *l, int value) {
+    xlist_insert(l, (xcursor){ NULL, l->head, 0 }, value);
+}
+
+/* Unlink c.cur; returns the cursor on the node after it (same direction). */
+static xcursor xlist_remove(xlist *l, xcursor c) {
+    xnode *n = c.cur, *next = x_other(n, c.prev);
+    if (c.prev)
+        c.prev->link ^= (uintptr_t)n ^ (uintptr_t)next;
+    if (next)
+        next->link ^= (uintptr_t)n ^ (uintptr_t)c.prev;
+    /* at an end one neighbour is NULL (both, for a single node) */
+    if (l->head == n) l->head = c.prev ? c.prev : next;
+    if (l->tail == n) l->tail = c.prev ? c.prev : next;
+    pool_free(&l->pool, n);
+    l->size--;
+    return (xcursor){ c.prev, next, c.rev };
+}
+
+/* O(1): an XOR list has no direction of its own. */
+static void xlist_reverse(xlist *l) {
+    xnode *t = l->head;
+    l->head = l->tail;
+    l->tail = t;
+}
+
+static void xlist_destroy(xlist *l) {
+    pool_destroy(&l->pool);
+    l->head = l->tail = NULL;
+    l->size = 0;
+}
+
+/* ---------- 2) delta-encoded pointer array ---------- */
+
+#define DP_STRIDE 64
+
+typedef struct {
+    int32_t   *delta;          /* (p[i] - p[i-1]) >> shift; delta[0] unused.
+                                  Decoding shifts as uintptr_t: wraps, no UB */
+    uintptr_t *anchor;         /* p[k * DP_STRIDE], full width */
+    size_t     n;
+    unsigned   shift;          /* common trailing zero bits of all pointers */
+} dparr;
+
+typedef struct {
+    const dparr *a;
+    size_t       i;
+    uintptr_t    p;
+} dp_cursor;
+
+static void dp_free(dparr *a) {
+    free(a->delta);
+    free(a->anchor);
+}
+
+/* Returns -1 if some difference doesn't fit in 32 bits (the caller keeps a
+ * plain pointer array then), or if out of memory; nothing is left allocated. */
+static int dp_encode(dparr *a, void *const *ptrs, size_t n) {
+    uintptr_t bits = 0;
+    for (size_t i = 0; i < n; i++)
+        bits |= (uintptr_t)ptrs[i];
+    a->shift = bits ? (unsigned)__builtin_ctzll(bits) : 0;
+    if (a->shift > 4)
+        a->shift = 4;
+    a->n = n;
+    a->delta = malloc((n ? n : 1) * sizeof *a->delta);
+    a->anchor = malloc((n / DP_STRIDE + 1) * sizeof *a->anchor);
+    if (!a->delta || !a->anchor) {
+        dp_free(a);
+        return -1;
+    }
+    for (size_t i = 0; i < n; i++) {
+        uintptr_t p = (uintptr_t)ptrs[i];
+        if (i % DP_STRIDE == 0)
+            a->anchor[i / DP_STRIDE] = p;
+        if (i == 0) {
+            a->delta[0] = 0;
+            continue;
+        }
+        intptr_t d = ((intptr_t)p - (intptr_t)ptrs[i - 1]) / ((intptr_t)1 << a->shift);
+        if (d < INT32_MIN || d > INT32_MAX) {
+            dp_free(a);
+            return -1;
+        }
+        a->delta[i] = (int32_t)d;
+    }
+    return 0;
+}
+
+/* Random access: nearest anchor, then at most DP_STRIDE - 1 additions. */
+static void *dp_get(const dparr *a, size_t i) {
+    size_t k = i / DP_STRIDE * DP_STRIDE;
+    uintptr_t p = a->anchor[i / DP_STRIDE];
+    while (k < i)
+        p += (uintptr_t)(intptr_t)a->delta[++k] << a->shift;
+    return (void *)p;
+}
+
+static inline dp_cursor dp_at(const dparr *a, size_t i) {
+    return (dp_cursor){ a, i, (uintptr_t)dp_get(a, i) };
+}
+
+static inline void *dp_ptr(dp_cursor c) { return (void *)c.p; }
+
+/* Both return 0 when the cursor would leave the array. */
+static inline int dp_next(dp_cursor *c) {
+    if (c->i + 1 >= c->a->n)
+        return 0;
+    c->p += (uintptr_t)(intptr_t)c->a->delta[++c->i] << c->a->shift;
+    return 1;
+}
+
+static inline int dp_prev(dp_cursor *c) {
+    if (c->i == 0)
+        return 0;
+    c->p -= (uintptr_t)(intptr_t)c->a->delta[c->i--] << c->a->shift;
+    return 1;
+}
+
+static size_t dp_bytes(const dparr *a) {
+    return a->n * sizeof *a->delta + (a->n / DP_STRIDE + 1) * sizeof *a->anchor;
+}
+
+/* ---------- benchmark ---------- */
+
+typedef struct dnode {
+    int           value;
+    struct dnode *prev, *next;
+} dnode;
+
+typedef struct {
+    int        value;
+    ilist_node link;
+} item;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static size_t pool_bytes(const obj_pool *p) {
+    size_t s = 0;
+    for (const pool_slab *sl = p->slabs; sl; sl = sl->next)
+        s += POOL_SLAB;
+    return s;
+}
+
+static void shuffle(size_t *v, size_t n) {
+    for (size_t i = n - 1; i > 0; i--) {
+        size_t j = ((size_t)rand() << 16 ^ (size_t)rand()) % (i + 1);
+        size_t t = v[i];
+        v[i] = v[j];
+        v[j] = t;
+    }
+}
+
+static void report(const char *name, double bytes, double fwd, double bwd,
+                   size_t n, long long sum) {
+    printf("%-14s %7.1f B/node %8.2f ns fwd %8.2f ns bwd   (sum %lld)\n", name,
+           bytes / n, fwd / n * 1e9, bwd / n * 1e9, sum);
+}
+
+/* glibc rounds every request up to 16 bytes and adds an 8-byte header */
+static size_t malloc_footprint(size_t sz) {
+    size_t c = sz + sizeof(size_t);
+    return c < 32 ? 32 : (c + 15) & ~(size_t)15;
+}
+
+/* `order` is the link order: order[k] = allocation index of the k-th node. */
+static void bench_malloc(size_t n, const size_t *order) {
+    dnode **nodes = malloc(n * sizeof *nodes);
+    for (size_t i = 0; i < n; i++) {
+        nodes[i] = malloc(sizeof(dnode));
+        nodes[i]->value = (int)i;
+    }
+    for (size_t k = 0; k < n; k++) {
+        dnode *d = nodes[order[k]];
+        d->prev = k ? nodes[order[k - 1]] : NULL;
+        d->next = k + 1 < n ? nodes[order[k + 1]] : NULL;
+    }
+    dnode *head = nodes[order[0]], *tail = nodes[order[n - 1]];
+
+    long long s = 0;
+    double t0 = now_sec();
+    for (dnode *d = head; d; d = d->next)
+        s += d->value;
+    double fwd = now_sec() - t0;
+    t0 = now_sec();
+    for (dnode *d = tail; d; d = d->prev)
+        s += d->value;
+    double bwd = now_sec() - t0;
+    report("malloc dlist", (double)n * malloc_footprint(sizeof(dnode)), fwd, bwd, n, s);
+
+    for (size_t i = 0; i < n; i++)
+        free(nodes[i]);
+    free(nodes);
+}
+
+static void bench_ilist(size_t n, const size_t *order) {
+    obj_pool pool;
+    ilist l;
+    item **items = malloc(n * sizeof *items);
+    pool_init(&pool, sizeof(item));
+    ilist_init(&l);
+    for (size_t i = 0; i < n; i++) {
+        items[i] = pool_alloc(&pool);
+        items[i]->value = (int)i;
+    }
+    for (size_t k = 0; k < n; k++)
+        ilist_push_back(&l, &items[order[k]]->link);
+
+    long long s = 0;
+    double t0 = now_sec();
+    for (ilist_node *p = l.head.next; p != &l.head; p = p->next)
+        s += container_of(p, item, link)->value;
+    double fwd = now_sec() - t0;
+    t0 = now_sec();
+    for (ilist_node *p = l.head.prev; p != &l.head; p = p->prev)
+        s += container_of(p, item, link)->value;
+    double bwd = now_sec() - t0;
+    report("pooled ilist", (double)pool_bytes(&pool), fwd, bwd, n, s);
+
+    pool_destroy(&pool);
+    free(items);
+}
+
+static void bench_xlist(size_t n, const size_t *order) {
+    xlist l;
+    xlist_init(&l);
+    /* allocate in index order, then link in `order` */
+    xnode **nodes = malloc(n * sizeof *nodes);
+    for (size_t i = 0; i < n; i++) {
+        nodes[i] = pool_alloc(&l.pool);
+        nodes[i]->value = (int)i;
+    }
+    for (size_t k = 0; k < n; k++) {
+        uintptr_t prev = k ? (uintptr_t)nodes[order[k - 1]] : 0;
+        uintptr_t next = k + 1 < n ? (uintptr_t)nodes[order[k + 1]] : 0;
+        nodes[order[k]]->link = prev ^ next;
+    }
+    l.head = nodes[order[0]];
+    l.tail = nodes[order[n - 1]];
+    l.size = n;
+
+    long long s = 0;
+    xcursor c;
+    double t0 = now_sec();
+    xlist_for_each(c, &l)
+        s += c.cur->value;
+    double fwd = now_sec() - t0;
+    t0 = now_sec();
+    xlist_for_each_reverse(c, &l)
+        s += c.cur->value;
+    double bwd = now_sec() - t0;
+    report("pooled xlist", (double)pool_bytes(&l.pool), fwd, bwd, n, s);
+
+    xlist_destroy(&l);
+    free(nodes);
+}
+
+/* Plain vs delta-encoded pointer array over the same pooled objects. */
+static void bench_ptr_arrays(size_t n, const size_t *order) {
+    obj_pool pool;
+    pool_init(&pool, sizeof(item));
+    item **objs = malloc(n * sizeof *objs);
+    void **ptrs = malloc(n * sizeof *ptrs);
+    for (size_t i = 0; i < n; i++) {
+        objs[i] = pool_alloc(&pool);
+        objs[i]->value = (int)i;
+    }
+    for (size_t k = 0; k < n; k++)
+        ptrs[k] = objs[order[k]];
+
+    dparr a;
+    if (dp_encode(&a, ptrs, n) != 0) {
+        printf("delta array: a difference does not fit in 32 bits\n");
+        goto out;
+    }
+
+    long long s = 0;
+    double t0 = now_sec();
+    for (size_t k = 0; k < n; k++)
+        s += ((item *)ptrs[k])->value;
+    double fwd = now_sec() - t0;
+    t0 = now_sec();
+    for (size_t k = n; k-- > 0;)
+        s += ((item *)ptrs[k])->value;
+    double bwd = now_sec() - t0;
+    report("void *[]", (double)n * sizeof(void *), fwd, bwd, n, s);
+
+    s = 0;
+    dp_cursor c = dp_at(&a, 0);
+    t0 = now_sec();
+    do
+        s += ((item *)dp_ptr(c))->value;
+    while (dp_next(&c));
+    fwd = now_sec() - t0;
+    t0 = now_sec();
+    do
+        s += ((item *)dp_ptr(c))->value;
+    while (dp_prev(&c));
+    bwd = now_sec() - t0;
+    report("delta array", (double)dp_bytes(&a), fwd, bwd, n, s);
+    printf("  (shift %u; element pointers not counted)\n", a.shift);
+
+    for (size_t k = 0; k < n; k += n / 7 + 1)
+        if (dp_get(&a, k) != ptrs[k])
+            fprintf(stderr, "dp_get(%zu) mismatch\n", k);
+    dp_free(&a);
+out:
+    pool_destroy(&pool);
+    free(objs);
+    free(ptrs);
+}
+
+/* Exercise insert/remove/reverse at both ends and in the middle. */
+static int xlist_selftest(void) {
+    xlist l;
+    xlist_init(&l);
+    for (int i = 1; i <= 5; i++)
+        xlist_push_back(&l, i);         /* 1 2 3 4 5 */
+    xlist_push_front(&l, 0);            /* 0 1 2 3 4 5 */
+    xcursor c = xlist_begin(&l);
+    c = xcur_next(xcur_next(c));        /* on 2 */
+    c = xlist_remove(&l, c);            /* 0 1 3 4 5, on 3 */
+    xlist_insert(&l, c, 9);             /* 0 1 9 3 4 5 */
+    xlist_reverse(&l);                  /* 5 4 3 9 1 0 */
+    c = xlist_begin(&l);
+    c = xlist_remove(&l, c);            /* 4 3 9 1 0 */
+    c = xlist_rbegin(&l);
+    xlist_remove(&l, c);                /* 4 3 9 1 */
+    c = xcur_reverse(xcur_next(xlist_begin(&l)));   /* on 3, heading left */
+    xlist_insert(&l, xcur_next(xcur_next(c)), 7);   /* past the front: 7 4 3 9 1 */
+
+    static const int want[] = { 7, 4, 3, 9, 1 };
+    int ok = l.size == 5;
+    size_t i = 0;
+    xlist_for_each(c, &l)
+        ok &= i < 5 && c.cur->value == want[i++];
+    xlist_for_each_reverse(c, &l)
+        ok &= c.cur->value == want[--i];
+    while (l.head)
+        xlist_remove(&l, xlist_begin(&l));
+    ok &= l.size == 0 && !l.tail;
+
+    /* one node: head == tail, so only the cursor knows which end it is at */
+    xlist_push_back(&l, 1);
+    xlist_insert(&l, xlist_rbegin(&l), 2);              /* after the tail: 1 2 */
+    xlist_insert(&l, xcur_next(xlist_begin(&l)), 3);    /* 1 3 2 */
+    c = xlist_remove(&l, xlist_rbegin(&l));             /* 1 3, on 3 heading left */
+    xlist_remove(&l, xcur_next(c));                     /* 3 */
+    xlist_insert(&l, xcur_next(xlist_rbegin(&l)), 4);   /* past the head: 4 3 */
+    static const int want1[] = { 4, 3 };
+    ok &= l.size == 2 && l.head->value == 4 && l.tail->value == 3;
+    i = 0;
+    xlist_for_each(c, &l)
+        ok &= i < 2 && c.cur->value == want1[i++];
+    xlist_for_each_reverse(c, &l)
+        ok &= c.cur->value == want1[--i];
+    xlist_destroy(&l);
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    size_t n = argc > 1 ? strtoull(argv[1], NULL, 10) : 10000000;
+    if (n < 2)
+        n = 2;
+    printf("xlist self-test: %s\n", xlist_selftest() ? "ok" : "FAILED");
+
+    size_t *order = malloc(n * sizeof *order);
+    for (size_t i = 0; i < n; i++)
+        order[i] = i;
+    srand(7);
+
+    for (int aged = 0; aged < 2; aged++) {
+        if (aged)
+            shuffle(order, n);
+        printf("\n%zu nodes, %s (ns per node)\n", n,
+               aged ? "linked in random order" : "linked in allocation order");
+        bench_malloc(n, order);
+        bench_ilist(n, order);
+        bench_xlist(n, order);
+        bench_ptr_arrays(n, order);
+    }
+    free(order);
+    return 0;
+}